@@ -0,0 +1,192 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../data_structures/query_edge.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../data_structures/static_graph.hpp"
+#include "../routing_algorithms/routing_base.hpp"
+#include "../util/graph_loader.hpp"
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../typedefs.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+
+using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+
+// the part of the data facade interface that SearchWithCore needs
+struct CoreGraphFacade
+{
+    using EdgeData = QueryEdge::EdgeData;
+
+    CoreGraphFacade(const QueryGraph &graph, const std::vector<bool> &is_core_node)
+        : graph(graph), is_core_node(is_core_node)
+    {
+    }
+
+    QueryGraph::EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return graph.GetAdjacentEdgeRange(node);
+    }
+    const EdgeData &GetEdgeData(const EdgeID edge) const { return graph.GetEdgeData(edge); }
+    NodeID GetTarget(const EdgeID edge) const { return graph.GetTarget(edge); }
+    bool IsCoreNode(const NodeID node) const
+    {
+        return !is_core_node.empty() && is_core_node[node];
+    }
+
+    const QueryGraph &graph;
+    const std::vector<bool> &is_core_node;
+};
+
+// distance of a query with the SearchWithCore of the routing plugins
+class CoreCHQuery : public BasicRoutingInterface<CoreGraphFacade, CoreCHQuery>
+{
+    using super = BasicRoutingInterface<CoreGraphFacade, CoreCHQuery>;
+
+  public:
+    explicit CoreCHQuery(CoreGraphFacade *facade)
+        : super(facade), forward_heap(facade->graph.GetNumberOfNodes()),
+          reverse_heap(facade->graph.GetNumberOfNodes()),
+          forward_core_heap(facade->graph.GetNumberOfNodes()),
+          reverse_core_heap(facade->graph.GetNumberOfNodes())
+    {
+    }
+
+    int operator()(const NodeID source, const NodeID target)
+    {
+        forward_heap.Clear();
+        reverse_heap.Clear();
+        forward_heap.Insert(source, 0, source);
+        reverse_heap.Insert(target, 0, target);
+
+        NodeID middle_node = SPECIAL_NODEID;
+        int upper_bound = INVALID_EDGE_WEIGHT;
+        packed_leg.clear();
+        super::SearchWithCore(forward_heap, reverse_heap, forward_core_heap, reverse_core_heap,
+                              &middle_node, &upper_bound, 0, packed_leg);
+        return upper_bound;
+    }
+
+  private:
+    SearchEngineData::QueryHeap forward_heap;
+    SearchEngineData::QueryHeap reverse_heap;
+    SearchEngineData::QueryHeap forward_core_heap;
+    SearchEngineData::QueryHeap reverse_core_heap;
+    std::vector<NodeID> packed_leg;
+};
+
+void Benchmark(const boost::filesystem::path &hsgr_path, const unsigned num_queries)
+{
+    std::vector<QueryGraph::NodeArrayEntry> node_list;
+    std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+    std::vector<bool> is_core_node;
+    unsigned check_sum = 0;
+    readHSGRFromStream(hsgr_path, node_list, edge_list, &check_sum, &is_core_node);
+    const QueryGraph graph(node_list, edge_list);
+
+    const auto core_size = std::count(is_core_node.begin(), is_core_node.end(), true);
+    std::cout << "#### " << hsgr_path.string() << "\n";
+    std::cout << graph.GetNumberOfNodes() << " nodes, " << graph.GetNumberOfEdges()
+              << " edges, core of " << core_size << " nodes ("
+              << 100. * core_size / std::max(1u, graph.GetNumberOfNodes()) << "%)"
+              << "\n";
+
+    // the same seed gives the same queries for graphs of the same input
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> node_udist(0, graph.GetNumberOfNodes() - 1);
+    std::vector<std::pair<NodeID, NodeID>> queries;
+    for (unsigned i = 0; i < num_queries; ++i)
+    {
+        queries.emplace_back(node_udist(mt_rand), node_udist(mt_rand));
+    }
+
+    CoreGraphFacade facade(graph, is_core_node);
+    CoreCHQuery query(&facade);
+
+    // the checksum must be the same for all core sizes of one input
+    unsigned long long checksum = 0;
+    TIMER_START(queries);
+    for (const auto &q : queries)
+    {
+        checksum += static_cast<unsigned>(query(q.first, q.second));
+    }
+    TIMER_STOP(queries);
+
+    std::cout << "Took " << TIMER_MSEC(queries) << " msec for " << queries.size() << " queries."
+              << "\n";
+    std::cout << TIMER_MSEC(queries) / static_cast<double>(queries.size()) << " msec/query."
+              << "\n";
+    std::cout << "checksum: " << checksum << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    if (argc < 2)
+    {
+        std::cout << "./core-bench [number of queries] file.hsgr [file.hsgr ...]"
+                  << "\n"
+                  << "compares graphs of one input prepared with different --core values"
+                  << "\n";
+        return 1;
+    }
+
+    try
+    {
+        int first_file = 1;
+        unsigned num_queries = 10000;
+        if (argc > 2 && !boost::filesystem::exists(argv[1]))
+        {
+            num_queries = std::stoul(argv[1]);
+            first_file = 2;
+        }
+
+        for (int i = first_file; i < argc; ++i)
+        {
+            Benchmark(argv[i], num_queries);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+    return 0;
+}
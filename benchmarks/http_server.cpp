@@ -0,0 +1,172 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../util/timing_util.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Replays a single request against a running osrm-routed and compares
+// one connection per request with persistent and pipelined connections.
+
+using boost::asio::ip::tcp;
+
+std::string BuildRequest(const std::string &host, const std::string &path, const bool keep_alive)
+{
+    return "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: " +
+           (keep_alive ? "keep-alive" : "close") + "\r\n\r\n";
+}
+
+// reads exactly one reply, relies on the Content-Length header set by the server.
+// returns whether the server keeps the connection open.
+bool ReadReply(tcp::socket &socket, boost::asio::streambuf &buffer)
+{
+    const std::size_t header_length = boost::asio::read_until(socket, buffer, "\r\n\r\n");
+    std::string header(boost::asio::buffers_begin(buffer.data()),
+                       boost::asio::buffers_begin(buffer.data()) + header_length);
+    buffer.consume(header_length);
+
+    std::size_t content_length = 0;
+    bool keep_alive = false;
+    std::istringstream header_stream(header);
+    std::string line;
+    while (std::getline(header_stream, line))
+    {
+        if (boost::istarts_with(line, "Content-Length:"))
+        {
+            content_length = std::stoul(line.substr(line.find(':') + 1));
+        }
+        if (boost::istarts_with(line, "Connection:"))
+        {
+            keep_alive = boost::icontains(line, "keep-alive");
+        }
+    }
+
+    if (buffer.size() < content_length)
+    {
+        boost::asio::read(socket, buffer,
+                          boost::asio::transfer_exactly(content_length - buffer.size()));
+    }
+    buffer.consume(content_length);
+    return keep_alive;
+}
+
+void Report(const std::string &name, const double msec, const unsigned num_requests)
+{
+    std::cout << "#### " << name << "\n";
+    std::cout << "Took " << msec << " msec for " << num_requests << " requests."
+              << "\n";
+    std::cout << msec / num_requests << " msec/request."
+              << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::cout << "./http-bench host port path [requests] [pipeline depth]"
+                  << "\n";
+        return 1;
+    }
+
+    const std::string host = argv[1];
+    const std::string port = argv[2];
+    const std::string path = argv[3];
+    const unsigned num_requests = argc > 4 ? std::stoul(argv[4]) : 1000;
+    const unsigned pipeline_depth = argc > 5 ? std::stoul(argv[5]) : 16;
+
+    boost::asio::io_service io_service;
+    tcp::resolver resolver(io_service);
+    const auto endpoint = resolver.resolve(tcp::resolver::query(host, port));
+
+    {
+        const std::string request = BuildRequest(host, path, false);
+        TIMER_START(close_per_request);
+        for (unsigned i = 0; i < num_requests; ++i)
+        {
+            tcp::socket socket(io_service);
+            boost::asio::connect(socket, endpoint);
+            boost::asio::write(socket, boost::asio::buffer(request));
+            boost::asio::streambuf buffer;
+            ReadReply(socket, buffer);
+        }
+        TIMER_STOP(close_per_request);
+        Report("one connection per request", TIMER_MSEC(close_per_request), num_requests);
+    }
+
+    {
+        const std::string request = BuildRequest(host, path, true);
+        TIMER_START(keep_alive);
+        tcp::socket socket(io_service);
+        boost::asio::streambuf buffer;
+        bool connected = false;
+        for (unsigned i = 0; i < num_requests; ++i)
+        {
+            // the server closes the connection after --keepalive-requests requests
+            if (!connected)
+            {
+                socket.close();
+                boost::asio::connect(socket, endpoint);
+            }
+            boost::asio::write(socket, boost::asio::buffer(request));
+            connected = ReadReply(socket, buffer);
+        }
+        TIMER_STOP(keep_alive);
+        Report("persistent connection", TIMER_MSEC(keep_alive), num_requests);
+    }
+
+    {
+        std::string batch;
+        for (unsigned i = 0; i < pipeline_depth; ++i)
+        {
+            batch += BuildRequest(host, path, true);
+        }
+        const unsigned num_batches = std::max(1u, num_requests / pipeline_depth);
+        TIMER_START(pipelined);
+        for (unsigned i = 0; i < num_batches; ++i)
+        {
+            tcp::socket socket(io_service);
+            boost::asio::connect(socket, endpoint);
+            boost::asio::write(socket, boost::asio::buffer(batch));
+            boost::asio::streambuf buffer;
+            for (unsigned j = 0; j < pipeline_depth; ++j)
+            {
+                ReadReply(socket, buffer);
+            }
+        }
+        TIMER_STOP(pipelined);
+        Report("pipelined connection, depth " + std::to_string(pipeline_depth),
+               TIMER_MSEC(pipelined), num_batches * pipeline_depth);
+    }
+
+    return 0;
+}
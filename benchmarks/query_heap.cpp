@@ -0,0 +1,184 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../data_structures/binary_heap.hpp"
+#include "../data_structures/query_edge.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../data_structures/static_graph.hpp"
+#include "../data_structures/xor_fast_hash_storage.hpp"
+#include "../routing_algorithms/routing_base.hpp"
+#include "../util/graph_loader.hpp"
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../typedefs.h"
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+
+using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+
+// the part of the data facade interface that RoutingStep needs
+struct GraphFacade
+{
+    using EdgeData = QueryEdge::EdgeData;
+
+    explicit GraphFacade(const QueryGraph &graph) : graph(graph) {}
+
+    QueryGraph::EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return graph.GetAdjacentEdgeRange(node);
+    }
+    const EdgeData &GetEdgeData(const EdgeID edge) const { return graph.GetEdgeData(edge); }
+    NodeID GetTarget(const EdgeID edge) const { return graph.GetTarget(edge); }
+
+    const QueryGraph &graph;
+};
+
+// distance of a plain CH query, stepping both heaps with the RoutingStep of the routing plugins
+template <typename Heap>
+class CHQuery : public BasicRoutingInterface<GraphFacade, CHQuery<Heap>>
+{
+    using super = BasicRoutingInterface<GraphFacade, CHQuery<Heap>>;
+
+  public:
+    explicit CHQuery(GraphFacade *facade)
+        : super(facade), forward_heap(facade->graph.GetNumberOfNodes()),
+          reverse_heap(facade->graph.GetNumberOfNodes())
+    {
+    }
+
+    int operator()(const NodeID source, const NodeID target)
+    {
+        forward_heap.Clear();
+        reverse_heap.Clear();
+        forward_heap.Insert(source, 0, source);
+        reverse_heap.Insert(target, 0, target);
+
+        NodeID middle_node = SPECIAL_NODEID;
+        int upper_bound = std::numeric_limits<int>::max();
+        while (0 < (forward_heap.Size() + reverse_heap.Size()))
+        {
+            if (!forward_heap.Empty())
+            {
+                super::RoutingStep(forward_heap, reverse_heap, &middle_node, &upper_bound, 0,
+                                   true);
+            }
+            if (!reverse_heap.Empty())
+            {
+                super::RoutingStep(reverse_heap, forward_heap, &middle_node, &upper_bound, 0,
+                                   false);
+            }
+        }
+        return upper_bound;
+    }
+
+  private:
+    Heap forward_heap;
+    Heap reverse_heap;
+};
+
+template <typename Storage>
+void Benchmark(const std::string &name,
+               const QueryGraph &graph,
+               const std::vector<std::pair<NodeID, NodeID>> &queries)
+{
+    using Heap = BinaryHeap<NodeID, NodeID, int, HeapData, Storage>;
+    GraphFacade facade(graph);
+
+    std::cout << "#### " << name << "\n";
+
+    TIMER_START(construction);
+    CHQuery<Heap> query(&facade);
+    TIMER_STOP(construction);
+    std::cout << "Took " << TIMER_MSEC(construction) << " msec to construct the heaps."
+              << "\n";
+
+    // the checksum must be the same for all storages
+    unsigned long long checksum = 0;
+    TIMER_START(queries);
+    for (const auto &q : queries)
+    {
+        checksum += static_cast<unsigned>(query(q.first, q.second));
+    }
+    TIMER_STOP(queries);
+
+    std::cout << "Took " << TIMER_MSEC(queries) << " msec for " << queries.size() << " queries."
+              << "\n";
+    std::cout << TIMER_MSEC(queries) / static_cast<double>(queries.size()) << " msec/query."
+              << "\n";
+    std::cout << "checksum: " << checksum << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    if (argc < 2)
+    {
+        std::cout << "./heap-bench file.hsgr [number of queries]"
+                  << "\n";
+        return 1;
+    }
+    const unsigned num_queries = argc > 2 ? std::stoul(argv[2]) : 10000;
+
+    try
+    {
+        std::vector<QueryGraph::NodeArrayEntry> node_list;
+        std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+        unsigned check_sum = 0;
+        readHSGRFromStream(argv[1], node_list, edge_list, &check_sum);
+        const QueryGraph graph(node_list, edge_list);
+        SimpleLogger().Write() << "loaded graph with " << graph.GetNumberOfNodes() << " nodes";
+
+        std::mt19937 mt_rand(RANDOM_SEED);
+        std::uniform_int_distribution<NodeID> node_udist(0, graph.GetNumberOfNodes() - 1);
+        std::vector<std::pair<NodeID, NodeID>> queries;
+        for (unsigned i = 0; i < num_queries; ++i)
+        {
+            queries.emplace_back(node_udist(mt_rand), node_udist(mt_rand));
+        }
+
+        Benchmark<UnorderedMapStorage<NodeID, int>>("UnorderedMapStorage", graph, queries);
+        Benchmark<XORFastHashStorage<NodeID, int>>("XORFastHashStorage", graph, queries);
+        Benchmark<ArrayStorage<NodeID, int>>("ArrayStorage", graph, queries);
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+    return 0;
+}
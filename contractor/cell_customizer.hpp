@@ -0,0 +1,212 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CELL_CUSTOMIZER_HPP
+#define CELL_CUSTOMIZER_HPP
+
+#include "../data_structures/binary_heap.hpp"
+#include "../data_structures/cell_storage.hpp"
+#include "../data_structures/multi_level_partition.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../typedefs.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Computes the cliques of the overlay graph for the current weights.
+ *
+ * Levels are customized bottom up. The cells of a level are independent and are customized in
+ * parallel. The searches inside a cell of level l run on the overlay of level l - 1: the cliques
+ * of its subcells and the edges between them. On level 1 they run on the graph itself.
+ */
+template <class GraphT> class CellCustomizer
+{
+    struct HeapData
+    {
+        NodeID parent;
+        /* explicit */ HeapData(NodeID p) : parent(p) {}
+    };
+    using Heap = BinaryHeap<NodeID, NodeID, int, HeapData, UnorderedMapStorage<NodeID, int>>;
+    using LevelID = MultiLevelPartition::LevelID;
+    using CellID = MultiLevelPartition::CellID;
+
+  public:
+    CellCustomizer(const GraphT &graph, const MultiLevelPartition &partition)
+        : graph(graph), partition(partition)
+    {
+    }
+
+    void Customize(CellStorage &storage) const
+    {
+        tbb::enumerable_thread_specific<std::shared_ptr<Heap>> thread_heaps;
+        for (const auto level : osrm::irange<LevelID>(1, partition.GetNumberOfLevels() + 1))
+        {
+            tbb::parallel_for(tbb::blocked_range<CellID>(0, partition.GetNumberOfCells(level)),
+                              [&](const tbb::blocked_range<CellID> &range)
+                              {
+                                  bool exists = false;
+                                  auto &heap = thread_heaps.local(exists);
+                                  if (!exists)
+                                  {
+                                      heap = std::make_shared<Heap>(graph.GetNumberOfNodes());
+                                  }
+                                  for (const auto cell : osrm::irange(range.begin(), range.end()))
+                                  {
+                                      CustomizeCell(storage, *heap, level, cell);
+                                  }
+                              });
+        }
+    }
+
+  private:
+    void CustomizeCell(CellStorage &storage,
+                       Heap &heap,
+                       const LevelID level,
+                       const CellID cell_id) const
+    {
+        auto cell = storage.GetCell(level, cell_id);
+        for (const auto source_index : osrm::irange(0u, cell.GetNumberOfSources()))
+        {
+            const NodeID source = cell.GetSource(source_index);
+            heap.Clear();
+            heap.Insert(source, 0, source);
+            while (!heap.Empty())
+            {
+                const NodeID node = heap.DeleteMin();
+                const int distance = heap.GetKey(node);
+                RelaxInsideCell(storage, heap, level, cell_id, node, distance);
+            }
+
+            for (const auto destination_index : osrm::irange(0u, cell.GetNumberOfDestinations()))
+            {
+                const NodeID destination = cell.GetDestination(destination_index);
+                cell.GetWeight(source_index, destination_index) =
+                    heap.WasInserted(destination) ? heap.GetKey(destination)
+                                                  : INVALID_EDGE_WEIGHT;
+            }
+        }
+    }
+
+    void RelaxInsideCell(const CellStorage &storage,
+                         Heap &heap,
+                         const LevelID level,
+                         const CellID cell_id,
+                         const NodeID node,
+                         const int distance) const
+    {
+        const LevelID sublevel = level - 1;
+        if (sublevel > 0)
+        {
+            const auto subcell = storage.GetCell(sublevel, partition.GetCell(sublevel, node));
+            const unsigned source_index = subcell.GetSourceIndex(node);
+            if (source_index < subcell.GetNumberOfSources())
+            {
+                for (const auto destination_index :
+                     osrm::irange(0u, subcell.GetNumberOfDestinations()))
+                {
+                    const EdgeWeight weight = subcell.GetWeight(source_index, destination_index);
+                    if (INVALID_EDGE_WEIGHT != weight)
+                    {
+                        Relax(heap, node, subcell.GetDestination(destination_index),
+                              distance + weight);
+                    }
+                }
+            }
+        }
+
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            if (!data.forward)
+            {
+                continue;
+            }
+            const NodeID target = graph.GetTarget(edge);
+            if (partition.GetCell(level, target) != cell_id)
+            {
+                continue;
+            }
+            // paths inside a subcell are covered by its clique
+            if (sublevel > 0 &&
+                partition.GetCell(sublevel, target) == partition.GetCell(sublevel, node))
+            {
+                continue;
+            }
+            Relax(heap, node, target, distance + data.distance);
+        }
+    }
+
+    static void Relax(Heap &heap, const NodeID node, const NodeID target, const int to_distance)
+    {
+        if (!heap.WasInserted(target))
+        {
+            heap.Insert(target, to_distance, node);
+        }
+        else if (to_distance < heap.GetKey(target))
+        {
+            heap.GetData(target).parent = node;
+            heap.DecreaseKey(target, to_distance);
+        }
+    }
+
+    const GraphT &graph;
+    const MultiLevelPartition &partition;
+};
+
+/**
+ * Customizes the overlay of the partition for the weights of the graph and writes it. The file
+ * starts with the checksum of the .hsgr, the overlay is only valid for the same weights.
+ */
+template <class GraphT>
+void WriteCustomizedCells(const GraphT &graph,
+                          const MultiLevelPartition &partition,
+                          const unsigned graph_checksum,
+                          const boost::filesystem::path &cells_path)
+{
+    TIMER_START(customization);
+    CellStorage storage(partition, graph);
+    CellCustomizer<GraphT>(graph, partition).Customize(storage);
+    TIMER_STOP(customization);
+    SimpleLogger().Write() << "Customized " << partition.GetNumberOfLevels() << " levels in "
+                           << TIMER_SEC(customization) << " sec";
+
+    boost::filesystem::ofstream cells_output_stream(cells_path, std::ios::binary);
+    cells_output_stream.write((char *)&graph_checksum, sizeof(unsigned));
+    cells_output_stream << storage;
+}
+
+#endif // CELL_CUSTOMIZER_HPP
@@ -31,12 +31,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/binary_heap.hpp"
 #include "../data_structures/deallocating_vector.hpp"
 #include "../data_structures/dynamic_graph.hpp"
+#include "../data_structures/import_edge.hpp"
 #include "../data_structures/percent.hpp"
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/xor_fast_hash.hpp"
 #include "../data_structures/xor_fast_hash_storage.hpp"
 #include "../util/integer_range.hpp"
+#include "../util/memory_usage.hpp"
+#include "../util/fingerprint.hpp"
+#include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
+#include "../util/std_hash.hpp"
 #include "../util/timing_util.hpp"
 #include "../typedefs.h"
 
@@ -49,7 +54,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <tbb/parallel_sort.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
 #include <vector>
 
 class Contractor
@@ -104,7 +115,16 @@ class Contractor
         ContractorHeap heap;
         std::vector<ContractorEdge> inserted_edges;
         std::vector<NodeID> neighbours;
-        explicit ContractorThreadData(NodeID nodes) : heap(nodes) {}
+        // counters of the witness searches and deletions of this thread, see CollectCounters()
+        std::uint64_t witness_searches;
+        std::uint64_t witness_settled_nodes;
+        std::uint64_t witness_limit_hits;
+        std::uint64_t deleted_edges;
+        explicit ContractorThreadData(NodeID nodes)
+            : heap(nodes), witness_searches(0), witness_settled_nodes(0), witness_limit_hits(0),
+              deleted_edges(0)
+        {
+        }
     };
 
     struct NodePriorityData
@@ -133,6 +153,25 @@ class Contractor
         bool is_independent : 1;
     };
 
+    // everything Run() needs to continue after the last finished round
+    struct CheckpointState
+    {
+        CheckpointState()
+            : number_of_nodes(0), number_of_contracted_nodes(0), current_level(0.f),
+              flushed_contractor(false), use_cached_node_levels(false), core_factor(1.0)
+        {
+        }
+        NodeID number_of_nodes;
+        NodeID number_of_contracted_nodes;
+        float current_level;
+        bool flushed_contractor;
+        bool use_cached_node_levels;
+        double core_factor;
+        std::vector<RemainingNodeData> remaining_nodes;
+        std::vector<float> node_priorities;
+        std::vector<NodePriorityData> node_data;
+    };
+
     struct ThreadDataContainer
     {
         explicit ThreadDataContainer(int number_of_nodes) : number_of_nodes(number_of_nodes) {}
@@ -156,108 +195,167 @@ class Contractor
     };
 
   public:
+    struct WitnessStatistics
+    {
+        WitnessStatistics() : searches(0), settled_nodes(0), limit_hits(0) {}
+        std::uint64_t searches;
+        std::uint64_t settled_nodes;
+        // searches stopped by the limit of settled nodes before all targets were found
+        std::uint64_t limit_hits;
+    };
+
+    // what happened in one round of Run(), times are in seconds
+    struct RoundStatistics
+    {
+        RoundStatistics()
+            : round(0), remaining_nodes(0), independent_nodes(0), shortcuts_added(0),
+              shortcuts_updated(0), edges_deleted(0), graph_edges(0), resident_set_size(0),
+              independent_set_time(0), contract_time(0), delete_time(0), insert_time(0),
+              update_time(0)
+        {
+        }
+        unsigned round;
+        NodeID remaining_nodes;
+        NodeID independent_nodes;
+        std::uint64_t shortcuts_added;
+        std::uint64_t shortcuts_updated;
+        std::uint64_t edges_deleted;
+        // searches while contracting and while updating the priorities of the neighbours
+        WitnessStatistics contract_witness;
+        WitnessStatistics update_witness;
+        std::uint64_t graph_edges;
+        // in bytes, 0 where the platform does not tell
+        std::uint64_t resident_set_size;
+        double independent_set_time;
+        double contract_time;
+        double delete_time;
+        double insert_time;
+        double update_time;
+    };
+
     template <class ContainerT> Contractor(int nodes, ContainerT &input_edge_list)
+        : Contractor(nodes, input_edge_list, std::vector<float>())
     {
-        std::vector<ContractorEdge> edges;
-        edges.reserve(input_edge_list.size() * 2);
+    }
 
-        const auto dend = input_edge_list.dend();
-        for (auto diter = input_edge_list.dbegin(); diter != dend; ++diter)
+    // If node levels of an earlier run are given, the nodes are contracted in that order instead
+    // of evaluating their priorities. This only works for the same graph with different weights.
+    template <class ContainerT>
+    Contractor(int nodes, ContainerT &input_edge_list, std::vector<float> &&node_levels)
+        : node_levels(std::move(node_levels)), input_checksum(InputChecksum(input_edge_list))
+    {
+        // Parallel edges and edges in opposite directions are merged on the input itself. Both
+        // directions of an edge are stored with the smaller node id as source, sorting brings
+        // them next to each other.
+        for (auto &input_edge : input_edge_list)
         {
-            BOOST_ASSERT_MSG(static_cast<unsigned int>(std::max(diter->weight, 1)) > 0,
-                             "edge distance < 1");
-#ifndef NDEBUG
-            if (static_cast<unsigned int>(std::max(diter->weight, 1)) > 24 * 60 * 60 * 10)
+            if (input_edge.source > input_edge.target)
             {
-                SimpleLogger().Write(logWARNING)
-                    << "Edge weight large -> "
-                    << static_cast<unsigned int>(std::max(diter->weight, 1)) << " : "
-                    << static_cast<unsigned int>(diter->source) << " -> " << static_cast<unsigned int>(diter->target);
+                std::swap(input_edge.source, input_edge.target);
+                const bool forward = input_edge.forward;
+                input_edge.forward = input_edge.backward;
+                input_edge.backward = forward;
             }
-#endif
-            edges.emplace_back(diter->source, diter->target,
-                               static_cast<unsigned int>(std::max(diter->weight, 1)), 1,
-                               diter->edge_id, false, diter->forward ? true : false,
-                               diter->backward ? true : false);
-
-            edges.emplace_back(diter->target, diter->source,
-                               static_cast<unsigned int>(std::max(diter->weight, 1)), 1,
-                               diter->edge_id, false, diter->backward ? true : false,
-                               diter->forward ? true : false);
         }
-        // clear input vector
-        input_edge_list.clear();
-        // FIXME not sure if we need this
-        edges.shrink_to_fit();
-
-        tbb::parallel_sort(edges.begin(), edges.end());
-        NodeID edge = 0;
-        for (NodeID i = 0; i < edges.size();)
+        tbb::parallel_sort(input_edge_list.begin(), input_edge_list.end(),
+                           [](const EdgeBasedEdge &lhs, const EdgeBasedEdge &rhs)
+                           {
+                               return std::tie(lhs.source, lhs.target) <
+                                      std::tie(rhs.source, rhs.target);
+                           });
+
+        const std::size_t number_of_input_edges = input_edge_list.size();
+        std::size_t edge = 0;
+        for (std::size_t i = 0; i < number_of_input_edges;)
         {
-            const NodeID source = edges[i].source;
-            const NodeID target = edges[i].target;
-            const NodeID id = edges[i].data.id;
+            const NodeID source = input_edge_list[i].source;
+            const NodeID target = input_edge_list[i].target;
+            const NodeID id = input_edge_list[i].edge_id;
             // remove eigenloops
             if (source == target)
             {
                 ++i;
                 continue;
             }
-            ContractorEdge forward_edge;
-            ContractorEdge reverse_edge;
-            forward_edge.source = reverse_edge.source = source;
-            forward_edge.target = reverse_edge.target = target;
-            forward_edge.data.forward = reverse_edge.data.backward = true;
-            forward_edge.data.backward = reverse_edge.data.forward = false;
-            forward_edge.data.shortcut = reverse_edge.data.shortcut = false;
-            forward_edge.data.id = reverse_edge.data.id = id;
-            forward_edge.data.originalEdges = reverse_edge.data.originalEdges = 1;
-            forward_edge.data.distance = reverse_edge.data.distance =
-                std::numeric_limits<int>::max();
+            int forward_distance = std::numeric_limits<int>::max();
+            int reverse_distance = std::numeric_limits<int>::max();
             // remove parallel edges
-            while (i < edges.size() && edges[i].source == source && edges[i].target == target)
+            while (i < number_of_input_edges && input_edge_list[i].source == source &&
+                   input_edge_list[i].target == target)
             {
-                if (edges[i].data.forward)
+                BOOST_ASSERT_MSG(std::max(input_edge_list[i].weight, 1) > 0, "edge distance < 1");
+#ifndef NDEBUG
+                if (std::max(input_edge_list[i].weight, 1) > 24 * 60 * 60 * 10)
+                {
+                    SimpleLogger().Write(logWARNING)
+                        << "Edge weight large -> " << std::max(input_edge_list[i].weight, 1)
+                        << " : " << source << " -> " << target;
+                }
+#endif
+                const int distance = std::max(input_edge_list[i].weight, 1);
+                if (input_edge_list[i].forward)
                 {
-                    forward_edge.data.distance =
-                        std::min(edges[i].data.distance, forward_edge.data.distance);
+                    forward_distance = std::min(distance, forward_distance);
                 }
-                if (edges[i].data.backward)
+                if (input_edge_list[i].backward)
                 {
-                    reverse_edge.data.distance =
-                        std::min(edges[i].data.distance, reverse_edge.data.distance);
+                    reverse_distance = std::min(distance, reverse_distance);
                 }
                 ++i;
             }
             // merge edges (s,t) and (t,s) into bidirectional edge
-            if (forward_edge.data.distance == reverse_edge.data.distance)
+            if (forward_distance == reverse_distance)
             {
-                if ((int)forward_edge.data.distance != std::numeric_limits<int>::max())
+                if (forward_distance != std::numeric_limits<int>::max())
                 {
-                    forward_edge.data.backward = true;
-                    edges[edge++] = forward_edge;
+                    input_edge_list[edge++] =
+                        EdgeBasedEdge(source, target, id, forward_distance, true, true);
                 }
             }
             else
             { // insert seperate edges
-                if (((int)forward_edge.data.distance) != std::numeric_limits<int>::max())
+                if (forward_distance != std::numeric_limits<int>::max())
                 {
-                    edges[edge++] = forward_edge;
+                    input_edge_list[edge++] =
+                        EdgeBasedEdge(source, target, id, forward_distance, true, false);
                 }
-                if ((int)reverse_edge.data.distance != std::numeric_limits<int>::max())
+                if (reverse_distance != std::numeric_limits<int>::max())
                 {
-                    edges[edge++] = reverse_edge;
+                    input_edge_list[edge++] =
+                        EdgeBasedEdge(source, target, id, reverse_distance, false, true);
                 }
             }
         }
-        std::cout << "merged " << edges.size() - edge << " edges out of " << edges.size()
-                  << std::endl;
-        edges.resize(edge);
-        contractor_graph = std::make_shared<ContractorGraph>(nodes, edges);
-        edges.clear();
-        edges.shrink_to_fit();
+        std::cout << "merged " << number_of_input_edges - edge << " edges out of "
+                  << number_of_input_edges << std::endl;
+        input_edge_list.resize(edge);
+
+        // Every edge is stored at both of its nodes. The adjacency blocks are sized exactly, so
+        // the graph is filled without an intermediate copy of all edges.
+        {
+            std::vector<unsigned> node_degrees(nodes, 0);
+            for (const auto &input_edge : input_edge_list)
+            {
+                ++node_degrees[input_edge.source];
+                ++node_degrees[input_edge.target];
+            }
+            contractor_graph = std::make_shared<ContractorGraph>(nodes, node_degrees);
+        }
+        const auto dend = input_edge_list.dend();
+        for (auto diter = input_edge_list.dbegin(); diter != dend; ++diter)
+        {
+            contractor_graph->InsertEdge(diter->source, diter->target,
+                                         ContractorEdgeData(diter->weight, 1, diter->edge_id,
+                                                            false, diter->forward,
+                                                            diter->backward));
+            contractor_graph->InsertEdge(diter->target, diter->source,
+                                         ContractorEdgeData(diter->weight, 1, diter->edge_id,
+                                                            false, diter->backward,
+                                                            diter->forward));
+        }
+        // clear input vector
+        input_edge_list.clear();
 
-        BOOST_ASSERT(0 == edges.capacity());
         //        unsigned maxdegree = 0;
         //        NodeID highestNode = 0;
         //
@@ -282,9 +380,61 @@ class Contractor
         std::cout << "contractor finished initalization" << std::endl;
     }
 
+    // Continues a contraction that was interrupted after writing the checkpoint, see
+    // EnableCheckpoints(). Run() picks up with the round after the checkpoint and refuses a core
+    // factor other than the one of the interrupted run.
+    explicit Contractor(const std::string &checkpoint_path)
+        : checkpoint_state(std::make_shared<CheckpointState>())
+    {
+        ReadCheckpoint(checkpoint_path);
+    }
+
     ~Contractor() {}
 
-    void Run()
+    // Run() writes its state to path after the flush and every interval rounds, only after the
+    // flush if interval is 0. Edges moved out of the graph by the flush go to path + ".external".
+    void EnableCheckpoints(const std::string &path, const unsigned interval)
+    {
+        checkpoint_path = path;
+        checkpoint_interval = interval;
+    }
+
+    // Checksum of an edge list that does not depend on the order of the edges. A checkpoint
+    // stores the one of the input it was written for, see GetInputChecksum().
+    template <class ContainerT> static std::uint64_t InputChecksum(ContainerT &input_edge_list)
+    {
+        std::uint64_t checksum = 0;
+        for (const auto &input_edge : input_edge_list)
+        {
+            const EdgeWeight weight = input_edge.weight;
+            const bool forward = input_edge.forward;
+            const bool backward = input_edge.backward;
+            checksum += hash_val(input_edge.source, input_edge.target, input_edge.edge_id, weight,
+                                 forward, backward);
+        }
+        return checksum;
+    }
+
+    // checksum of the edge list the contraction started with, also when resumed from a checkpoint
+    std::uint64_t GetInputChecksum() const { return input_checksum; }
+
+    // number of nodes of the graph the contraction started with
+    NodeID GetNumberOfInputNodes() const
+    {
+        return checkpoint_state ? checkpoint_state->number_of_nodes
+                                : contractor_graph->GetNumberOfNodes();
+    }
+
+    // one entry for every round of the last Run()
+    const std::vector<RoundStatistics> &GetRoundStatistics() const { return round_statistics; }
+
+    bool UsesCachedNodeLevels() const
+    {
+        return checkpoint_state ? checkpoint_state->use_cached_node_levels : !node_levels.empty();
+    }
+
+    // contracts nodes until core_factor of them are contracted, the rest stays the core
+    void Run(double core_factor = 1.0)
     {
         // for the preperation we can use a big grain size, which is much faster (probably cache)
         constexpr size_t InitGrainSize = 100000;
@@ -297,43 +447,95 @@ class Contractor
         constexpr size_t NeighboursGrainSize = 1;
         constexpr size_t DeleteGrainSize = 1;
 
-        const NodeID number_of_nodes = contractor_graph->GetNumberOfNodes();
+        const NodeID number_of_nodes = GetNumberOfInputNodes();
         Percent p(number_of_nodes);
 
-        ThreadDataContainer thread_data_list(number_of_nodes);
+        const bool use_cached_node_levels = UsesCachedNodeLevels();
+        BOOST_ASSERT(!use_cached_node_levels || node_levels.size() == number_of_nodes);
+
+        // the graph has fewer nodes than the input if the checkpoint was written after the flush
+        ThreadDataContainer thread_data_list(contractor_graph->GetNumberOfNodes());
 
         NodeID number_of_contracted_nodes = 0;
-        std::vector<RemainingNodeData> remaining_nodes(number_of_nodes);
-        std::vector<float> node_priorities(number_of_nodes);
-        std::vector<NodePriorityData> node_data(number_of_nodes);
-
-        // initialize priorities in parallel
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
-                          [&remaining_nodes](const tbb::blocked_range<int> &range)
-                          {
-                              for (int x = range.begin(); x != range.end(); ++x)
-                              {
-                                  remaining_nodes[x].id = x;
-                              }
-                          });
-
-        std::cout << "initializing elimination PQ ..." << std::flush;
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
-                          [this, &node_priorities, &node_data, &thread_data_list](
-                              const tbb::blocked_range<int> &range)
-                          {
-                              ContractorThreadData *data = thread_data_list.getThreadData();
-                              for (int x = range.begin(); x != range.end(); ++x)
+        std::vector<RemainingNodeData> remaining_nodes;
+        std::vector<float> node_priorities;
+        std::vector<NodePriorityData> node_data;
+        float current_level = 0.f;
+        bool flushed_contractor = false;
+
+        if (checkpoint_state)
+        {
+            // a different core factor would have stopped at a different round
+            if (checkpoint_state->core_factor != core_factor)
+            {
+                throw osrm::exception("checkpoint was written with core factor " +
+                                      std::to_string(checkpoint_state->core_factor) + ", not " +
+                                      std::to_string(core_factor));
+            }
+            number_of_contracted_nodes = checkpoint_state->number_of_contracted_nodes;
+            current_level = checkpoint_state->current_level;
+            flushed_contractor = checkpoint_state->flushed_contractor;
+            remaining_nodes.swap(checkpoint_state->remaining_nodes);
+            node_priorities.swap(checkpoint_state->node_priorities);
+            node_data.swap(checkpoint_state->node_data);
+            checkpoint_state.reset();
+            std::cout << "resuming with " << number_of_contracted_nodes << " of "
+                      << number_of_nodes << " nodes contracted ..." << std::flush;
+        }
+        else
+        {
+            remaining_nodes.resize(number_of_nodes);
+
+            // initialize priorities in parallel
+            tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
+                              [&remaining_nodes](const tbb::blocked_range<int> &range)
                               {
-                                  node_priorities[x] =
-                                      this->EvaluateNodePriority(data, &node_data[x], x);
-                              }
-                          });
+                                  for (int x = range.begin(); x != range.end(); ++x)
+                                  {
+                                      remaining_nodes[x].id = x;
+                                  }
+                              });
+
+            if (0 == static_cast<NodeID>(number_of_nodes * core_factor))
+            {
+                // nothing is contracted, the whole graph stays the core and needs no priorities
+                node_levels.resize(number_of_nodes, 0.f);
+            }
+            else if (use_cached_node_levels)
+            {
+                // the levels of the last run are the priorities, they are never updated
+                std::cout << "using cached node levels ..." << std::flush;
+                node_priorities = node_levels;
+                node_data.resize(number_of_nodes);
+            }
+            else
+            {
+                std::cout << "initializing elimination PQ ..." << std::flush;
+                node_priorities.resize(number_of_nodes);
+                node_data.resize(number_of_nodes);
+                tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
+                                  [this, &node_priorities, &node_data, &thread_data_list](
+                                      const tbb::blocked_range<int> &range)
+                                  {
+                                      ContractorThreadData *data =
+                                          thread_data_list.getThreadData();
+                                      for (int x = range.begin(); x != range.end(); ++x)
+                                      {
+                                          node_priorities[x] =
+                                              this->EvaluateNodePriority(data, &node_data[x], x);
+                                      }
+                                  });
+                // records the round in which each node is contracted
+                node_levels.resize(number_of_nodes, 0.f);
+            }
+        }
         std::cout << "ok" << std::endl << "preprocessing " << number_of_nodes << " nodes ..."
                   << std::flush;
 
-        bool flushed_contractor = false;
-        while (number_of_nodes > 2 && number_of_contracted_nodes < number_of_nodes)
+        unsigned rounds_since_checkpoint = 0;
+        bool checkpoint_due = false;
+        while (number_of_nodes > 2 &&
+               number_of_contracted_nodes < static_cast<NodeID>(number_of_nodes * core_factor))
         {
             if (!flushed_contractor && (number_of_contracted_nodes > (number_of_nodes * 0.65)))
             {
@@ -353,6 +555,8 @@ class Contractor
                 // this map gives the new IDs from the old ones, necessary to remap targets from the
                 // remaining graph
                 std::vector<NodeID> new_node_id_from_orig_id_map(number_of_nodes, UINT_MAX);
+                // sizes of the adjacency blocks of the new graph
+                std::vector<unsigned> new_node_degrees(remaining_nodes.size(), 0);
 
                 // build forward and backward renumbering map and remap ids in remaining_nodes and
                 // Priorities.
@@ -393,6 +597,7 @@ class Contractor
                             BOOST_ASSERT_MSG(UINT_MAX != new_node_id_from_orig_id_map[target],
                                              "new target id not resolveable");
                             new_edge_set.push_back(new_edge);
+                            ++new_node_degrees[new_edge.source];
                         }
                     }
                 }
@@ -409,10 +614,16 @@ class Contractor
                 // old Graph is removed
                 contractor_graph.reset();
 
-                // create new graph
-                std::sort(new_edge_set.begin(), new_edge_set.end());
+                // create new graph, the edge set is deallocated while it is copied
                 contractor_graph =
-                    std::make_shared<ContractorGraph>(remaining_nodes.size(), new_edge_set);
+                    std::make_shared<ContractorGraph>(remaining_nodes.size(), new_node_degrees);
+                new_node_degrees.clear();
+                new_node_degrees.shrink_to_fit();
+                const auto new_edge_set_end = new_edge_set.dend();
+                for (auto diter = new_edge_set.dbegin(); diter != new_edge_set_end; ++diter)
+                {
+                    contractor_graph->InsertEdge(diter->source, diter->target, diter->data);
+                }
 
                 new_edge_set.clear();
                 flushed_contractor = true;
@@ -420,8 +631,35 @@ class Contractor
                 // INFO: MAKE SURE THIS IS THE LAST OPERATION OF THE FLUSH!
                 // reinitialize heaps and ThreadData objects with appropriate size
                 thread_data_list.number_of_nodes = contractor_graph->GetNumberOfNodes();
+
+                // the flush is the natural point for a checkpoint, the graph is smallest here
+                if (!checkpoint_path.empty())
+                {
+                    WriteExternalEdges(checkpoint_path + ".external");
+                    checkpoint_due = true;
+                }
+            }
+
+            if (checkpoint_due ||
+                (checkpoint_interval > 0 && rounds_since_checkpoint >= checkpoint_interval))
+            {
+                std::cout << " [checkpoint " << number_of_contracted_nodes << " nodes] "
+                          << std::flush;
+                WriteCheckpoint(number_of_nodes, number_of_contracted_nodes, current_level,
+                                flushed_contractor, use_cached_node_levels, core_factor,
+                                remaining_nodes, node_priorities, node_data);
+                rounds_since_checkpoint = 0;
+                checkpoint_due = false;
             }
+            ++rounds_since_checkpoint;
+
+            RoundStatistics statistics;
+            statistics.round = static_cast<unsigned>(current_level);
+            statistics.remaining_nodes = static_cast<NodeID>(remaining_nodes.size());
+            // discard what the searches of earlier phases counted
+            CollectCounters(thread_data_list);
 
+            TIMER_START(independent_set);
             const int last = (int)remaining_nodes.size();
             tbb::parallel_for(tbb::blocked_range<int>(0, last, IndependentGrainSize),
                               [this, &node_priorities, &remaining_nodes, &thread_data_list](
@@ -443,19 +681,33 @@ class Contractor
                                                     return !node_data.is_independent;
                                                 });
             const int first_independent_node = static_cast<int>(first - remaining_nodes.begin());
+            TIMER_STOP(independent_set);
+            statistics.independent_set_time = TIMER_SEC(independent_set);
+            statistics.independent_nodes = last - first_independent_node;
 
             // contract independent nodes
+            TIMER_START(contract);
             tbb::parallel_for(
                 tbb::blocked_range<int>(first_independent_node, last, ContractGrainSize),
-                [this, &remaining_nodes, &thread_data_list](const tbb::blocked_range<int> &range)
+                [this, &remaining_nodes, &thread_data_list, use_cached_node_levels,
+                 current_level](const tbb::blocked_range<int> &range)
                 {
                     ContractorThreadData *data = thread_data_list.getThreadData();
                     for (int position = range.begin(); position != range.end(); ++position)
                     {
                         const NodeID x = remaining_nodes[position].id;
                         this->ContractNode<false>(data, x);
+                        if (!use_cached_node_levels)
+                        {
+                            // node ids are renumbered after the flush
+                            const NodeID original_id = orig_node_id_to_new_id_map.empty()
+                                                           ? x
+                                                           : orig_node_id_to_new_id_map[x];
+                            node_levels[original_id] = current_level;
+                        }
                     }
                 });
+            current_level += 1.f;
             // make sure we really sort each block
             tbb::parallel_for(
                 thread_data_list.data.range(),
@@ -464,6 +716,11 @@ class Contractor
                     for (auto &data : range)
                         std::sort(data->inserted_edges.begin(), data->inserted_edges.end());
                 });
+            TIMER_STOP(contract);
+            statistics.contract_time = TIMER_SEC(contract);
+            statistics.contract_witness = CollectCounters(thread_data_list);
+
+            TIMER_START(delete_edges);
             tbb::parallel_for(
                 tbb::blocked_range<int>(first_independent_node, last, DeleteGrainSize),
                 [this, &remaining_nodes, &thread_data_list](const tbb::blocked_range<int> &range)
@@ -475,49 +732,120 @@ class Contractor
                         this->DeleteIncomingEdges(data, x);
                     }
                 });
-
-            // insert new edges
+            TIMER_STOP(delete_edges);
+            statistics.delete_time = TIMER_SEC(delete_edges);
             for (auto &data : thread_data_list.data)
             {
-                for (const ContractorEdge &edge : data->inserted_edges)
+                statistics.edges_deleted += data->deleted_edges;
+                data->deleted_edges = 0;
+            }
+
+            // insert new edges, the sorted buffers of all threads are walked side by side so that
+            // each node makes room for all of its new edges at once
+            TIMER_START(insert);
+            using InsertedEdgeIterator = std::vector<ContractorEdge>::const_iterator;
+            std::vector<std::pair<InsertedEdgeIterator, InsertedEdgeIterator>> buffers;
+            for (const auto &data : thread_data_list.data)
+            {
+                buffers.emplace_back(data->inserted_edges.cbegin(), data->inserted_edges.cend());
+            }
+            std::vector<InsertedEdgeIterator> buffer_source_ends(buffers.size());
+            while (true)
+            {
+                NodeID source = SPECIAL_NODEID;
+                for (const auto &buffer : buffers)
                 {
-                    const EdgeID current_edge_ID =
-                        contractor_graph->FindEdge(edge.source, edge.target);
-                    if (current_edge_ID < contractor_graph->EndEdges(edge.source))
+                    if (buffer.first != buffer.second)
                     {
-                        ContractorGraph::EdgeData &current_data =
-                            contractor_graph->GetEdgeData(current_edge_ID);
-                        if (current_data.shortcut && edge.data.forward == current_data.forward &&
-                            edge.data.backward == current_data.backward &&
-                            edge.data.distance < current_data.distance)
+                        source = std::min(source, buffer.first->source);
+                    }
+                }
+                if (SPECIAL_NODEID == source)
+                {
+                    break;
+                }
+
+                unsigned number_of_new_edges = 0;
+                for (const auto i : osrm::irange<std::size_t>(0, buffers.size()))
+                {
+                    buffer_source_ends[i] =
+                        std::find_if(buffers[i].first, buffers[i].second,
+                                     [source](const ContractorEdge &edge)
+                                     {
+                                         return edge.source != source;
+                                     });
+                    number_of_new_edges += buffer_source_ends[i] - buffers[i].first;
+                }
+                contractor_graph->ReserveEdges(source, number_of_new_edges);
+
+                for (const auto i : osrm::irange<std::size_t>(0, buffers.size()))
+                {
+                    for (; buffers[i].first != buffer_source_ends[i]; ++buffers[i].first)
+                    {
+                        const ContractorEdge &edge = *buffers[i].first;
+                        const EdgeID current_edge_ID =
+                            contractor_graph->FindEdge(edge.source, edge.target);
+                        if (current_edge_ID < contractor_graph->EndEdges(edge.source))
                         {
-                            // found a duplicate edge with smaller weight, update it.
-                            current_data = edge.data;
-                            continue;
+                            ContractorGraph::EdgeData &current_data =
+                                contractor_graph->GetEdgeData(current_edge_ID);
+                            if (current_data.shortcut &&
+                                edge.data.forward == current_data.forward &&
+                                edge.data.backward == current_data.backward &&
+                                edge.data.distance < current_data.distance)
+                            {
+                                // found a duplicate edge with smaller weight, update it.
+                                current_data = edge.data;
+                                ++statistics.shortcuts_updated;
+                                continue;
+                            }
                         }
+                        contractor_graph->InsertEdge(edge.source, edge.target, edge.data);
+                        ++statistics.shortcuts_added;
                     }
-                    contractor_graph->InsertEdge(edge.source, edge.target, edge.data);
                 }
+            }
+            for (auto &data : thread_data_list.data)
+            {
                 data->inserted_edges.clear();
             }
+            // nodes that outgrew their blocks leave holes the pool cannot always fill
+            if (contractor_graph->GetNumberOfFreeSlots() > contractor_graph->GetNumberOfEdges() / 8)
+            {
+                contractor_graph->Compact();
+            }
+            TIMER_STOP(insert);
+            statistics.insert_time = TIMER_SEC(insert);
 
-            tbb::parallel_for(
-                tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
-                [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list](
-                    const tbb::blocked_range<int> &range)
-                {
-                    ContractorThreadData *data = thread_data_list.getThreadData();
-                    for (int position = range.begin(); position != range.end(); ++position)
+            // cached levels stay fixed, there is nothing to update
+            TIMER_START(update);
+            if (!use_cached_node_levels)
+            {
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
+                    [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list](
+                        const tbb::blocked_range<int> &range)
                     {
-                        NodeID x = remaining_nodes[position].id;
-                        this->UpdateNodeNeighbours(node_priorities, node_data, data, x);
-                    }
-                });
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int position = range.begin(); position != range.end(); ++position)
+                        {
+                            NodeID x = remaining_nodes[position].id;
+                            this->UpdateNodeNeighbours(node_priorities, node_data, data, x);
+                        }
+                    });
+            }
+            TIMER_STOP(update);
+            statistics.update_time = TIMER_SEC(update);
+            statistics.update_witness = CollectCounters(thread_data_list);
 
             // remove contracted nodes from the pool
             number_of_contracted_nodes += last - first_independent_node;
             remaining_nodes.resize(first_independent_node);
             remaining_nodes.shrink_to_fit();
+
+            statistics.graph_edges = contractor_graph->GetNumberOfEdges();
+            statistics.resident_set_size = ResidentMemory();
+            round_statistics.push_back(statistics);
             //            unsigned maxdegree = 0;
             //            unsigned avgdegree = 0;
             //            unsigned mindegree = UINT_MAX;
@@ -546,9 +874,36 @@ class Contractor
             p.printStatus(number_of_contracted_nodes);
         }
 
+        if (!remaining_nodes.empty())
+        {
+            std::cout << " [core: " << remaining_nodes.size() << " nodes] " << std::flush;
+            is_core_node.resize(number_of_nodes, false);
+            for (const RemainingNodeData &node : remaining_nodes)
+            {
+                const NodeID original_id = orig_node_id_to_new_id_map.empty()
+                                               ? node.id
+                                               : orig_node_id_to_new_id_map[node.id];
+                is_core_node[original_id] = true;
+                // the core is above every contracted node
+                if (!use_cached_node_levels)
+                {
+                    node_levels[original_id] = current_level;
+                }
+            }
+        }
+
         thread_data_list.data.clear();
     }
 
+    // marks the nodes left uncontracted by Run(), empty if every node was contracted
+    inline void GetCoreMarker(std::vector<bool> &out_is_core_node)
+    {
+        out_is_core_node.swap(is_core_node);
+    }
+
+    // the round in which each node was contracted, by the ids of the input graph
+    inline void GetNodeLevels(std::vector<float> &levels) { levels.swap(node_levels); }
+
     template <class Edge> inline void GetEdges(DeallocatingVector<Edge> &edges)
     {
         Percent p(contractor_graph->GetNumberOfNodes());
@@ -605,6 +960,174 @@ class Contractor
     }
 
   private:
+    // sums and resets the witness search counters of all threads
+    static WitnessStatistics CollectCounters(ThreadDataContainer &thread_data_list)
+    {
+        WitnessStatistics statistics;
+        for (auto &data : thread_data_list.data)
+        {
+            statistics.searches += data->witness_searches;
+            statistics.settled_nodes += data->witness_settled_nodes;
+            statistics.limit_hits += data->witness_limit_hits;
+            data->witness_searches = 0;
+            data->witness_settled_nodes = 0;
+            data->witness_limit_hits = 0;
+        }
+        return statistics;
+    }
+
+    template <typename T> static void WriteVector(std::ostream &out, const std::vector<T> &vector)
+    {
+        const std::uint64_t size = vector.size();
+        out.write((char *)&size, sizeof(std::uint64_t));
+        if (size > 0)
+        {
+            out.write((char *)vector.data(), sizeof(T) * size);
+        }
+    }
+
+    template <typename T> static void ReadVector(std::istream &in, std::vector<T> &vector)
+    {
+        std::uint64_t size = 0;
+        in.read((char *)&size, sizeof(std::uint64_t));
+        vector.resize(size);
+        if (size > 0)
+        {
+            in.read((char *)vector.data(), sizeof(T) * size);
+        }
+    }
+
+    // written once, the edges of contracted nodes do not change after the flush
+    void WriteExternalEdges(const std::string &path) const
+    {
+        const std::string temporary_path = path + ".tmp";
+        {
+            std::ofstream out(temporary_path, std::ios::binary);
+            const std::uint64_t size = external_edge_list.size();
+            out.write((char *)&size, sizeof(std::uint64_t));
+            for (const QueryEdge &edge : external_edge_list)
+            {
+                out.write((char *)&edge, sizeof(QueryEdge));
+            }
+            if (!out)
+            {
+                throw osrm::exception("could not write " + temporary_path);
+            }
+        }
+        if (0 != std::rename(temporary_path.c_str(), path.c_str()))
+        {
+            throw osrm::exception("could not write " + path);
+        }
+    }
+
+    // the checkpoint replaces the last one only once it is complete
+    void WriteCheckpoint(const NodeID number_of_nodes,
+                         const NodeID number_of_contracted_nodes,
+                         const float current_level,
+                         const bool flushed_contractor,
+                         const bool use_cached_node_levels,
+                         const double core_factor,
+                         const std::vector<RemainingNodeData> &remaining_nodes,
+                         const std::vector<float> &node_priorities,
+                         const std::vector<NodePriorityData> &node_data) const
+    {
+        const std::string temporary_path = checkpoint_path + ".tmp";
+        {
+            std::ofstream out(temporary_path, std::ios::binary);
+            const FingerPrint fingerprint = FingerPrint::GetValid();
+            out.write((char *)&fingerprint, sizeof(FingerPrint));
+            out.write((char *)&number_of_nodes, sizeof(NodeID));
+            out.write((char *)&number_of_contracted_nodes, sizeof(NodeID));
+            out.write((char *)&current_level, sizeof(float));
+            out.write((char *)&flushed_contractor, sizeof(bool));
+            out.write((char *)&use_cached_node_levels, sizeof(bool));
+            out.write((char *)&core_factor, sizeof(double));
+            out.write((char *)&input_checksum, sizeof(std::uint64_t));
+            WriteVector(out, remaining_nodes);
+            WriteVector(out, node_priorities);
+            WriteVector(out, node_data);
+            WriteVector(out, node_levels);
+            WriteVector(out, orig_node_id_to_new_id_map);
+
+            std::vector<ContractorEdge> edges;
+            edges.reserve(contractor_graph->GetNumberOfEdges());
+            for (const auto node : osrm::irange(0u, contractor_graph->GetNumberOfNodes()))
+            {
+                for (const auto edge : contractor_graph->GetAdjacentEdgeRange(node))
+                {
+                    edges.emplace_back(node, contractor_graph->GetTarget(edge),
+                                       contractor_graph->GetEdgeData(edge));
+                }
+            }
+            const NodeID graph_size = contractor_graph->GetNumberOfNodes();
+            out.write((char *)&graph_size, sizeof(NodeID));
+            WriteVector(out, edges);
+            if (!out)
+            {
+                throw osrm::exception("could not write " + temporary_path);
+            }
+        }
+        if (0 != std::rename(temporary_path.c_str(), checkpoint_path.c_str()))
+        {
+            throw osrm::exception("could not write " + checkpoint_path);
+        }
+    }
+
+    void ReadCheckpoint(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw osrm::exception("could not open checkpoint " + path);
+        }
+        FingerPrint fingerprint_loaded;
+        in.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
+        if (!fingerprint_loaded.TestPrepare(FingerPrint::GetValid()))
+        {
+            throw osrm::exception("checkpoint " + path + " was written by a different version");
+        }
+        in.read((char *)&checkpoint_state->number_of_nodes, sizeof(NodeID));
+        in.read((char *)&checkpoint_state->number_of_contracted_nodes, sizeof(NodeID));
+        in.read((char *)&checkpoint_state->current_level, sizeof(float));
+        in.read((char *)&checkpoint_state->flushed_contractor, sizeof(bool));
+        in.read((char *)&checkpoint_state->use_cached_node_levels, sizeof(bool));
+        in.read((char *)&checkpoint_state->core_factor, sizeof(double));
+        in.read((char *)&input_checksum, sizeof(std::uint64_t));
+        ReadVector(in, checkpoint_state->remaining_nodes);
+        ReadVector(in, checkpoint_state->node_priorities);
+        ReadVector(in, checkpoint_state->node_data);
+        ReadVector(in, node_levels);
+        ReadVector(in, orig_node_id_to_new_id_map);
+
+        NodeID graph_size = 0;
+        in.read((char *)&graph_size, sizeof(NodeID));
+        std::vector<ContractorEdge> edges;
+        ReadVector(in, edges);
+        if (!in)
+        {
+            throw osrm::exception("checkpoint " + path + " is truncated");
+        }
+        contractor_graph = std::make_shared<ContractorGraph>(graph_size, edges);
+
+        if (checkpoint_state->flushed_contractor)
+        {
+            const std::string external_path = path + ".external";
+            std::ifstream external_in(external_path, std::ios::binary);
+            std::uint64_t size = 0;
+            external_in.read((char *)&size, sizeof(std::uint64_t));
+            QueryEdge edge;
+            for (std::uint64_t i = 0; i < size && external_in; ++i)
+            {
+                external_in.read((char *)&edge, sizeof(QueryEdge));
+                external_edge_list.push_back(edge);
+            }
+            if (!external_in)
+            {
+                throw osrm::exception("checkpoint " + external_path + " is truncated");
+            }
+        }
+    }
+
     inline void Dijkstra(const int max_distance,
                          const unsigned number_of_targets,
                          const int maxNodes,
@@ -613,6 +1136,7 @@ class Contractor
     {
 
         ContractorHeap &heap = data->heap;
+        ++data->witness_searches;
 
         int nodes = 0;
         unsigned number_of_targets_found = 0;
@@ -624,8 +1148,10 @@ class Contractor
 
             if (++nodes > maxNodes)
             {
+                ++data->witness_limit_hits;
                 return;
             }
+            ++data->witness_settled_nodes;
             if (distance > max_distance)
             {
                 return;
@@ -841,7 +1367,7 @@ class Contractor
 
         for (const auto i : osrm::irange<std::size_t>(0, neighbours.size()))
         {
-            contractor_graph->DeleteEdgesTo(neighbours[i], node);
+            data->deleted_edges += contractor_graph->DeleteEdgesTo(neighbours[i], node);
         }
     }
 
@@ -957,7 +1483,17 @@ class Contractor
     std::shared_ptr<ContractorGraph> contractor_graph;
     stxxl::vector<QueryEdge> external_edge_list;
     std::vector<NodeID> orig_node_id_to_new_id_map;
+    std::vector<bool> is_core_node;
+    std::vector<float> node_levels;
+    std::uint64_t input_checksum = 0;
     XORFastHash fast_hash;
+
+    std::vector<RoundStatistics> round_statistics;
+
+    std::string checkpoint_path;
+    unsigned checkpoint_interval = 0;
+    // state of the interrupted Run(), only set when resuming from a checkpoint
+    std::shared_ptr<CheckpointState> checkpoint_state;
 };
 
 #endif // CONTRACTOR_HPP
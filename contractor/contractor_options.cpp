@@ -56,7 +56,36 @@ ContractorOptions::ParseArguments(int argc, char *argv[], ContractorConfig &cont
         "Path to LUA routing profile")(
         "threads,t", boost::program_options::value<unsigned int>(&contractor_config.requested_num_threads)
                          ->default_value(tbb::task_scheduler_init::default_num_threads()),
-        "Number of threads to use");
+        "Number of threads to use")(
+        "level-cache", boost::program_options::value<bool>(&contractor_config.use_cached_priority)
+                             ->default_value(false),
+        "Use .level file to retain the contraction order of the last run, for changed weights only."
+        " With --mld the .partition file of the last run is kept")(
+        "segment-speed-file", boost::program_options::value<boost::filesystem::path>(
+                                  &contractor_config.segment_speed_lookup_path),
+        "Lookup file of from_osm_node_id,to_osm_node_id,speed_kmh lines, overriding segment speeds")(
+        "renumber-nodes", boost::program_options::value<bool>(&contractor_config.renumber_nodes)
+                              ->default_value(false),
+        "Number the nodes of the contracted graph by level and location for faster queries")(
+        "core,k", boost::program_options::value<double>(&contractor_config.core_factor)
+                      ->default_value(1.0),
+        "Fraction of the nodes to contract, the rest is left as uncontracted core [0.0 - 1.0]")(
+        "mld", boost::program_options::value<bool>(&contractor_config.use_mld)
+                   ->default_value(false),
+        "Partition the graph into nested cells instead of contracting it, see osrm-customize")(
+        "checkpoint", boost::program_options::value<bool>(&contractor_config.use_checkpoints)
+                          ->default_value(false),
+        "Save the state of the contraction to .checkpoint, to be continued with --resume")(
+        "checkpoint-interval",
+        boost::program_options::value<unsigned>(&contractor_config.checkpoint_interval)
+            ->default_value(0),
+        "Number of rounds between checkpoints, 0 saves only when the graph is flushed")(
+        "resume", boost::program_options::value<bool>(&contractor_config.resume)
+                      ->default_value(false),
+        "Continue the contraction from .checkpoint of an interrupted run on the same input")(
+        "contraction-report", boost::program_options::value<boost::filesystem::path>(
+                                  &contractor_config.contraction_report_path),
+        "Write the shortcuts, witness searches, timings and memory of every round to this file");
 
     // hidden options, will be allowed both on command line and in config file, but will not be
     // shown to the user
@@ -132,4 +161,8 @@ void ContractorOptions::GenerateOutputFilesNames(ContractorConfig &contractor_co
     contractor_config.graph_output_path = contractor_config.osrm_input_path.string() + ".hsgr";
     contractor_config.rtree_nodes_output_path = contractor_config.osrm_input_path.string() + ".ramIndex";
     contractor_config.rtree_leafs_output_path = contractor_config.osrm_input_path.string() + ".fileIndex";
+    contractor_config.level_output_path = contractor_config.osrm_input_path.string() + ".level";
+    contractor_config.partition_output_path = contractor_config.osrm_input_path.string() + ".partition";
+    contractor_config.cells_output_path = contractor_config.osrm_input_path.string() + ".cells";
+    contractor_config.checkpoint_output_path = contractor_config.osrm_input_path.string() + ".checkpoint";
 }
@@ -41,12 +41,21 @@ enum class return_code : unsigned
 
 struct ContractorConfig
 {
-    ContractorConfig() noexcept : requested_num_threads(0) {}
+    ContractorConfig() noexcept
+        : requested_num_threads(0), use_cached_priority(false), renumber_nodes(false),
+          core_factor(1.0), use_mld(false), use_checkpoints(false), checkpoint_interval(0),
+          resume(false)
+    {
+    }
 
     boost::filesystem::path config_file_path;
     boost::filesystem::path osrm_input_path;
     boost::filesystem::path restrictions_path;
     boost::filesystem::path profile_path;
+    // optional csv of from,to,speed lines that override the speed of single segments
+    boost::filesystem::path segment_speed_lookup_path;
+    // optional json file that receives the statistics of every contraction round
+    boost::filesystem::path contraction_report_path;
 
     std::string node_output_path;
     std::string edge_output_path;
@@ -54,8 +63,25 @@ struct ContractorConfig
     std::string graph_output_path;
     std::string rtree_nodes_output_path;
     std::string rtree_leafs_output_path;
+    std::string level_output_path;
+    std::string partition_output_path;
+    std::string cells_output_path;
+    std::string checkpoint_output_path;
 
     unsigned requested_num_threads;
+    // contract in the order of the .level file of an earlier run, only the weights may differ
+    bool use_cached_priority;
+    // order the nodes of the .hsgr by level and space filling curve for locality of queries
+    bool renumber_nodes;
+    // fraction of the nodes that is contracted, the remaining nodes form the core
+    double core_factor;
+    // leave the graph uncontracted and write a multi-level partition and its overlay instead
+    bool use_mld;
+    // write the state of the contraction after the flush and every checkpoint_interval rounds
+    bool use_checkpoints;
+    unsigned checkpoint_interval;
+    // continue the contraction from the last checkpoint instead of starting over
+    bool resume;
 };
 
 struct ContractorOptions
@@ -36,9 +36,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
 #include <fstream>
 #include <iomanip>
 #include <limits>
+#include <mutex>
 
 EdgeBasedGraphFactory::EdgeBasedGraphFactory(std::shared_ptr<NodeBasedDynamicGraph> node_based_graph,
                                    std::shared_ptr<RestrictionMap> restriction_map,
@@ -232,7 +237,7 @@ void EdgeBasedGraphFactory::FlushVectorToStream(
 
 void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
                                 const std::string &geometry_filename,
-                                lua_State *lua_state)
+                                const LuaStateFactory &create_lua_state)
 {
     TIMER_START(geometry);
     CompressGeometry();
@@ -247,7 +252,7 @@ void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
     TIMER_STOP(generate_nodes);
 
     TIMER_START(generate_edges);
-    GenerateEdgeExpandedEdges(original_edge_data_filename, lua_state);
+    GenerateEdgeExpandedEdges(original_edge_data_filename, create_lua_state);
     TIMER_STOP(generate_edges);
 
     m_geometry_compressor.SerializeInternalVector(geometry_filename);
@@ -259,6 +264,63 @@ void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
     SimpleLogger().Write() << "Generating edges: " << TIMER_SEC(generate_edges) << "s";
 }
 
+// Checks the conditions for removing node_v that do not depend on which nodes were removed
+// before it. Removing a node v between u and w changes only the distance and the target of the
+// edges (u, v) and (w, v), they become (u, w) and (w, u). Seen from w, (u, w) replaces (v, w)
+// and has the same forward, backward, nameID, ignore_in_grid and travel_mode flags, since
+// IsCompatibleTo required them to be equal. These flags are the only edge data compared here,
+// degrees, barriers and via nodes do not change. Thus, these checks give the same result on the
+// original graph as on the graph at the time node_v is visited.
+bool EdgeBasedGraphFactory::IsCompressionCandidate(const NodeID node_v) const
+{
+    // only contract degree 2 vertices
+    if (2 != m_node_based_graph->GetOutDegree(node_v))
+    {
+        return false;
+    }
+
+    // don't contract barrier node
+    if (m_barrier_nodes.end() != m_barrier_nodes.find(node_v))
+    {
+        return false;
+    }
+
+    // check if v is a via node for a turn restriction, i.e. a 'directed' barrier node
+    if (m_restriction_map->IsViaNode(node_v))
+    {
+        return false;
+    }
+
+    const bool reverse_edge_order =
+        !(m_node_based_graph->GetEdgeData(m_node_based_graph->BeginEdges(node_v)).forward);
+    const EdgeID forward_e2 = m_node_based_graph->BeginEdges(node_v) + reverse_edge_order;
+    const EdgeID reverse_e2 = m_node_based_graph->BeginEdges(node_v) + 1 - reverse_edge_order;
+
+    const EdgeData &fwd_edge_data2 = m_node_based_graph->GetEdgeData(forward_e2);
+    const EdgeData &rev_edge_data2 = m_node_based_graph->GetEdgeData(reverse_e2);
+
+    const NodeID node_w = m_node_based_graph->GetTarget(forward_e2);
+    const NodeID node_u = m_node_based_graph->GetTarget(reverse_e2);
+
+    const EdgeID forward_e1 = m_node_based_graph->FindEdge(node_u, node_v);
+    BOOST_ASSERT(SPECIAL_EDGEID != forward_e1);
+    const EdgeID reverse_e1 = m_node_based_graph->FindEdge(node_w, node_v);
+    BOOST_ASSERT(SPECIAL_EDGEID != reverse_e1);
+
+    const EdgeData &fwd_edge_data1 = m_node_based_graph->GetEdgeData(forward_e1);
+    const EdgeData &rev_edge_data1 = m_node_based_graph->GetEdgeData(reverse_e1);
+
+    // this case can happen if two ways with different names overlap
+    if (fwd_edge_data1.nameID != rev_edge_data1.nameID ||
+        fwd_edge_data2.nameID != rev_edge_data2.nameID)
+    {
+        return false;
+    }
+
+    return fwd_edge_data1.IsCompatibleTo(fwd_edge_data2) &&
+           rev_edge_data1.IsCompatibleTo(rev_edge_data2);
+}
+
 void EdgeBasedGraphFactory::CompressGeometry()
 {
     SimpleLogger().Write() << "Removing graph geometry while preserving topology";
@@ -266,29 +328,30 @@ void EdgeBasedGraphFactory::CompressGeometry()
     const unsigned original_number_of_nodes = m_node_based_graph->GetNumberOfNodes();
     const unsigned original_number_of_edges = m_node_based_graph->GetNumberOfEdges();
 
+    // The candidates are found in parallel on the unmodified graph. The graph and the geometry
+    // are then updated in node order, which keeps the merged segment weights, the bucket ids of
+    // the geometry and the check for an existing edge (u, w) exactly as in a serial run.
+    std::vector<unsigned char> is_candidate(original_number_of_nodes, 0);
+    tbb::parallel_for(tbb::blocked_range<NodeID>(0, original_number_of_nodes),
+                      [&](const tbb::blocked_range<NodeID> &range)
+                      {
+                          for (const auto node_v : osrm::irange(range.begin(), range.end()))
+                          {
+                              is_candidate[node_v] = IsCompressionCandidate(node_v);
+                          }
+                      });
+
     Percent progress(original_number_of_nodes);
 
     for (const NodeID node_v : osrm::irange(0u, original_number_of_nodes))
     {
         progress.printStatus(node_v);
 
-        // only contract degree 2 vertices
-        if (2 != m_node_based_graph->GetOutDegree(node_v))
-        {
-            continue;
-        }
-
-        // don't contract barrier node
-        if (m_barrier_nodes.end() != m_barrier_nodes.find(node_v))
-        {
-            continue;
-        }
-
-        // check if v is a via node for a turn restriction, i.e. a 'directed' barrier node
-        if (m_restriction_map->IsViaNode(node_v))
+        if (!is_candidate[node_v])
         {
             continue;
         }
+        BOOST_ASSERT(2 == m_node_based_graph->GetOutDegree(node_v));
 
         /*
          *    reverse_e2   forward_e2
@@ -335,83 +398,71 @@ void EdgeBasedGraphFactory::CompressGeometry()
         BOOST_ASSERT(SPECIAL_EDGEID != reverse_e1);
         BOOST_ASSERT(node_v == m_node_based_graph->GetTarget(reverse_e1));
 
-        const EdgeData &fwd_edge_data1 = m_node_based_graph->GetEdgeData(forward_e1);
-        const EdgeData &rev_edge_data1 = m_node_based_graph->GetEdgeData(reverse_e1);
-
+        // depends on the nodes removed before, so it can only be checked now
         if (m_node_based_graph->FindEdgeInEitherDirection(node_u, node_w) != SPECIAL_EDGEID)
         {
             continue;
         }
 
-        // this case can happen if two ways with different names overlap
-        if (fwd_edge_data1.nameID != rev_edge_data1.nameID ||
-            fwd_edge_data2.nameID != rev_edge_data2.nameID)
-        {
-            continue;
-        }
-
-        if (fwd_edge_data1.IsCompatibleTo(fwd_edge_data2) && rev_edge_data1.IsCompatibleTo(rev_edge_data2))
-        {
-            BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e1).nameID ==
-                         m_node_based_graph->GetEdgeData(reverse_e1).nameID);
-            BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e2).nameID ==
-                         m_node_based_graph->GetEdgeData(reverse_e2).nameID);
-
-            // Get distances before graph is modified
-            const int forward_weight1 = m_node_based_graph->GetEdgeData(forward_e1).distance;
-            const int forward_weight2 = m_node_based_graph->GetEdgeData(forward_e2).distance;
+        BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e1).IsCompatibleTo(fwd_edge_data2));
+        BOOST_ASSERT(m_node_based_graph->GetEdgeData(reverse_e1).IsCompatibleTo(rev_edge_data2));
+        BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e1).nameID ==
+                     m_node_based_graph->GetEdgeData(reverse_e1).nameID);
+        BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e2).nameID ==
+                     m_node_based_graph->GetEdgeData(reverse_e2).nameID);
 
-            BOOST_ASSERT(0 != forward_weight1);
-            BOOST_ASSERT(0 != forward_weight2);
+        // Get distances before graph is modified
+        const int forward_weight1 = m_node_based_graph->GetEdgeData(forward_e1).distance;
+        const int forward_weight2 = m_node_based_graph->GetEdgeData(forward_e2).distance;
 
-            const int reverse_weight1 = m_node_based_graph->GetEdgeData(reverse_e1).distance;
-            const int reverse_weight2 = m_node_based_graph->GetEdgeData(reverse_e2).distance;
+        BOOST_ASSERT(0 != forward_weight1);
+        BOOST_ASSERT(0 != forward_weight2);
 
-            BOOST_ASSERT(0 != reverse_weight1);
-            BOOST_ASSERT(0 != reverse_weight2);
+        const int reverse_weight1 = m_node_based_graph->GetEdgeData(reverse_e1).distance;
+        const int reverse_weight2 = m_node_based_graph->GetEdgeData(reverse_e2).distance;
 
-            const bool has_node_penalty = m_traffic_lights.find(node_v) != m_traffic_lights.end();
-
-            // add weight of e2's to e1
-            m_node_based_graph->GetEdgeData(forward_e1).distance += fwd_edge_data2.distance;
-            m_node_based_graph->GetEdgeData(reverse_e1).distance += rev_edge_data2.distance;
-            if (has_node_penalty)
-            {
-                m_node_based_graph->GetEdgeData(forward_e1).distance +=
-                    speed_profile.traffic_signal_penalty;
-                m_node_based_graph->GetEdgeData(reverse_e1).distance +=
-                    speed_profile.traffic_signal_penalty;
-            }
-
-            // extend e1's to targets of e2's
-            m_node_based_graph->SetTarget(forward_e1, node_w);
-            m_node_based_graph->SetTarget(reverse_e1, node_u);
-
-            // remove e2's (if bidir, otherwise only one)
-            m_node_based_graph->DeleteEdge(node_v, forward_e2);
-            m_node_based_graph->DeleteEdge(node_v, reverse_e2);
-
-            // update any involved turn restrictions
-            m_restriction_map->FixupStartingTurnRestriction(node_u, node_v, node_w);
-            m_restriction_map->FixupArrivingTurnRestriction(node_u, node_v, node_w,
-                                                            *m_node_based_graph);
-
-            m_restriction_map->FixupStartingTurnRestriction(node_w, node_v, node_u);
-            m_restriction_map->FixupArrivingTurnRestriction(node_w, node_v, node_u,
-                                                            *m_node_based_graph);
-
-            // store compressed geometry in container
-            m_geometry_compressor.CompressEdge(
-                forward_e1, forward_e2, node_v, node_w,
-                forward_weight1 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0),
-                forward_weight2);
-            m_geometry_compressor.CompressEdge(
-                reverse_e1, reverse_e2, node_v, node_u, reverse_weight1,
-                reverse_weight2 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0));
-            ++removed_node_count;
+        BOOST_ASSERT(0 != reverse_weight1);
+        BOOST_ASSERT(0 != reverse_weight2);
 
+        const bool has_node_penalty = m_traffic_lights.find(node_v) != m_traffic_lights.end();
 
+        // add weight of e2's to e1
+        m_node_based_graph->GetEdgeData(forward_e1).distance += fwd_edge_data2.distance;
+        m_node_based_graph->GetEdgeData(reverse_e1).distance += rev_edge_data2.distance;
+        if (has_node_penalty)
+        {
+            m_node_based_graph->GetEdgeData(forward_e1).distance +=
+                speed_profile.traffic_signal_penalty;
+            m_node_based_graph->GetEdgeData(reverse_e1).distance +=
+                speed_profile.traffic_signal_penalty;
         }
+
+        // extend e1's to targets of e2's
+        m_node_based_graph->SetTarget(forward_e1, node_w);
+        m_node_based_graph->SetTarget(reverse_e1, node_u);
+
+        // remove e2's (if bidir, otherwise only one)
+        m_node_based_graph->DeleteEdge(node_v, forward_e2);
+        m_node_based_graph->DeleteEdge(node_v, reverse_e2);
+
+        // update any involved turn restrictions
+        m_restriction_map->FixupStartingTurnRestriction(node_u, node_v, node_w);
+        m_restriction_map->FixupArrivingTurnRestriction(node_u, node_v, node_w,
+                                                        *m_node_based_graph);
+
+        m_restriction_map->FixupStartingTurnRestriction(node_w, node_v, node_u);
+        m_restriction_map->FixupArrivingTurnRestriction(node_w, node_v, node_u,
+                                                        *m_node_based_graph);
+
+        // store compressed geometry in container
+        m_geometry_compressor.CompressEdge(
+            forward_e1, forward_e2, node_v, node_w,
+            forward_weight1 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0),
+            forward_weight2);
+        m_geometry_compressor.CompressEdge(
+            reverse_e1, reverse_e2, node_v, node_u, reverse_weight1,
+            reverse_weight2 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0));
+        ++removed_node_count;
     }
     SimpleLogger().Write() << "removed " << removed_node_count << " nodes";
     m_geometry_compressor.PrintStatistics();
@@ -543,11 +594,29 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedNodes()
                            << " nodes in edge-expanded graph";
 }
 
+// edges and original edge data generated from the turns of a range of node-based nodes
+struct EdgeBasedGraphFactory::TurnBuffer
+{
+    TurnBuffer()
+        : node_based_edge_counter(0), restricted_turns_counter(0), skipped_uturns_counter(0),
+          skipped_barrier_turns_counter(0)
+    {
+    }
+
+    std::vector<EdgeBasedEdge> edges;
+    std::vector<OriginalEdgeData> original_edge_data;
+
+    unsigned node_based_edge_counter;
+    unsigned restricted_turns_counter;
+    unsigned skipped_uturns_counter;
+    unsigned skipped_barrier_turns_counter;
+};
+
 /**
  * Actually it also generates OriginalEdgeData and serializes them...
  */
 void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
-    const std::string &original_edge_data_filename, lua_State *lua_state)
+    const std::string &original_edge_data_filename, const LuaStateFactory &create_lua_state)
 {
     SimpleLogger().Write() << "generating edge-expanded edges";
 
@@ -559,164 +628,224 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
     // writes a dummy value that is updated later
     edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
 
-    std::vector<OriginalEdgeData> original_edge_data_vector;
-    original_edge_data_vector.reserve(1024 * 1024);
-
-    // Loop over all turns and generate new set of edges.
-    // Three nested loop look super-linear, but we are dealing with a (kind of)
-    // linear number of turns only.
     unsigned restricted_turns_counter = 0;
     unsigned skipped_uturns_counter = 0;
     unsigned skipped_barrier_turns_counter = 0;
-    unsigned compressed = 0;
 
-    Percent progress(m_node_based_graph->GetNumberOfNodes());
+    // The turn function is called from every thread, each one gets its own lua state.
+    std::mutex lua_init_mutex;
+    tbb::enumerable_thread_specific<std::shared_ptr<lua_State>> lua_states;
 
-    for (const auto node_u : osrm::irange(0u, m_node_based_graph->GetNumberOfNodes()))
-    {
-        progress.printStatus(node_u);
-        for (const EdgeID e1 : m_node_based_graph->GetAdjacentEdgeRange(node_u))
-        {
-            if (!m_node_based_graph->GetEdgeData(e1).forward)
-            {
-                continue;
-            }
+    // Nodes are expanded in batches of fixed ranges. Every range fills its own buffer and the
+    // buffers are appended in order of the ranges, so the edges and their ids do not depend on
+    // the scheduling of the threads.
+    const constexpr unsigned RangeSize = 1024;
+    const constexpr unsigned RangesPerBatch = 1024;
+    std::vector<TurnBuffer> buffers(RangesPerBatch);
 
-            ++node_based_edge_counter;
-            const NodeID node_v = m_node_based_graph->GetTarget(e1);
-            const NodeID only_restriction_to_node =
-                m_restriction_map->CheckForEmanatingIsOnlyTurn(node_u, node_v);
-            const bool is_barrier_node = m_barrier_nodes.find(node_v) != m_barrier_nodes.end();
+    const unsigned number_of_nodes = m_node_based_graph->GetNumberOfNodes();
+    Percent progress(number_of_nodes);
 
-            for (const EdgeID e2 : m_node_based_graph->GetAdjacentEdgeRange(node_v))
+    for (unsigned batch_begin = 0; batch_begin < number_of_nodes;
+         batch_begin += RangeSize * RangesPerBatch)
+    {
+        progress.printStatus(batch_begin);
+        const unsigned batch_end =
+            std::min(number_of_nodes, batch_begin + RangeSize * RangesPerBatch);
+        const unsigned number_of_ranges = (batch_end - batch_begin + RangeSize - 1) / RangeSize;
+
+        tbb::parallel_for(
+            tbb::blocked_range<unsigned>(0, number_of_ranges),
+            [&](const tbb::blocked_range<unsigned> &range)
             {
-                if (!m_node_based_graph->GetEdgeData(e2).forward)
-                {
-                    continue;
-                }
-                const NodeID node_w = m_node_based_graph->GetTarget(e2);
-
-                if ((only_restriction_to_node != SPECIAL_NODEID) &&
-                    (node_w != only_restriction_to_node))
+                lua_State *lua_state = nullptr;
+                if (speed_profile.has_turn_penalty_function &&
+                    speed_profile.turn_penalty_table.empty())
                 {
-                    // We are at an only_-restriction but not at the right turn.
-                    ++restricted_turns_counter;
-                    continue;
-                }
-
-                if (is_barrier_node)
-                {
-                    if (node_u != node_w)
+                    bool exists = false;
+                    auto &thread_lua_state = lua_states.local(exists);
+                    if (!exists)
                     {
-                        ++skipped_barrier_turns_counter;
-                        continue;
+                        std::lock_guard<std::mutex> lock(lua_init_mutex);
+                        thread_lua_state = create_lua_state();
                     }
+                    lua_state = thread_lua_state.get();
                 }
-                else
+
+                for (const auto range_index : osrm::irange(range.begin(), range.end()))
                 {
-                    if ((node_u == node_w) && (m_node_based_graph->GetOutDegree(node_v) > 1))
+                    const unsigned range_begin = batch_begin + range_index * RangeSize;
+                    const unsigned range_end = std::min(batch_end, range_begin + RangeSize);
+                    for (const auto node_u : osrm::irange(range_begin, range_end))
                     {
-                        ++skipped_uturns_counter;
-                        continue;
+                        ExpandTurnsOfNode(node_u, lua_state, buffers[range_index]);
                     }
                 }
+            });
 
-                // only add an edge if turn is not a U-turn except when it is
-                // at the end of a dead-end street
-                if (m_restriction_map->CheckIfTurnIsRestricted(node_u, node_v, node_w) &&
-                    (only_restriction_to_node == SPECIAL_NODEID) &&
-                    (node_w != only_restriction_to_node))
-                {
-                    // We are at an only_-restriction but not at the right turn.
-                    ++restricted_turns_counter;
-                    continue;
-                }
+        for (const auto range_index : osrm::irange(0u, number_of_ranges))
+        {
+            TurnBuffer &buffer = buffers[range_index];
+            for (EdgeBasedEdge &edge : buffer.edges)
+            {
+                // edge ids index into the original edge data, which is written in the same order
+                edge.edge_id = m_edge_based_edge_list.size();
+                m_edge_based_edge_list.push_back(edge);
+            }
+            original_edges_counter += buffer.original_edge_data.size();
+            FlushVectorToStream(edge_data_file, buffer.original_edge_data);
+
+            node_based_edge_counter += buffer.node_based_edge_counter;
+            restricted_turns_counter += buffer.restricted_turns_counter;
+            skipped_uturns_counter += buffer.skipped_uturns_counter;
+            skipped_barrier_turns_counter += buffer.skipped_barrier_turns_counter;
+            buffer = TurnBuffer();
+        }
+    }
+    BOOST_ASSERT(original_edges_counter == m_edge_based_edge_list.size());
 
-                // only add an edge if turn is not prohibited
-                const EdgeData &edge_data1 = m_node_based_graph->GetEdgeData(e1);
-                const EdgeData &edge_data2 = m_node_based_graph->GetEdgeData(e2);
+    edge_data_file.seekp(std::ios::beg);
+    edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
+    edge_data_file.close();
 
-                BOOST_ASSERT(edge_data1.edgeBasedNodeID != edge_data2.edgeBasedNodeID);
-                BOOST_ASSERT(edge_data1.forward);
-                BOOST_ASSERT(edge_data2.forward);
+    SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
+    SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
+    SimpleLogger().Write() << "Edge-expanded graph ...";
+    SimpleLogger().Write() << "  contains " << m_edge_based_edge_list.size() << " edges";
+    SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
+                                                                        "defined by "
+                           << m_restriction_map->size() << " restrictions";
+    SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
+    SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
+}
 
-                // the following is the core of the loop.
-                unsigned distance = edge_data1.distance;
-                if (m_traffic_lights.find(node_v) != m_traffic_lights.end())
-                {
-                    distance += speed_profile.traffic_signal_penalty;
-                }
+// Loop over all turns and generate new set of edges.
+// Three nested loop look super-linear, but we are dealing with a (kind of)
+// linear number of turns only.
+void EdgeBasedGraphFactory::ExpandTurnsOfNode(const NodeID node_u,
+                                              lua_State *lua_state,
+                                              TurnBuffer &buffer) const
+{
+    for (const EdgeID e1 : m_node_based_graph->GetAdjacentEdgeRange(node_u))
+    {
+        if (!m_node_based_graph->GetEdgeData(e1).forward)
+        {
+            continue;
+        }
 
-                // unpack last node of first segment if packed
-                const auto first_coordinate =
-                    m_node_info_list[(m_geometry_compressor.HasEntryForID(e1)
-                                          ? m_geometry_compressor.GetLastNodeIDOfBucket(e1)
-                                          : node_u)];
+        ++buffer.node_based_edge_counter;
+        const NodeID node_v = m_node_based_graph->GetTarget(e1);
+        const NodeID only_restriction_to_node =
+            m_restriction_map->CheckForEmanatingIsOnlyTurn(node_u, node_v);
+        const bool is_barrier_node = m_barrier_nodes.find(node_v) != m_barrier_nodes.end();
 
-                // unpack first node of second segment if packed
-                const auto third_coordinate =
-                    m_node_info_list[(m_geometry_compressor.HasEntryForID(e2)
-                                          ? m_geometry_compressor.GetFirstNodeIDOfBucket(e2)
-                                          : node_w)];
+        for (const EdgeID e2 : m_node_based_graph->GetAdjacentEdgeRange(node_v))
+        {
+            if (!m_node_based_graph->GetEdgeData(e2).forward)
+            {
+                continue;
+            }
+            const NodeID node_w = m_node_based_graph->GetTarget(e2);
 
-                const double turn_angle = ComputeAngle::OfThreeFixedPointCoordinates(
-                    first_coordinate, m_node_info_list[node_v], third_coordinate);
+            if ((only_restriction_to_node != SPECIAL_NODEID) &&
+                (node_w != only_restriction_to_node))
+            {
+                // We are at an only_-restriction but not at the right turn.
+                ++buffer.restricted_turns_counter;
+                continue;
+            }
 
-                const int turn_penalty = GetTurnPenalty(turn_angle, lua_state);
-                TurnInstruction turn_instruction = AnalyzeTurn(node_u, node_v, node_w, turn_angle);
-                if (turn_instruction == TurnInstruction::UTurn)
+            if (is_barrier_node)
+            {
+                if (node_u != node_w)
                 {
-                    distance += speed_profile.u_turn_penalty;
+                    ++buffer.skipped_barrier_turns_counter;
+                    continue;
                 }
-                distance += turn_penalty;
-
-                const bool edge_is_compressed = m_geometry_compressor.HasEntryForID(e1);
-
-                if (edge_is_compressed)
+            }
+            else
+            {
+                if ((node_u == node_w) && (m_node_based_graph->GetOutDegree(node_v) > 1))
                 {
-                    ++compressed;
+                    ++buffer.skipped_uturns_counter;
+                    continue;
                 }
+            }
 
-                original_edge_data_vector.emplace_back(
-                    (edge_is_compressed ? m_geometry_compressor.GetPositionForID(e1) : node_v),
-                    edge_data1.nameID, turn_instruction, edge_is_compressed,
-                    edge_data2.travel_mode);
+            // only add an edge if turn is not a U-turn except when it is
+            // at the end of a dead-end street
+            if (m_restriction_map->CheckIfTurnIsRestricted(node_u, node_v, node_w) &&
+                (only_restriction_to_node == SPECIAL_NODEID) &&
+                (node_w != only_restriction_to_node))
+            {
+                // We are at an only_-restriction but not at the right turn.
+                ++buffer.restricted_turns_counter;
+                continue;
+            }
 
-                ++original_edges_counter;
+            // only add an edge if turn is not prohibited
+            const EdgeData &edge_data1 = m_node_based_graph->GetEdgeData(e1);
+            const EdgeData &edge_data2 = m_node_based_graph->GetEdgeData(e2);
 
-                if (original_edge_data_vector.size() > 1024 * 1024 * 10)
-                {
-                    FlushVectorToStream(edge_data_file, original_edge_data_vector);
-                }
+            BOOST_ASSERT(edge_data1.edgeBasedNodeID != edge_data2.edgeBasedNodeID);
+            BOOST_ASSERT(edge_data1.forward);
+            BOOST_ASSERT(edge_data2.forward);
+
+            // the following is the core of the loop.
+            unsigned distance = edge_data1.distance;
+            if (m_traffic_lights.find(node_v) != m_traffic_lights.end())
+            {
+                distance += speed_profile.traffic_signal_penalty;
+            }
+
+            // unpack last node of first segment if packed
+            const auto first_coordinate =
+                m_node_info_list[(m_geometry_compressor.HasEntryForID(e1)
+                                      ? m_geometry_compressor.GetLastNodeIDOfBucket(e1)
+                                      : node_u)];
 
-                BOOST_ASSERT(SPECIAL_NODEID != edge_data1.edgeBasedNodeID);
-                BOOST_ASSERT(SPECIAL_NODEID != edge_data2.edgeBasedNodeID);
+            // unpack first node of second segment if packed
+            const auto third_coordinate =
+                m_node_info_list[(m_geometry_compressor.HasEntryForID(e2)
+                                      ? m_geometry_compressor.GetFirstNodeIDOfBucket(e2)
+                                      : node_w)];
 
-                m_edge_based_edge_list.emplace_back(
-                    EdgeBasedEdge(edge_data1.edgeBasedNodeID, edge_data2.edgeBasedNodeID,
-                                  m_edge_based_edge_list.size(), distance, true, false));
+            const double turn_angle = ComputeAngle::OfThreeFixedPointCoordinates(
+                first_coordinate, m_node_info_list[node_v], third_coordinate);
+
+            const int turn_penalty = GetTurnPenalty(turn_angle, lua_state);
+            TurnInstruction turn_instruction = AnalyzeTurn(node_u, node_v, node_w, turn_angle);
+            if (turn_instruction == TurnInstruction::UTurn)
+            {
+                distance += speed_profile.u_turn_penalty;
             }
-        }
-    }
-    FlushVectorToStream(edge_data_file, original_edge_data_vector);
+            distance += turn_penalty;
 
-    edge_data_file.seekp(std::ios::beg);
-    edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
-    edge_data_file.close();
+            const bool edge_is_compressed = m_geometry_compressor.HasEntryForID(e1);
 
-    SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
-    SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
-    SimpleLogger().Write() << "Edge-expanded graph ...";
-    SimpleLogger().Write() << "  contains " << m_edge_based_edge_list.size() << " edges";
-    SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
-                                                                        "defined by "
-                           << m_restriction_map->size() << " restrictions";
-    SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
-    SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
+            buffer.original_edge_data.emplace_back(
+                (edge_is_compressed ? m_geometry_compressor.GetPositionForID(e1) : node_v),
+                edge_data1.nameID, turn_instruction, edge_is_compressed, edge_data2.travel_mode);
+
+            BOOST_ASSERT(SPECIAL_NODEID != edge_data1.edgeBasedNodeID);
+            BOOST_ASSERT(SPECIAL_NODEID != edge_data2.edgeBasedNodeID);
+
+            // the edge id is assigned once the buffer is appended to the edge list
+            buffer.edges.emplace_back(edge_data1.edgeBasedNodeID, edge_data2.edgeBasedNodeID,
+                                      SPECIAL_NODEID, distance, true, false);
+        }
+    }
 }
 
 int EdgeBasedGraphFactory::GetTurnPenalty(double angle, lua_State *lua_state) const
 {
+    if (!speed_profile.turn_penalty_table.empty())
+    {
+        const std::size_t index = static_cast<std::size_t>(
+            angle * SpeedProfileProperties::TurnPenaltyResolution + 0.5);
+        BOOST_ASSERT(index < speed_profile.turn_penalty_table.size());
+        return speed_profile.turn_penalty_table[index];
+    }
 
     if (speed_profile.has_turn_penalty_function)
     {
@@ -41,6 +41,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/restriction_map.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <queue>
@@ -59,6 +60,9 @@ class EdgeBasedGraphFactory
 
     struct SpeedProfileProperties;
 
+    // creates a lua state with the profile loaded, turns are expanded with one state per thread
+    using LuaStateFactory = std::function<std::shared_ptr<lua_State>()>;
+
     explicit EdgeBasedGraphFactory(std::shared_ptr<NodeBasedDynamicGraph> node_based_graph,
                                    std::shared_ptr<RestrictionMap> restricion_map,
                                    std::unique_ptr<std::vector<NodeID>> barrier_node_list,
@@ -68,7 +72,7 @@ class EdgeBasedGraphFactory
 
     void Run(const std::string &original_edge_data_filename,
              const std::string &geometry_filename,
-             lua_State *lua_state);
+             const LuaStateFactory &create_lua_state);
 
     void GetEdgeBasedEdges(DeallocatingVector<EdgeBasedEdge> &edges);
 
@@ -87,13 +91,19 @@ class EdgeBasedGraphFactory
         {
         }
 
+        // turn_function is sampled for every 1/TurnPenaltyResolution degrees of the turn angle
+        static const constexpr int TurnPenaltyResolution = 10;
+
         int traffic_signal_penalty;
         int u_turn_penalty;
         bool has_turn_penalty_function;
+        // penalties of the sampled angles in [0, 360], empty if turn_function is called per turn
+        std::vector<int> turn_penalty_table;
     } speed_profile;
 
   private:
     using EdgeData = NodeBasedDynamicGraph::EdgeData;
+    struct TurnBuffer;
 
     unsigned m_number_of_edge_based_nodes;
 
@@ -111,10 +121,12 @@ class EdgeBasedGraphFactory
     GeometryCompressor m_geometry_compressor;
 
     void CompressGeometry();
+    bool IsCompressionCandidate(const NodeID node_v) const;
     void RenumberEdges();
     void GenerateEdgeExpandedNodes();
     void GenerateEdgeExpandedEdges(const std::string &original_edge_data_filename,
-                                   lua_State *lua_state);
+                                   const LuaStateFactory &create_lua_state);
+    void ExpandTurnsOfNode(const NodeID node_u, lua_State *lua_state, TurnBuffer &buffer) const;
 
     void InsertEdgeBasedNode(const NodeID u, const NodeID v, const unsigned component_id);
 
@@ -0,0 +1,211 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef GRAPH_PARTITIONER_HPP
+#define GRAPH_PARTITIONER_HPP
+
+#include "../data_structures/multi_level_partition.hpp"
+#include "../util/integer_range.hpp"
+#include "../typedefs.h"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+/**
+ * Computes a nested partition of a graph by recursive inertial bisection.
+ *
+ * Each cell is split at the median of the node coordinates projected onto one of four
+ * directions, choosing the direction that cuts the fewest edges. The split stops once a cell
+ * holds no more nodes than the smallest cell size. A cell of a level is the largest subtree of
+ * this bisection that does not exceed the cell size of the level.
+ */
+template <class GraphT> class GraphPartitioner
+{
+  public:
+    using CellID = MultiLevelPartition::CellID;
+
+    GraphPartitioner(const GraphT &graph, const std::vector<FixedPointCoordinate> &coordinates)
+        : graph(graph), coordinates(coordinates)
+    {
+        BOOST_ASSERT(coordinates.size() == graph.GetNumberOfNodes());
+    }
+
+    // max_cell_sizes are the largest number of nodes of a cell on each level, ascending
+    MultiLevelPartition operator()(const std::vector<unsigned> &max_cell_sizes)
+    {
+        BOOST_ASSERT(std::is_sorted(max_cell_sizes.begin(), max_cell_sizes.end()));
+        const NodeID number_of_nodes = graph.GetNumberOfNodes();
+
+        nodes.resize(number_of_nodes);
+        std::iota(nodes.begin(), nodes.end(), 0);
+        positions.resize(number_of_nodes);
+        std::iota(positions.begin(), positions.end(), 0);
+        cells_per_level.assign(max_cell_sizes.size(), std::vector<CellID>(number_of_nodes, 0));
+        number_of_cells.assign(max_cell_sizes.size(), 0);
+
+        if (number_of_nodes > 0)
+        {
+            Bisect(max_cell_sizes, 0, number_of_nodes, std::numeric_limits<std::size_t>::max());
+        }
+
+        // a level with a single cell never separates two nodes
+        std::vector<std::vector<CellID>> used_levels;
+        for (const auto level : osrm::irange<std::size_t>(0, cells_per_level.size()))
+        {
+            if (number_of_cells[level] > 1)
+            {
+                used_levels.emplace_back(std::move(cells_per_level[level]));
+            }
+        }
+        cells_per_level.clear();
+        nodes.clear();
+        positions.clear();
+
+        return MultiLevelPartition(used_levels);
+    }
+
+  private:
+    void Bisect(const std::vector<unsigned> &max_cell_sizes,
+                const std::size_t begin,
+                const std::size_t end,
+                const std::size_t parent_size)
+    {
+        const std::size_t size = end - begin;
+        for (const auto level : osrm::irange<std::size_t>(0, max_cell_sizes.size()))
+        {
+            // the first subtree that fits the level is a cell of it
+            if (size <= max_cell_sizes[level] && parent_size > max_cell_sizes[level])
+            {
+                const CellID cell = number_of_cells[level]++;
+                for (const auto position : osrm::irange(begin, end))
+                {
+                    cells_per_level[level][nodes[position]] = cell;
+                }
+            }
+        }
+
+        if (size <= max_cell_sizes.front() || size < 2)
+        {
+            return;
+        }
+
+        constexpr std::size_t NUMBER_OF_DIRECTIONS = 4;
+        const std::size_t middle = begin + size / 2;
+        std::size_t best_direction = 0;
+        std::size_t best_cut = std::numeric_limits<std::size_t>::max();
+        for (const auto direction : osrm::irange<std::size_t>(0, NUMBER_OF_DIRECTIONS))
+        {
+            SplitAtMedian(direction, begin, middle, end);
+            const std::size_t cut = CountCutEdges(begin, middle, end);
+            if (cut < best_cut)
+            {
+                best_cut = cut;
+                best_direction = direction;
+            }
+        }
+        if (best_direction != NUMBER_OF_DIRECTIONS - 1)
+        {
+            SplitAtMedian(best_direction, begin, middle, end);
+        }
+
+        Bisect(max_cell_sizes, begin, middle, size);
+        Bisect(max_cell_sizes, middle, end, size);
+    }
+
+    // projection of the coordinate onto the direction, the axes and both diagonals
+    std::int64_t Project(const std::size_t direction, const NodeID node) const
+    {
+        const std::int64_t lat = coordinates[node].lat;
+        const std::int64_t lon = coordinates[node].lon;
+        switch (direction)
+        {
+        case 0:
+            return lon;
+        case 1:
+            return lat;
+        case 2:
+            return lon + lat;
+        default:
+            return lon - lat;
+        }
+    }
+
+    void SplitAtMedian(const std::size_t direction,
+                       const std::size_t begin,
+                       const std::size_t middle,
+                       const std::size_t end)
+    {
+        std::nth_element(nodes.begin() + begin, nodes.begin() + middle, nodes.begin() + end,
+                         [this, direction](const NodeID lhs, const NodeID rhs)
+                         {
+                             const auto lhs_value = Project(direction, lhs);
+                             const auto rhs_value = Project(direction, rhs);
+                             return lhs_value < rhs_value || (lhs_value == rhs_value && lhs < rhs);
+                         });
+        for (const auto position : osrm::irange(begin, end))
+        {
+            positions[nodes[position]] = position;
+        }
+    }
+
+    // edges from the first half into the second one, the graph has every edge at both ends
+    std::size_t
+    CountCutEdges(const std::size_t begin, const std::size_t middle, const std::size_t end) const
+    {
+        std::size_t cut = 0;
+        for (const auto position : osrm::irange(begin, middle))
+        {
+            for (const auto edge : graph.GetAdjacentEdgeRange(nodes[position]))
+            {
+                const std::size_t target_position = positions[graph.GetTarget(edge)];
+                if (target_position >= middle && target_position < end)
+                {
+                    ++cut;
+                }
+            }
+        }
+        return cut;
+    }
+
+    const GraphT &graph;
+    const std::vector<FixedPointCoordinate> &coordinates;
+    // nodes of a cell are contiguous, positions is the inverse permutation
+    std::vector<NodeID> nodes;
+    std::vector<std::size_t> positions;
+    std::vector<std::vector<CellID>> cells_per_level;
+    std::vector<CellID> number_of_cells;
+};
+
+#endif // GRAPH_PARTITIONER_HPP
@@ -27,18 +27,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "processing_chain.hpp"
 
+#include "cell_customizer.hpp"
 #include "contractor.hpp"
+#include "graph_partitioner.hpp"
 
 #include "../algorithms/crc32_processor.hpp"
+#include "../data_structures/coordinate_calculation.hpp"
 #include "../data_structures/deallocating_vector.hpp"
+#include "../data_structures/hilbert_value.hpp"
 #include "../data_structures/static_rtree.hpp"
 #include "../data_structures/restriction_map.hpp"
 
 #include "../util/git_sha.hpp"
 #include "../util/graph_loader.hpp"
 #include "../util/integer_range.hpp"
+#include "../util/json_renderer.hpp"
 #include "../util/lua_util.hpp"
 #include "../util/make_unique.hpp"
+#include "../util/memory_usage.hpp"
 #include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/string_util.hpp"
@@ -47,11 +53,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/filesystem/fstream.hpp>
 #include <boost/program_options.hpp>
+#include <boost/spirit/include/qi.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <vector>
@@ -89,32 +101,77 @@ int Prepare::Run()
 
     TIMER_STOP(expansion);
 
-    SimpleLogger().Write() << "building r-tree ...";
-    TIMER_START(rtree);
+    // the partition needs the locations of the edge-based nodes, the node map is released below
+    std::vector<FixedPointCoordinate> node_centroids;
 
-    BuildRTree(*node_based_edge_list, *internal_to_external_node_map);
+    // the r-tree refers to the node ids, with renumbering it is built once they are final
+    if (!config.renumber_nodes)
+    {
+        SimpleLogger().Write() << "building r-tree ...";
+        BuildRTree(*node_based_edge_list, *internal_to_external_node_map);
 
-    TIMER_STOP(rtree);
+        if (config.use_mld)
+        {
+            ComputeNodeCentroids(*node_based_edge_list, *internal_to_external_node_map,
+                                 number_of_edge_based_nodes, node_centroids);
+        }
 
-    SimpleLogger().Write() << "writing node map ...";
-    WriteNodeMapping(std::move(internal_to_external_node_map));
+        SimpleLogger().Write() << "writing node map ...";
+        WriteNodeMapping(std::move(internal_to_external_node_map));
+    }
 
     // Contracting the edge-expanded graph
 
+    // the contractor only raises the peak if the one after contraction is higher
+    SimpleLogger().Write() << "Peak memory before contraction: "
+                           << PeakResidentMemory() / (1024 * 1024) << " MB";
+
     TIMER_START(contraction);
     auto contracted_edge_list = osrm::make_unique<DeallocatingVector<QueryEdge>>();
-    ContractGraph(number_of_edge_based_nodes, edge_based_edge_list, *contracted_edge_list);
+    std::vector<float> node_levels;
+    std::vector<bool> is_core_node;
+    ContractGraph(number_of_edge_based_nodes, edge_based_edge_list, *contracted_edge_list,
+                  node_levels, is_core_node);
     TIMER_STOP(contraction);
 
     SimpleLogger().Write() << "Contraction took " << TIMER_SEC(contraction) << " sec";
+    SimpleLogger().Write() << "Peak memory after contraction: "
+                           << PeakResidentMemory() / (1024 * 1024) << " MB";
+
+    if (config.renumber_nodes)
+    {
+        SimpleLogger().Write() << "renumbering nodes ...";
+        RenumberNodes(node_levels, *internal_to_external_node_map, *node_based_edge_list,
+                      *contracted_edge_list, is_core_node);
+
+        SimpleLogger().Write() << "building r-tree ...";
+        BuildRTree(*node_based_edge_list, *internal_to_external_node_map);
+
+        if (config.use_mld)
+        {
+            ComputeNodeCentroids(*node_based_edge_list, *internal_to_external_node_map,
+                                 number_of_edge_based_nodes, node_centroids);
+        }
+
+        SimpleLogger().Write() << "writing node map ...";
+        WriteNodeMapping(std::move(internal_to_external_node_map));
+    }
 
     std::size_t number_of_used_edges = WriteContractedGraph(number_of_edge_based_nodes,
                                                             std::move(node_based_edge_list),
-                                                            std::move(contracted_edge_list));
+                                                            std::move(contracted_edge_list),
+                                                            is_core_node);
+
+    if (config.use_mld)
+    {
+        SimpleLogger().Write() << "partitioning graph ...";
+        PartitionGraph(node_centroids);
+    }
 
     TIMER_STOP(preparing);
 
     SimpleLogger().Write() << "Preprocessing : " << TIMER_SEC(preparing) << " seconds";
+    SimpleLogger().Write() << "Peak memory : " << PeakResidentMemory() / (1024 * 1024) << " MB";
     SimpleLogger().Write() << "Expansion  : " << (number_of_node_based_nodes / TIMER_SEC(expansion))
                            << " nodes/sec and "
                            << (number_of_edge_based_nodes / TIMER_SEC(expansion)) << " edges/sec";
@@ -131,7 +188,8 @@ int Prepare::Run()
 
 std::size_t Prepare::WriteContractedGraph(unsigned number_of_edge_based_nodes,
                                           std::unique_ptr<std::vector<EdgeBasedNode>> node_based_edge_list,
-                                          std::unique_ptr<DeallocatingVector<QueryEdge>> contracted_edge_list)
+                                          std::unique_ptr<DeallocatingVector<QueryEdge>> contracted_edge_list,
+                                          const std::vector<bool> &is_core_node)
 {
     const unsigned crc32_value = CalculateEdgeChecksum(std::move(node_based_edge_list));
 
@@ -237,9 +295,94 @@ std::size_t Prepare::WriteContractedGraph(unsigned number_of_edge_based_nodes,
         ++number_of_used_edges;
     }
 
+    // serialize the core markers, 32 to an unsigned. No markers if every node is contracted
+    const unsigned number_of_core_markers = is_core_node.size();
+    hsgr_output_stream.write((char *)&number_of_core_markers, sizeof(unsigned));
+    if (number_of_core_markers > 0)
+    {
+        SimpleLogger().Write() << "Serializing core markers";
+        std::vector<unsigned> core_marker_blocks(number_of_core_markers / 32 + 1, 0);
+        for (const auto node : osrm::irange(0u, number_of_core_markers))
+        {
+            if (is_core_node[node])
+            {
+                core_marker_blocks[node / 32] |= (1u << (node % 32));
+            }
+        }
+        hsgr_output_stream.write((char *)core_marker_blocks.data(),
+                                 sizeof(unsigned) * core_marker_blocks.size());
+    }
+
     return number_of_used_edges;
 }
 
+void Prepare::ComputeNodeCentroids(const std::vector<EdgeBasedNode> &node_based_edge_list,
+                                   const std::vector<QueryNode> &internal_to_external_node_map,
+                                   const std::size_t number_of_edge_based_nodes,
+                                   std::vector<FixedPointCoordinate> &node_centroids) const
+{
+    node_centroids.resize(number_of_edge_based_nodes);
+    for (const EdgeBasedNode &node : node_based_edge_list)
+    {
+        const QueryNode &u = internal_to_external_node_map[node.u];
+        const QueryNode &v = internal_to_external_node_map[node.v];
+        const FixedPointCoordinate centroid = EdgeBasedNode::Centroid(
+            FixedPointCoordinate(u.lat, u.lon), FixedPointCoordinate(v.lat, v.lon));
+        if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+        {
+            node_centroids[node.forward_edge_based_node_id] = centroid;
+        }
+        if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+        {
+            node_centroids[node.reverse_edge_based_node_id] = centroid;
+        }
+    }
+}
+
+/**
+    \brief Partitions the uncontracted graph of the .hsgr into nested cells and customizes them
+*/
+void Prepare::PartitionGraph(const std::vector<FixedPointCoordinate> &node_centroids) const
+{
+    using PartitionGraphT = StaticGraph<EdgeData>;
+
+    std::vector<PartitionGraphT::NodeArrayEntry> node_list;
+    std::vector<PartitionGraphT::EdgeArrayEntry> edge_list;
+    unsigned check_sum = 0;
+    readHSGRFromStream(config.graph_output_path, node_list, edge_list, &check_sum);
+    const PartitionGraphT graph(node_list, edge_list);
+
+    MultiLevelPartition partition;
+    // the partition only depends on the topology, with changed weights only the cells change
+    if (config.use_cached_priority && boost::filesystem::exists(config.partition_output_path))
+    {
+        boost::filesystem::ifstream partition_input_stream(config.partition_output_path,
+                                                           std::ios::binary);
+        partition_input_stream >> partition;
+        if (partition.GetNumberOfNodes() != graph.GetNumberOfNodes())
+        {
+            throw osrm::exception("cached partition does not match the graph");
+        }
+        SimpleLogger().Write() << "Reusing partition of " << partition.GetNumberOfLevels()
+                               << " levels";
+    }
+    else
+    {
+        TIMER_START(partitioning);
+        partition =
+            GraphPartitioner<PartitionGraphT>(graph, node_centroids)({256, 4096, 65536, 1048576});
+        TIMER_STOP(partitioning);
+        SimpleLogger().Write() << "Partitioned graph into " << partition.GetNumberOfLevels()
+                               << " levels in " << TIMER_SEC(partitioning) << " sec";
+
+        boost::filesystem::ofstream partition_output_stream(config.partition_output_path,
+                                                            std::ios::binary);
+        partition_output_stream << partition;
+    }
+
+    WriteCustomizedCells(graph, partition, check_sum, config.cells_output_path);
+}
+
 unsigned Prepare::CalculateEdgeChecksum(std::unique_ptr<std::vector<EdgeBasedNode>> node_based_edge_list)
 {
     RangebasedCRC32 crc32;
@@ -265,19 +408,7 @@ unsigned Prepare::CalculateEdgeChecksum(std::unique_ptr<std::vector<EdgeBasedNod
 void Prepare::SetupScriptingEnvironment(
     lua_State *lua_state, EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile)
 {
-    // open utility libraries string library;
-    luaL_openlibs(lua_state);
-
-    // adjust lua load path
-    luaAddScriptFolderToLoadPath(lua_state, config.profile_path.string().c_str());
-
-    // Now call our function in a lua script
-    if (0 != luaL_dofile(lua_state, config.profile_path.string().c_str()))
-    {
-        std::stringstream msg;
-        msg << lua_tostring(lua_state, -1) << " occured in scripting block";
-        throw osrm::exception(msg.str());
-    }
+    LoadProfile(lua_state);
 
     if (0 != luaL_dostring(lua_state, "return traffic_signal_penalty\n"))
     {
@@ -298,6 +429,57 @@ void Prepare::SetupScriptingEnvironment(
 
     speed_profile.u_turn_penalty = 10 * lua_tointeger(lua_state, -1);
     speed_profile.has_turn_penalty_function = lua_function_exists(lua_state, "turn_function");
+
+    // turn_function only depends on the angle, unless the profile says otherwise it is sampled
+    // once here instead of being called for every turn
+    bool precompute_turn_penalties = true;
+    if (0 == luaL_dostring(lua_state, "return precompute_turn_penalties\n") &&
+        lua_isboolean(lua_state, -1))
+    {
+        precompute_turn_penalties = lua_toboolean(lua_state, -1);
+    }
+    // the value or the error message
+    lua_pop(lua_state, 1);
+    if (speed_profile.has_turn_penalty_function && precompute_turn_penalties)
+    {
+        const int resolution = EdgeBasedGraphFactory::SpeedProfileProperties::TurnPenaltyResolution;
+        speed_profile.turn_penalty_table.reserve(360 * resolution + 1);
+        for (const auto step : osrm::irange(0, 360 * resolution + 1))
+        {
+            const double angle = step / static_cast<double>(resolution);
+            try
+            {
+                speed_profile.turn_penalty_table.push_back(
+                    luabind::call_function<int>(lua_state, "turn_function", 180. - angle));
+            }
+            catch (const luabind::error &er)
+            {
+                throw osrm::exception(std::string("turn_function failed: ") + er.what());
+            }
+        }
+        SimpleLogger().Write(logDEBUG) << "sampled turn_function at "
+                                       << speed_profile.turn_penalty_table.size() << " angles";
+    }
+}
+
+/**
+    \brief Loads the profile into a lua state
+*/
+void Prepare::LoadProfile(lua_State *lua_state) const
+{
+    // open utility libraries string library;
+    luaL_openlibs(lua_state);
+
+    // adjust lua load path
+    luaAddScriptFolderToLoadPath(lua_state, config.profile_path.string().c_str());
+
+    // Now call our function in a lua script
+    if (0 != luaL_dofile(lua_state, config.profile_path.string().c_str()))
+    {
+        std::stringstream msg;
+        msg << lua_tostring(lua_state, -1) << " occured in scripting block";
+        throw osrm::exception(msg.str());
+    }
 }
 
 /**
@@ -345,6 +527,122 @@ Prepare::LoadNodeBasedGraph(std::vector<NodeID> &barrier_node_list,
     return NodeBasedDynamicGraphFromImportEdges(number_of_node_based_nodes, edge_list);
 }
 
+/**
+  \brief Overrides the weights of single segments with the speeds of the segment speed file
+
+  The file is streamed line by line, the node ids are joined against the node array, which is
+  sorted by OSM id, so no index of the file or of the graph needs to be kept in memory.
+  Every later step derives its weights from the node-based graph, so the geometry and the
+  edge-expanded graph match the new speeds.
+  */
+void Prepare::ApplySegmentSpeeds(NodeBasedDynamicGraph &node_based_graph,
+                                 const std::vector<QueryNode> &internal_to_external_node_map) const
+{
+    const auto compare_osm_id = [](const QueryNode &node, const NodeID osm_id)
+    {
+        return node.node_id < osm_id;
+    };
+    const auto get_internal_id = [&](const NodeID osm_id)
+    {
+        const auto iter = std::lower_bound(internal_to_external_node_map.begin(),
+                                           internal_to_external_node_map.end(), osm_id,
+                                           compare_osm_id);
+        if (iter == internal_to_external_node_map.end() || iter->node_id != osm_id)
+        {
+            return SPECIAL_NODEID;
+        }
+        return static_cast<NodeID>(iter - internal_to_external_node_map.begin());
+    };
+    if (!std::is_sorted(internal_to_external_node_map.begin(), internal_to_external_node_map.end(),
+                        [](const QueryNode &lhs, const QueryNode &rhs)
+                        {
+                            return lhs.node_id < rhs.node_id;
+                        }))
+    {
+        throw osrm::exception("Nodes of " + config.osrm_input_path.string() +
+                              " are not sorted by id, rerun osrm-extract");
+    }
+
+    boost::filesystem::ifstream segment_speed_stream(config.segment_speed_lookup_path);
+
+    std::size_t line_number = 0;
+    std::size_t number_of_segments = 0;
+    std::size_t number_of_updated_edges = 0;
+    std::size_t number_of_unknown_segments = 0;
+    std::string line;
+    while (std::getline(segment_speed_stream, line))
+    {
+        ++line_number;
+        if (line.empty())
+        {
+            continue;
+        }
+
+        NodeID from_osm_id = 0;
+        NodeID to_osm_id = 0;
+        double speed = 0;
+        auto first = line.cbegin();
+        const bool parsed = boost::spirit::qi::parse(
+            first, line.cend(), boost::spirit::qi::uint_ >> ',' >> boost::spirit::qi::uint_ >>
+                                    ',' >> boost::spirit::qi::double_,
+            from_osm_id, to_osm_id, speed);
+        if (!parsed || first != line.cend() || speed <= 0)
+        {
+            throw osrm::exception("Invalid segment speed in line " + std::to_string(line_number) +
+                                  " of " + config.segment_speed_lookup_path.string());
+        }
+        ++number_of_segments;
+
+        const NodeID from = get_internal_id(from_osm_id);
+        const NodeID to = get_internal_id(to_osm_id);
+        if (SPECIAL_NODEID == from || SPECIAL_NODEID == to)
+        {
+            ++number_of_unknown_segments;
+            continue;
+        }
+
+        // same computation as in the extractor
+        const QueryNode &from_node = internal_to_external_node_map[from];
+        const QueryNode &to_node = internal_to_external_node_map[to];
+        const double distance = coordinate_calculation::euclidean_distance(
+            from_node.lat, from_node.lon, to_node.lat, to_node.lon);
+        const int weight =
+            std::max(1, static_cast<int>(std::floor((distance * 10.) / (speed / 3.6) + .5)));
+
+        // the edge of the segment direction is stored at its source, a one-way segment also has
+        // an incoming copy at its target. Bidirectional copies at the target carry the weight of
+        // the opposite direction and are left alone.
+        bool found_segment = false;
+        for (const auto edge : node_based_graph.GetAdjacentEdgeRange(from))
+        {
+            auto &data = node_based_graph.GetEdgeData(edge);
+            if (node_based_graph.GetTarget(edge) == to && data.forward)
+            {
+                data.distance = weight;
+                found_segment = true;
+                ++number_of_updated_edges;
+            }
+        }
+        for (const auto edge : node_based_graph.GetAdjacentEdgeRange(to))
+        {
+            auto &data = node_based_graph.GetEdgeData(edge);
+            if (node_based_graph.GetTarget(edge) == from && data.backward && !data.forward)
+            {
+                data.distance = weight;
+                ++number_of_updated_edges;
+            }
+        }
+        if (!found_segment)
+        {
+            ++number_of_unknown_segments;
+        }
+    }
+
+    SimpleLogger().Write() << "Applied " << number_of_segments << " segment speeds to "
+                           << number_of_updated_edges << " edges, " << number_of_unknown_segments
+                           << " segments are not in the graph";
+}
+
 
 /**
  \brief Building an edge-expanded graph from node-based input and turn restrictions
@@ -360,6 +658,7 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
     EdgeBasedGraphFactory::SpeedProfileProperties speed_profile;
 
     SetupScriptingEnvironment(lua_state, speed_profile);
+    lua_close(lua_state);
 
     auto barrier_node_list = osrm::make_unique<std::vector<NodeID>>();
     auto traffic_light_list = osrm::make_unique<std::vector<NodeID>>();
@@ -367,6 +666,11 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
     auto restriction_map = LoadRestrictionMap();
     auto node_based_graph = LoadNodeBasedGraph(*barrier_node_list, *traffic_light_list, internal_to_external_node_map);
 
+    if (!config.segment_speed_lookup_path.empty())
+    {
+        ApplySegmentSpeeds(*node_based_graph, internal_to_external_node_map);
+    }
+
     const std::size_t number_of_node_based_nodes = node_based_graph->GetNumberOfNodes();
 
     EdgeBasedGraphFactory edge_based_graph_factory(node_based_graph,
@@ -376,8 +680,16 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
                                                    internal_to_external_node_map,
                                                    speed_profile);
 
-    edge_based_graph_factory.Run(config.edge_output_path, config.geometry_output_path, lua_state);
-    lua_close(lua_state);
+    // the turn function is evaluated in parallel, every thread gets its own lua state
+    const auto create_lua_state = [this]()
+    {
+        std::shared_ptr<lua_State> thread_lua_state(luaL_newstate(), lua_close);
+        luabind::open(thread_lua_state.get());
+        LoadProfile(thread_lua_state.get());
+        return thread_lua_state;
+    };
+    edge_based_graph_factory.Run(config.edge_output_path, config.geometry_output_path,
+                                 create_lua_state);
 
     const std::size_t number_of_edge_based_nodes =
         edge_based_graph_factory.GetNumberOfEdgeBasedNodes();
@@ -395,11 +707,257 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
  */
 void Prepare::ContractGraph(const std::size_t number_of_edge_based_nodes,
                             DeallocatingVector<EdgeBasedEdge>& edge_based_edge_list,
-                            DeallocatingVector<QueryEdge>& contracted_edge_list)
+                            DeallocatingVector<QueryEdge>& contracted_edge_list,
+                            std::vector<float>& node_levels,
+                            std::vector<bool>& is_core_node)
 {
-    Contractor contractor(number_of_edge_based_nodes, edge_based_edge_list);
-    contractor.Run();
-    contractor.GetEdges(contracted_edge_list);
+    if (config.use_cached_priority)
+    {
+        ReadNodeLevels(node_levels);
+        if (node_levels.size() != number_of_edge_based_nodes)
+        {
+            throw osrm::exception("Level file " + config.level_output_path +
+                                  " does not match the graph, run without --level-cache");
+        }
+        SimpleLogger().Write() << "Contracting in the order of " << config.level_output_path;
+    }
+
+    std::unique_ptr<Contractor> contractor;
+    if (config.resume)
+    {
+        SimpleLogger().Write() << "Resuming from " << config.checkpoint_output_path;
+        const auto input_checksum = Contractor::InputChecksum(edge_based_edge_list);
+        edge_based_edge_list.clear();
+        contractor = osrm::make_unique<Contractor>(config.checkpoint_output_path);
+        if (contractor->GetNumberOfInputNodes() != number_of_edge_based_nodes ||
+            contractor->GetInputChecksum() != input_checksum ||
+            contractor->UsesCachedNodeLevels() != config.use_cached_priority)
+        {
+            throw osrm::exception("Checkpoint " + config.checkpoint_output_path +
+                                  " was written for a different input or options");
+        }
+    }
+    else
+    {
+        contractor = osrm::make_unique<Contractor>(number_of_edge_based_nodes,
+                                                   edge_based_edge_list, std::move(node_levels));
+    }
+    if (config.use_checkpoints || config.checkpoint_interval > 0)
+    {
+        contractor->EnableCheckpoints(config.checkpoint_output_path, config.checkpoint_interval);
+    }
+    contractor->Run(config.core_factor);
+    if (!config.contraction_report_path.empty())
+    {
+        WriteContractionReport(*contractor);
+    }
+
+    contractor->GetNodeLevels(node_levels);
+    contractor->GetCoreMarker(is_core_node);
+    if (!config.use_cached_priority)
+    {
+        WriteNodeLevels(node_levels);
+    }
+
+    contractor->GetEdges(contracted_edge_list);
+
+    // the contraction is complete, an old checkpoint would resume a finished run
+    boost::filesystem::remove(config.checkpoint_output_path);
+    boost::filesystem::remove(config.checkpoint_output_path + ".external");
+}
+
+/**
+  \brief Writes the statistics of each contraction round as json
+
+  Rounds of an earlier run that was resumed from a checkpoint are not part of the report.
+ */
+void Prepare::WriteContractionReport(const Contractor &contractor) const
+{
+    const auto to_json = [](const Contractor::WitnessStatistics &witness)
+    {
+        osrm::json::Object json_witness;
+        json_witness.values["searches"] = witness.searches;
+        json_witness.values["settled_nodes"] = witness.settled_nodes;
+        json_witness.values["settle_limit_hits"] = witness.limit_hits;
+        return json_witness;
+    };
+
+    osrm::json::Array json_rounds;
+    for (const auto &round : contractor.GetRoundStatistics())
+    {
+        osrm::json::Object json_round;
+        json_round.values["round"] = round.round;
+        json_round.values["remaining_nodes"] = round.remaining_nodes;
+        json_round.values["independent_nodes"] = round.independent_nodes;
+        json_round.values["shortcuts_added"] = round.shortcuts_added;
+        json_round.values["shortcuts_updated"] = round.shortcuts_updated;
+        json_round.values["edges_deleted"] = round.edges_deleted;
+        json_round.values["contract_witness"] = to_json(round.contract_witness);
+        json_round.values["update_witness"] = to_json(round.update_witness);
+        json_round.values["graph_edges"] = round.graph_edges;
+        // kilobytes keep the number within the precision of the renderer
+        if (round.resident_set_size != 0)
+        {
+            json_round.values["resident_set_kb"] = round.resident_set_size / 1024;
+        }
+
+        osrm::json::Object json_times;
+        json_times.values["independent_set"] = round.independent_set_time;
+        json_times.values["contract"] = round.contract_time;
+        json_times.values["delete"] = round.delete_time;
+        json_times.values["insert"] = round.insert_time;
+        json_times.values["update"] = round.update_time;
+        json_round.values["seconds"] = json_times;
+
+        json_rounds.values.push_back(json_round);
+    }
+
+    osrm::json::Object json_report;
+    json_report.values["number_of_nodes"] = contractor.GetNumberOfInputNodes();
+    json_report.values["rounds"] = json_rounds;
+
+    boost::filesystem::ofstream report_stream(config.contraction_report_path);
+    if (!report_stream)
+    {
+        throw osrm::exception("Could not write contraction report " +
+                              config.contraction_report_path.string());
+    }
+    osrm::json::render(report_stream, json_report);
+    SimpleLogger().Write() << "Wrote statistics of " << contractor.GetRoundStatistics().size()
+                           << " rounds to " << config.contraction_report_path.string();
+}
+
+/**
+  \brief Gives the nodes of the contracted graph ids that are close for nodes used together
+
+  Every query ends in the top levels of the hierarchy, these nodes come first and are
+  contiguous. Within a level, the nodes follow the hilbert curve of their location.
+  Only the ids of the edge-based nodes change. The ids of the original edges, the geometry and
+  the node-based nodes stay the same, so the .edges, .geometry and .nodes files are not affected.
+ */
+void Prepare::RenumberNodes(const std::vector<float> &node_levels,
+                            const std::vector<QueryNode> &internal_to_external_node_map,
+                            std::vector<EdgeBasedNode> &node_based_edge_list,
+                            DeallocatingVector<QueryEdge> &contracted_edge_list,
+                            std::vector<bool> &is_core_node) const
+{
+    const NodeID number_of_nodes = static_cast<NodeID>(node_levels.size());
+
+    // nodes without a segment keep the hilbert value 0
+    std::vector<uint64_t> hilbert_values(number_of_nodes, 0);
+    HilbertCode get_hilbert_number;
+    for (const EdgeBasedNode &node : node_based_edge_list)
+    {
+        const uint64_t hilbert_value = get_hilbert_number(EdgeBasedNode::Centroid(
+            FixedPointCoordinate(internal_to_external_node_map[node.u].lat,
+                                 internal_to_external_node_map[node.u].lon),
+            FixedPointCoordinate(internal_to_external_node_map[node.v].lat,
+                                 internal_to_external_node_map[node.v].lon)));
+        if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+        {
+            hilbert_values[node.forward_edge_based_node_id] = hilbert_value;
+        }
+        if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+        {
+            hilbert_values[node.reverse_edge_based_node_id] = hilbert_value;
+        }
+    }
+
+    std::vector<NodeID> order(number_of_nodes);
+    std::iota(order.begin(), order.end(), 0);
+    tbb::parallel_sort(order.begin(), order.end(), [&](const NodeID lhs, const NodeID rhs)
+                       {
+                           if (node_levels[lhs] != node_levels[rhs])
+                           {
+                               return node_levels[lhs] > node_levels[rhs];
+                           }
+                           if (hilbert_values[lhs] != hilbert_values[rhs])
+                           {
+                               return hilbert_values[lhs] < hilbert_values[rhs];
+                           }
+                           return lhs < rhs;
+                       });
+
+    std::vector<NodeID> new_node_ids(number_of_nodes);
+    for (const auto position : osrm::irange<NodeID>(0, number_of_nodes))
+    {
+        new_node_ids[order[position]] = position;
+    }
+
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, node_based_edge_list.size()),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          for (const auto i : osrm::irange(range.begin(), range.end()))
+                          {
+                              EdgeBasedNode &node = node_based_edge_list[i];
+                              if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+                              {
+                                  node.forward_edge_based_node_id =
+                                      new_node_ids[node.forward_edge_based_node_id];
+                              }
+                              if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+                              {
+                                  node.reverse_edge_based_node_id =
+                                      new_node_ids[node.reverse_edge_based_node_id];
+                              }
+                          }
+                      });
+
+    for (QueryEdge &edge : contracted_edge_list)
+    {
+        edge.source = new_node_ids[edge.source];
+        edge.target = new_node_ids[edge.target];
+        // shortcuts refer to their middle node, other edges to their original edge data
+        if (edge.data.shortcut)
+        {
+            edge.data.id = new_node_ids[edge.data.id];
+        }
+    }
+
+    if (!is_core_node.empty())
+    {
+        std::vector<bool> renumbered_is_core_node(number_of_nodes, false);
+        for (const auto node : osrm::irange<NodeID>(0, number_of_nodes))
+        {
+            renumbered_is_core_node[new_node_ids[node]] = is_core_node[node];
+        }
+        is_core_node.swap(renumbered_is_core_node);
+    }
+}
+
+/**
+  \brief Reads the contraction levels of an earlier run
+ */
+void Prepare::ReadNodeLevels(std::vector<float> &node_levels) const
+{
+    boost::filesystem::ifstream order_input_stream(config.level_output_path, std::ios::binary);
+
+    unsigned level_size = 0;
+    order_input_stream.read((char *)&level_size, sizeof(unsigned));
+    node_levels.resize(level_size);
+    if (level_size > 0)
+    {
+        order_input_stream.read((char *)node_levels.data(), sizeof(float) * level_size);
+    }
+    if (!order_input_stream)
+    {
+        throw osrm::exception("Level file " + config.level_output_path + " is truncated");
+    }
+}
+
+/**
+  \brief Writes the contraction level of each node, to be reused with --level-cache
+ */
+void Prepare::WriteNodeLevels(const std::vector<float> &node_levels) const
+{
+    boost::filesystem::ofstream order_output_stream(config.level_output_path, std::ios::binary);
+
+    const unsigned level_size = node_levels.size();
+    order_output_stream.write((char *)&level_size, sizeof(unsigned));
+    if (level_size > 0)
+    {
+        order_output_stream.write((char *)node_levels.data(), sizeof(float) * level_size);
+    }
 }
 
 /**
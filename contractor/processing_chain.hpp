@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/static_graph.hpp"
 
+class Contractor;
 struct EdgeBasedNode;
 struct lua_State;
 
@@ -60,22 +61,41 @@ class Prepare
   protected:
     void SetupScriptingEnvironment(lua_State *myLuaState,
                                    EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile);
+    void LoadProfile(lua_State *lua_state) const;
     std::shared_ptr<RestrictionMap> LoadRestrictionMap();
     unsigned CalculateEdgeChecksum(std::unique_ptr<std::vector<EdgeBasedNode>> node_based_edge_list);
+    void ReadNodeLevels(std::vector<float> &node_levels) const;
+    void WriteNodeLevels(const std::vector<float> &node_levels) const;
+    void WriteContractionReport(const Contractor &contractor) const;
     void ContractGraph(const std::size_t number_of_edge_based_nodes,
                        DeallocatingVector<EdgeBasedEdge>& edge_based_edge_list,
-                       DeallocatingVector<QueryEdge>& contracted_edge_list);
+                       DeallocatingVector<QueryEdge>& contracted_edge_list,
+                       std::vector<float>& node_levels,
+                       std::vector<bool>& is_core_node);
+    void RenumberNodes(const std::vector<float> &node_levels,
+                       const std::vector<QueryNode> &internal_to_external_node_map,
+                       std::vector<EdgeBasedNode> &node_based_edge_list,
+                       DeallocatingVector<QueryEdge> &contracted_edge_list,
+                       std::vector<bool> &is_core_node) const;
     std::size_t WriteContractedGraph(unsigned number_of_edge_based_nodes,
                                      std::unique_ptr<std::vector<EdgeBasedNode>> node_based_edge_list,
-                                     std::unique_ptr<DeallocatingVector<QueryEdge>> contracted_edge_list);
+                                     std::unique_ptr<DeallocatingVector<QueryEdge>> contracted_edge_list,
+                                     const std::vector<bool> &is_core_node);
     std::shared_ptr<NodeBasedDynamicGraph> LoadNodeBasedGraph(std::vector<NodeID> &barrier_node_list,
                                                std::vector<NodeID> &traffic_light_list,
                                                std::vector<QueryNode>& internal_to_external_node_map);
+    void ApplySegmentSpeeds(NodeBasedDynamicGraph &node_based_graph,
+                            const std::vector<QueryNode> &internal_to_external_node_map) const;
     std::pair<std::size_t, std::size_t>
     BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_node_map,
                                        std::vector<EdgeBasedNode> &node_based_edge_list,
                                        DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
     void WriteNodeMapping(std::unique_ptr<std::vector<QueryNode>> internal_to_external_node_map);
+    void ComputeNodeCentroids(const std::vector<EdgeBasedNode> &node_based_edge_list,
+                              const std::vector<QueryNode> &internal_to_external_node_map,
+                              const std::size_t number_of_edge_based_nodes,
+                              std::vector<FixedPointCoordinate> &node_centroids) const;
+    void PartitionGraph(const std::vector<FixedPointCoordinate> &node_centroids) const;
     void BuildRTree(const std::vector<EdgeBasedNode> &node_based_edge_list,
                     const std::vector<QueryNode> &internal_to_external_node_map);
   private:
@@ -0,0 +1,106 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "contractor/cell_customizer.hpp"
+#include "data_structures/multi_level_partition.hpp"
+#include "data_structures/query_edge.hpp"
+#include "data_structures/static_graph.hpp"
+#include "util/graph_loader.hpp"
+#include "util/osrm_exception.hpp"
+#include "util/simple_logger.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+using EdgeData = QueryEdge::EdgeData;
+using QueryGraph = StaticGraph<EdgeData>;
+
+// Recomputes the .cells overlay of a graph prepared with osrm-prepare --mld for the weights of its
+// current .hsgr, the partition is left untouched.
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        if (argc < 2 || argc > 3)
+        {
+            SimpleLogger().Write(logWARNING) << "usage: " << argv[0]
+                                             << " <file.osrm> [number of threads]";
+            return 1;
+        }
+
+        const std::string base_path(argv[1]);
+        const boost::filesystem::path hsgr_path(base_path + ".hsgr");
+        const boost::filesystem::path partition_path(base_path + ".partition");
+        const boost::filesystem::path cells_path(base_path + ".cells");
+
+        if (!boost::filesystem::is_regular_file(partition_path))
+        {
+            throw osrm::exception(partition_path.string() + " not found, run osrm-prepare --mld");
+        }
+
+        const int number_of_threads =
+            argc == 3 ? std::stoi(argv[2]) : tbb::task_scheduler_init::default_num_threads();
+        tbb::task_scheduler_init init(number_of_threads);
+
+        std::vector<QueryGraph::NodeArrayEntry> node_list;
+        std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+        std::vector<bool> is_core_node;
+        unsigned check_sum = 0;
+        SimpleLogger().Write() << "loading graph from " << hsgr_path.string();
+        readHSGRFromStream(hsgr_path, node_list, edge_list, &check_sum, &is_core_node);
+        // the cells are computed on the plain edge-based graph, shortcuts would be counted twice
+        if (is_core_node.empty())
+        {
+            throw osrm::exception(hsgr_path.string() + " is contracted, run osrm-prepare --mld");
+        }
+        const QueryGraph graph(node_list, edge_list);
+
+        MultiLevelPartition partition;
+        boost::filesystem::ifstream partition_input_stream(partition_path, std::ios::binary);
+        partition_input_stream >> partition;
+        if (partition.GetNumberOfNodes() != graph.GetNumberOfNodes())
+        {
+            throw osrm::exception(partition_path.string() + " does not match the graph");
+        }
+
+        WriteCustomizedCells(graph, partition, check_sum, cells_path);
+        SimpleLogger().Write() << "finished customization";
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+    return 0;
+}
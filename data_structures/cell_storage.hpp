@@ -0,0 +1,316 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CELL_STORAGE_HPP
+#define CELL_STORAGE_HPP
+
+#include "multi_level_partition.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+#include "../util/integer_range.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/**
+ * Overlay graph of a multi-level partition.
+ *
+ * Every cell has the boundary nodes that are entered from outside of the cell (sources)
+ * and those that leave it (destinations). The customization fills in the weight of the
+ * shortest path inside the cell from each source to each destination.
+ */
+template <bool UseSharedMemory> class CellStorageImpl
+{
+  public:
+    using LevelID = MultiLevelPartition::LevelID;
+    using CellID = MultiLevelPartition::CellID;
+
+    template <typename WeightT> class CellImpl
+    {
+      public:
+        CellImpl(WeightT *weights,
+                 const NodeID *sources,
+                 const unsigned number_of_sources,
+                 const NodeID *destinations,
+                 const unsigned number_of_destinations)
+            : weights(weights), sources(sources), number_of_sources(number_of_sources),
+              destinations(destinations), number_of_destinations(number_of_destinations)
+        {
+        }
+
+        unsigned GetNumberOfSources() const { return number_of_sources; }
+
+        unsigned GetNumberOfDestinations() const { return number_of_destinations; }
+
+        NodeID GetSource(const unsigned index) const
+        {
+            BOOST_ASSERT(index < number_of_sources);
+            return sources[index];
+        }
+
+        NodeID GetDestination(const unsigned index) const
+        {
+            BOOST_ASSERT(index < number_of_destinations);
+            return destinations[index];
+        }
+
+        // position of node among the sources, GetNumberOfSources() if it is none
+        unsigned GetSourceIndex(const NodeID node) const
+        {
+            return FindNode(sources, number_of_sources, node);
+        }
+
+        // position of node among the destinations, GetNumberOfDestinations() if it is none
+        unsigned GetDestinationIndex(const NodeID node) const
+        {
+            return FindNode(destinations, number_of_destinations, node);
+        }
+
+        WeightT &GetWeight(const unsigned source_index, const unsigned destination_index) const
+        {
+            BOOST_ASSERT(source_index < number_of_sources);
+            BOOST_ASSERT(destination_index < number_of_destinations);
+            return weights[static_cast<std::size_t>(source_index) * number_of_destinations +
+                           destination_index];
+        }
+
+      private:
+        static unsigned FindNode(const NodeID *nodes, const unsigned size, const NodeID node)
+        {
+            const NodeID *position = std::lower_bound(nodes, nodes + size, node);
+            if (position != nodes + size && *position == node)
+            {
+                return static_cast<unsigned>(position - nodes);
+            }
+            return size;
+        }
+
+        WeightT *weights;
+        const NodeID *sources;
+        unsigned number_of_sources;
+        const NodeID *destinations;
+        unsigned number_of_destinations;
+    };
+
+    using Cell = CellImpl<EdgeWeight>;
+    using ConstCell = CellImpl<const EdgeWeight>;
+
+    struct CellData
+    {
+        CellData()
+            : weight_offset(0), source_offset(0), destination_offset(0), number_of_sources(0),
+              number_of_destinations(0)
+        {
+        }
+
+        std::uint64_t weight_offset;
+        std::uint64_t source_offset;
+        std::uint64_t destination_offset;
+        unsigned number_of_sources;
+        unsigned number_of_destinations;
+    };
+
+    CellStorageImpl() {}
+
+    // finds the boundary nodes of all cells, weights are INVALID_EDGE_WEIGHT until customized
+    template <class GraphT>
+    CellStorageImpl(const MultiLevelPartition &partition, const GraphT &graph)
+    {
+        static_assert(!UseSharedMemory, "cells in shared memory are read-only");
+        enum BoundaryFlags : unsigned char
+        {
+            SOURCE = 1,
+            DESTINATION = 2
+        };
+        const NodeID number_of_nodes = partition.GetNumberOfNodes();
+        BOOST_ASSERT(number_of_nodes == graph.GetNumberOfNodes());
+        std::vector<unsigned char> boundary_flags(number_of_nodes);
+
+        for (const auto level : osrm::irange<LevelID>(1, partition.GetNumberOfLevels() + 1))
+        {
+            const CellID number_of_cells = partition.GetNumberOfCells(level);
+            const std::size_t first_cell = cells.size();
+            level_offsets.push_back(first_cell);
+            cells.resize(first_cell + number_of_cells, CellData());
+
+            std::fill(boundary_flags.begin(), boundary_flags.end(), 0);
+            for (const auto node : osrm::irange<NodeID>(0, number_of_nodes))
+            {
+                const CellID cell = partition.GetCell(level, node);
+                for (const auto edge : graph.GetAdjacentEdgeRange(node))
+                {
+                    const NodeID target = graph.GetTarget(edge);
+                    if (partition.GetCell(level, target) == cell)
+                    {
+                        continue;
+                    }
+                    const auto &data = graph.GetEdgeData(edge);
+                    if (data.forward)
+                    {
+                        boundary_flags[node] |= DESTINATION;
+                    }
+                    if (data.backward)
+                    {
+                        boundary_flags[node] |= SOURCE;
+                    }
+                }
+                CellData &cell_data = cells[first_cell + cell];
+                cell_data.number_of_sources += (boundary_flags[node] & SOURCE) ? 1 : 0;
+                cell_data.number_of_destinations += (boundary_flags[node] & DESTINATION) ? 1 : 0;
+            }
+
+            for (const auto cell : osrm::irange<CellID>(0, number_of_cells))
+            {
+                CellData &cell_data = cells[first_cell + cell];
+                cell_data.source_offset = boundary_nodes.size();
+                cell_data.destination_offset =
+                    cell_data.source_offset + cell_data.number_of_sources;
+                cell_data.weight_offset = weights.size();
+                boundary_nodes.resize(cell_data.destination_offset +
+                                      cell_data.number_of_destinations);
+                weights.resize(weights.size() +
+                                   static_cast<std::size_t>(cell_data.number_of_sources) *
+                                       cell_data.number_of_destinations,
+                               INVALID_EDGE_WEIGHT);
+                // used as fill positions below
+                cell_data.number_of_sources = 0;
+                cell_data.number_of_destinations = 0;
+            }
+
+            // nodes are visited in increasing order, so the boundary nodes of a cell are sorted
+            for (const auto node : osrm::irange<NodeID>(0, number_of_nodes))
+            {
+                CellData &cell_data = cells[first_cell + partition.GetCell(level, node)];
+                if (boundary_flags[node] & SOURCE)
+                {
+                    boundary_nodes[cell_data.source_offset + cell_data.number_of_sources++] = node;
+                }
+                if (boundary_flags[node] & DESTINATION)
+                {
+                    boundary_nodes[cell_data.destination_offset +
+                                   cell_data.number_of_destinations++] = node;
+                }
+            }
+        }
+        level_offsets.push_back(cells.size());
+    }
+
+    // cells that osrm-datastore put into shared memory
+    CellStorageImpl(typename ShM<std::uint64_t, UseSharedMemory>::vector offsets,
+                    typename ShM<CellData, UseSharedMemory>::vector cell_data,
+                    typename ShM<NodeID, UseSharedMemory>::vector nodes,
+                    typename ShM<EdgeWeight, UseSharedMemory>::vector cell_weights)
+    {
+        level_offsets.swap(offsets);
+        cells.swap(cell_data);
+        boundary_nodes.swap(nodes);
+        weights.swap(cell_weights);
+    }
+
+    LevelID GetNumberOfLevels() const
+    {
+        return level_offsets.empty() ? 0 : static_cast<LevelID>(level_offsets.size() - 1);
+    }
+
+    ConstCell GetCell(const LevelID level, const CellID id) const
+    {
+        const CellData &cell_data = GetCellData(level, id);
+        return ConstCell(weights.data() + cell_data.weight_offset,
+                         boundary_nodes.data() + cell_data.source_offset,
+                         cell_data.number_of_sources,
+                         boundary_nodes.data() + cell_data.destination_offset,
+                         cell_data.number_of_destinations);
+    }
+
+    Cell GetCell(const LevelID level, const CellID id)
+    {
+        const CellData &cell_data = GetCellData(level, id);
+        return Cell(weights.data() + cell_data.weight_offset,
+                    boundary_nodes.data() + cell_data.source_offset, cell_data.number_of_sources,
+                    boundary_nodes.data() + cell_data.destination_offset,
+                    cell_data.number_of_destinations);
+    }
+
+    friend std::ostream &operator<<(std::ostream &out, const CellStorageImpl<false> &storage);
+    friend std::istream &operator>>(std::istream &in, CellStorageImpl<false> &storage);
+
+  private:
+    const CellData &GetCellData(const LevelID level, const CellID id) const
+    {
+        BOOST_ASSERT(level > 0 && level < level_offsets.size());
+        BOOST_ASSERT(level_offsets[level - 1] + id < level_offsets[level]);
+        return cells[level_offsets[level - 1] + id];
+    }
+
+    // index of the first cell of each level in cells, and the total number of cells
+    typename ShM<std::uint64_t, UseSharedMemory>::vector level_offsets;
+    typename ShM<CellData, UseSharedMemory>::vector cells;
+    typename ShM<NodeID, UseSharedMemory>::vector boundary_nodes;
+    typename ShM<EdgeWeight, UseSharedMemory>::vector weights;
+};
+
+using CellStorage = CellStorageImpl<false>;
+
+template <typename T>
+inline void write_cell_storage_vector(std::ostream &out, const std::vector<T> &vector)
+{
+    const std::uint64_t size = vector.size();
+    out.write((char *)&size, sizeof(std::uint64_t));
+    out.write((char *)vector.data(), sizeof(T) * size);
+}
+
+template <typename T> inline void read_cell_storage_vector(std::istream &in, std::vector<T> &vector)
+{
+    std::uint64_t size = 0;
+    in.read((char *)&size, sizeof(std::uint64_t));
+    vector.resize(size);
+    in.read((char *)vector.data(), sizeof(T) * size);
+}
+
+inline std::ostream &operator<<(std::ostream &out, const CellStorage &storage)
+{
+    write_cell_storage_vector(out, storage.level_offsets);
+    write_cell_storage_vector(out, storage.cells);
+    write_cell_storage_vector(out, storage.boundary_nodes);
+    write_cell_storage_vector(out, storage.weights);
+    return out;
+}
+
+inline std::istream &operator>>(std::istream &in, CellStorage &storage)
+{
+    read_cell_storage_vector(in, storage.level_offsets);
+    read_cell_storage_vector(in, storage.cells);
+    read_cell_storage_vector(in, storage.boundary_nodes);
+    read_cell_storage_vector(in, storage.weights);
+    return in;
+}
+
+#endif // CELL_STORAGE_HPP
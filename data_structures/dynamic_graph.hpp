@@ -39,6 +39,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <atomic>
 #include <limits>
+#include <map>
+#include <numeric>
 #include <tuple>
 #include <vector>
 
@@ -76,13 +78,30 @@ template <typename EdgeDataT> class DynamicGraph
     };
 
     // Constructs an empty graph with a given number of nodes.
-    explicit DynamicGraph(NodeIterator nodes) : number_of_nodes(nodes), number_of_edges(0)
+    explicit DynamicGraph(NodeIterator nodes)
+        : number_of_nodes(nodes), number_of_edges(0), number_of_free_slots(0)
     {
-        node_array.reserve(number_of_nodes);
-        node_array.resize(number_of_nodes);
+        node_array.resize(number_of_nodes + 1);
+    }
 
-        edge_list.reserve(number_of_nodes * 1.1);
-        edge_list.resize(number_of_nodes);
+    /**
+     * Constructs an empty graph with room for node_capacities[n] edges at each node n, so that
+     * inserting that many edges does not move any adjacency block.
+     */
+    DynamicGraph(const NodeIterator nodes, const std::vector<unsigned> &node_capacities)
+        : number_of_nodes(nodes), number_of_edges(0), number_of_free_slots(0)
+    {
+        BOOST_ASSERT(node_capacities.size() == number_of_nodes);
+        node_array.resize(number_of_nodes + 1);
+        EdgeIterator position = 0;
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            node_array[node].first_edge = position;
+            node_array[node].capacity = node_capacities[node];
+            position += node_capacities[node];
+        }
+        node_array.back().first_edge = position;
+        edge_list.resize(position);
     }
 
     /**
@@ -91,6 +110,7 @@ template <typename EdgeDataT> class DynamicGraph
     template <class ContainerT> DynamicGraph(const NodeIterator nodes, const ContainerT &graph)
     {
         number_of_nodes = nodes;
+        number_of_free_slots = 0;
         number_of_edges = static_cast<EdgeIterator>(graph.size());
         // node_array.reserve(number_of_nodes + 1);
         node_array.resize(number_of_nodes + 1);
@@ -105,10 +125,10 @@ template <typename EdgeDataT> class DynamicGraph
             }
             node_array[node].first_edge = position;
             node_array[node].edges = edge - last_edge;
+            node_array[node].capacity = node_array[node].edges;
             position += node_array[node].edges;
         }
         node_array.back().first_edge = position;
-        edge_list.reserve(static_cast<std::size_t>(edge_list.size() * 1.1));
         edge_list.resize(position);
         edge = 0;
         for (const auto node : osrm::irange(0u, number_of_nodes))
@@ -129,6 +149,9 @@ template <typename EdgeDataT> class DynamicGraph
 
     unsigned GetNumberOfEdges() const { return number_of_edges; }
 
+    // room of blocks that nodes have moved out of, reclaimed by Compact()
+    std::size_t GetNumberOfFreeSlots() const { return number_of_free_slots; }
+
     unsigned GetOutDegree(const NodeIterator n) const { return node_array[n].edges; }
 
     unsigned GetDirectedOutDegree(const NodeIterator n) const
@@ -175,41 +198,31 @@ template <typename EdgeDataT> class DynamicGraph
         return number_of_nodes;
     }
 
+    // makes room for additional edges at a node. Invalidates edge iterators for the node
+    void ReserveEdges(const NodeIterator n, const unsigned additional_edges)
+    {
+        Node &node = node_array[n];
+        const unsigned required_capacity = node.edges + additional_edges;
+        if (required_capacity <= node.capacity)
+        {
+            return;
+        }
+        unsigned new_capacity = BlockSize(required_capacity);
+        const EdgeIterator new_first_edge = AllocateBlock(new_capacity);
+        for (const auto i : osrm::irange(0u, node.edges))
+        {
+            edge_list[new_first_edge + i] = edge_list[node.first_edge + i];
+        }
+        ReleaseBlock(node.first_edge, node.capacity);
+        node.first_edge = new_first_edge;
+        node.capacity = new_capacity;
+    }
+
     // adds an edge. Invalidates edge iterators for the source node
     EdgeIterator InsertEdge(const NodeIterator from, const NodeIterator to, const EdgeDataT &data)
     {
+        ReserveEdges(from, 1);
         Node &node = node_array[from];
-        EdgeIterator newFirstEdge = node.edges + node.first_edge;
-        if (newFirstEdge >= edge_list.size() || !isDummy(newFirstEdge))
-        {
-            if (node.first_edge != 0 && isDummy(node.first_edge - 1))
-            {
-                node.first_edge--;
-                edge_list[node.first_edge] = edge_list[node.first_edge + node.edges];
-            }
-            else
-            {
-                EdgeIterator newFirstEdge = (EdgeIterator)edge_list.size();
-                unsigned newSize = node.edges * 1.1 + 2;
-                EdgeIterator requiredCapacity = newSize + edge_list.size();
-                EdgeIterator oldCapacity = edge_list.capacity();
-                if (requiredCapacity >= oldCapacity)
-                {
-                    edge_list.reserve(requiredCapacity * 1.1);
-                }
-                edge_list.resize(edge_list.size() + newSize);
-                for (const auto i : osrm::irange(0u, node.edges))
-                {
-                    edge_list[newFirstEdge + i] = edge_list[node.first_edge + i];
-                    makeDummy(node.first_edge + i);
-                }
-                for (const auto i : osrm::irange(node.edges + 1, newSize))
-                {
-                    makeDummy(newFirstEdge + i);
-                }
-                node.first_edge = newFirstEdge;
-            }
-        }
         Edge &edge = edge_list[node.first_edge + node.edges];
         edge.target = to;
         edge.data = data;
@@ -229,7 +242,6 @@ template <typename EdgeDataT> class DynamicGraph
         BOOST_ASSERT(std::numeric_limits<unsigned>::max() != last);
         // swap with last edge
         edge_list[e] = edge_list[last];
-        makeDummy(last);
     }
 
     // removes all edges (source,target)
@@ -244,7 +256,6 @@ template <typename EdgeDataT> class DynamicGraph
                 {
                     deleted++;
                     edge_list[i] = edge_list[iend - deleted];
-                    makeDummy(iend - deleted);
                 } while (i < iend - deleted && edge_list[i].target == target);
             }
         }
@@ -255,6 +266,38 @@ template <typename EdgeDataT> class DynamicGraph
         return deleted;
     }
 
+    // moves all adjacency blocks together and releases the room behind them. Invalidates all edge
+    // iterators
+    void Compact()
+    {
+        std::vector<NodeIterator> nodes_by_position(number_of_nodes);
+        std::iota(nodes_by_position.begin(), nodes_by_position.end(), 0);
+        std::sort(nodes_by_position.begin(), nodes_by_position.end(),
+                  [this](const NodeIterator lhs, const NodeIterator rhs)
+                  {
+                      return node_array[lhs].first_edge < node_array[rhs].first_edge;
+                  });
+        // blocks only move towards the front, so no block is overwritten before it was moved
+        EdgeIterator position = 0;
+        for (const auto n : nodes_by_position)
+        {
+            Node &node = node_array[n];
+            if (node.first_edge != position)
+            {
+                for (const auto i : osrm::irange(0u, node.edges))
+                {
+                    edge_list[position + i] = edge_list[node.first_edge + i];
+                }
+                node.first_edge = position;
+            }
+            position += node.capacity;
+        }
+        node_array.back().first_edge = position;
+        edge_list.resize(position);
+        free_blocks.clear();
+        number_of_free_slots = 0;
+    }
+
     // searches for a specific edge
     EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
     {
@@ -308,22 +351,62 @@ template <typename EdgeDataT> class DynamicGraph
     }
 
   protected:
-    bool isDummy(const EdgeIterator edge) const
+    // Rounds up to the next block size. Sizes grow by at most a quarter, which bounds the unused
+    // room per node while keeping the number of distinct sizes in the pool small.
+    static unsigned BlockSize(const unsigned edges)
     {
-        return edge_list[edge].target == (std::numeric_limits<NodeIterator>::max)();
+        if (edges <= 8)
+        {
+            return edges + (edges % 2);
+        }
+        unsigned step = 1;
+        while ((step << 3) < edges)
+        {
+            step <<= 1;
+        }
+        return (edges + step - 1) / step * step;
     }
 
-    void makeDummy(const EdgeIterator edge)
+    // Takes a released block of at least this size from the pool or appends a new one. A pooled
+    // block may be up to twice as large, capacity is set to its actual size then.
+    EdgeIterator AllocateBlock(unsigned &capacity)
     {
-        edge_list[edge].target = (std::numeric_limits<NodeIterator>::max)();
+        const auto pooled = free_blocks.lower_bound(capacity);
+        if (pooled != free_blocks.end() && pooled->first < 2 * capacity)
+        {
+            const EdgeIterator first_edge = pooled->second.back();
+            capacity = pooled->first;
+            number_of_free_slots -= capacity;
+            pooled->second.pop_back();
+            if (pooled->second.empty())
+            {
+                free_blocks.erase(pooled);
+            }
+            return first_edge;
+        }
+        const EdgeIterator first_edge = static_cast<EdgeIterator>(edge_list.size());
+        edge_list.resize(edge_list.size() + capacity);
+        return first_edge;
+    }
+
+    void ReleaseBlock(const EdgeIterator first_edge, const unsigned capacity)
+    {
+        if (capacity > 0)
+        {
+            free_blocks[capacity].push_back(first_edge);
+            number_of_free_slots += capacity;
+        }
     }
 
     struct Node
     {
+        Node() : first_edge(0), edges(0), capacity(0) {}
         // index of the first edge
         EdgeIterator first_edge;
         // amount of edges
         unsigned edges;
+        // amount of edges that fit into the block starting at first_edge
+        unsigned capacity;
     };
 
     struct Edge
@@ -337,6 +420,9 @@ template <typename EdgeDataT> class DynamicGraph
 
     std::vector<Node> node_array;
     DeallocatingVector<Edge> edge_list;
+    // blocks left behind by nodes that outgrew them, by size
+    std::map<unsigned, std::vector<EdgeIterator>> free_blocks;
+    std::size_t number_of_free_slots;
 };
 
 #endif // DYNAMICGRAPH_HPP
@@ -0,0 +1,160 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef MULTI_LEVEL_PARTITION_HPP
+#define MULTI_LEVEL_PARTITION_HPP
+
+#include "shared_memory_vector_wrapper.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+/**
+ * Nested partition of the nodes of a graph into cells on several levels.
+ *
+ * Levels are numbered from 1, level 1 has the smallest cells. Each cell is contained in
+ * exactly one cell of the next higher level. Level 0 stands for the graph itself.
+ */
+template <bool UseSharedMemory> class MultiLevelPartitionImpl
+{
+  public:
+    using CellID = unsigned;
+    using LevelID = unsigned;
+    using CellVector = typename ShM<CellID, UseSharedMemory>::vector;
+
+    MultiLevelPartitionImpl() : number_of_levels(0), number_of_nodes(0) {}
+
+    // cells_per_level[level - 1][node] is the cell of node on that level
+    explicit MultiLevelPartitionImpl(const std::vector<std::vector<CellID>> &cells_per_level)
+        : number_of_levels(static_cast<LevelID>(cells_per_level.size())),
+          number_of_nodes(cells_per_level.empty()
+                              ? 0
+                              : static_cast<NodeID>(cells_per_level.front().size()))
+    {
+        cells.reserve(static_cast<std::size_t>(number_of_levels) * number_of_nodes);
+        static_assert(!UseSharedMemory, "a partition in shared memory is read-only");
+        for (const auto &level_cells : cells_per_level)
+        {
+            BOOST_ASSERT(level_cells.size() == number_of_nodes);
+            CellID max_cell_id = 0;
+            for (const CellID cell : level_cells)
+            {
+                max_cell_id = std::max(max_cell_id, cell);
+            }
+            number_of_cells.push_back(number_of_nodes > 0 ? max_cell_id + 1 : 0);
+            cells.insert(cells.end(), level_cells.begin(), level_cells.end());
+        }
+    }
+
+    // a partition that osrm-datastore put into shared memory
+    MultiLevelPartitionImpl(const LevelID number_of_levels,
+                            const NodeID number_of_nodes,
+                            CellVector cell_counts,
+                            CellVector node_cells)
+        : number_of_levels(number_of_levels), number_of_nodes(number_of_nodes)
+    {
+        BOOST_ASSERT(cell_counts.size() == number_of_levels);
+        BOOST_ASSERT(node_cells.size() ==
+                     static_cast<std::size_t>(number_of_levels) * number_of_nodes);
+        number_of_cells.swap(cell_counts);
+        cells.swap(node_cells);
+    }
+
+    LevelID GetNumberOfLevels() const { return number_of_levels; }
+
+    NodeID GetNumberOfNodes() const { return number_of_nodes; }
+
+    CellID GetNumberOfCells(const LevelID level) const
+    {
+        BOOST_ASSERT(level > 0 && level <= number_of_levels);
+        return number_of_cells[level - 1];
+    }
+
+    CellID GetCell(const LevelID level, const NodeID node) const
+    {
+        BOOST_ASSERT(level > 0 && level <= number_of_levels);
+        BOOST_ASSERT(node < number_of_nodes);
+        return cells[static_cast<std::size_t>(level - 1) * number_of_nodes + node];
+    }
+
+    // highest level on which the nodes are in different cells, 0 if they never are
+    LevelID GetHighestDifferentLevel(const NodeID first, const NodeID second) const
+    {
+        for (LevelID level = number_of_levels; level > 0; --level)
+        {
+            if (GetCell(level, first) != GetCell(level, second))
+            {
+                return level;
+            }
+        }
+        return 0;
+    }
+
+    friend std::ostream &operator<<(std::ostream &out,
+                                    const MultiLevelPartitionImpl<false> &partition);
+    friend std::istream &operator>>(std::istream &in, MultiLevelPartitionImpl<false> &partition);
+
+  private:
+    LevelID number_of_levels;
+    NodeID number_of_nodes;
+    CellVector number_of_cells;
+    // level after level, the cell of every node
+    CellVector cells;
+};
+
+using MultiLevelPartition = MultiLevelPartitionImpl<false>;
+
+inline std::ostream &operator<<(std::ostream &out, const MultiLevelPartition &partition)
+{
+    out.write((char *)&partition.number_of_levels, sizeof(MultiLevelPartition::LevelID));
+    out.write((char *)&partition.number_of_nodes, sizeof(NodeID));
+    out.write((char *)partition.number_of_cells.data(),
+              sizeof(MultiLevelPartition::CellID) * partition.number_of_cells.size());
+    out.write((char *)partition.cells.data(),
+              sizeof(MultiLevelPartition::CellID) * partition.cells.size());
+    return out;
+}
+
+inline std::istream &operator>>(std::istream &in, MultiLevelPartition &partition)
+{
+    in.read((char *)&partition.number_of_levels, sizeof(MultiLevelPartition::LevelID));
+    in.read((char *)&partition.number_of_nodes, sizeof(NodeID));
+    partition.number_of_cells.resize(partition.number_of_levels);
+    partition.cells.resize(static_cast<std::size_t>(partition.number_of_levels) *
+                           partition.number_of_nodes);
+    in.read((char *)partition.number_of_cells.data(),
+            sizeof(MultiLevelPartition::CellID) * partition.number_of_cells.size());
+    in.read((char *)partition.cells.data(),
+            sizeof(MultiLevelPartition::CellID) * partition.cells.size());
+    return in;
+}
+
+#endif // MULTI_LEVEL_PARTITION_HPP
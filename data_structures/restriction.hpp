@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../typedefs.h"
 
 #include <limits>
+#include <tuple>
 
 struct TurnRestriction
 {
@@ -125,7 +126,16 @@ struct CmpRestrictionContainerByTo
     using value_type = InputRestrictionContainer;
     bool operator()(const InputRestrictionContainer &a, const InputRestrictionContainer &b) const
     {
-        return a.restriction.to.way < b.restriction.to.way;
+        if (a.restriction.to.way != b.restriction.to.way || SPECIAL_EDGEID == a.restriction.to.way)
+        {
+            return a.restriction.to.way < b.restriction.to.way;
+        }
+        // restrictions are written in this order, so it has to be total
+        using KeyT = std::tuple<NodeID, NodeID, bool, bool>;
+        return KeyT(a.restriction.from.node, a.restriction.via.node, a.restriction.flags.is_only,
+                    a.restriction.flags.uses_via_way) <
+               KeyT(b.restriction.from.node, b.restriction.via.node, b.restriction.flags.is_only,
+                    b.restriction.flags.uses_via_way);
     }
     value_type max_value() const { return InputRestrictionContainer::max_value(); }
     value_type min_value() const { return InputRestrictionContainer::min_value(); }
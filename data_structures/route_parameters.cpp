@@ -139,3 +139,10 @@ void RouteParameters::getCoordinatesFromGeometry(const std::string geometry_stri
     PolylineCompressor pc;
     coordinates = pc.decode_string(geometry_string);
 }
+
+void RouteParameters::setSources(const std::vector<unsigned> &indices) { sources = indices; }
+
+void RouteParameters::setDestinations(const std::vector<unsigned> &indices)
+{
+    destinations = indices;
+}
@@ -41,7 +41,13 @@ struct HeapData
 
 struct SearchEngineData
 {
-    using QueryHeap = BinaryHeap<NodeID, NodeID, int, HeapData, UnorderedMapStorage<NodeID, int>>;
+#ifdef OSRM_ARRAY_QUERY_HEAPS
+    // O(1) lookups and clearing, at the cost of 4 bytes per node for each heap and thread
+    using QueryHeapStorage = ArrayStorage<NodeID, int>;
+#else
+    using QueryHeapStorage = UnorderedMapStorage<NodeID, int>;
+#endif
+    using QueryHeap = BinaryHeap<NodeID, NodeID, int, HeapData, QueryHeapStorage>;
     using SearchEngineHeapPtr = boost::thread_specific_ptr<QueryHeap>;
 
     static SearchEngineHeapPtr forward_heap_1;
@@ -164,6 +164,37 @@ class SharedMemory
         return Remove(key);
     }
 
+    // id that stays valid after the region was removed, -1 if the region does not exist
+    template <typename IdentifierT> static int GetRegionID(const IdentifierT id)
+    {
+        try
+        {
+            OSRMLockFile lock_file;
+            boost::interprocess::xsi_key key(lock_file().string().c_str(), id);
+            boost::interprocess::xsi_shared_memory shm(boost::interprocess::open_only, key);
+            return shm.get_shmid();
+        }
+        catch (...)
+        {
+            return -1;
+        }
+    }
+
+    // number of processes that still have the region mapped, 0 once it is freed
+    static unsigned NumberOfAttachments(const int shmid)
+    {
+#ifdef __linux__
+        struct shmid_ds status;
+        if (0 > shmid || -1 == shmctl(shmid, IPC_STAT, &status))
+        {
+            return 0;
+        }
+        return status.shm_nattch;
+#else
+        return 0;
+#endif
+    }
+
   private:
     static bool RegionExists(const boost::interprocess::xsi_key &key)
     {
@@ -296,6 +327,11 @@ class SharedMemory
         return Remove(k);
     }
 
+    // regions are freed by the OS once the last handle is closed, there is nothing to wait for
+    static int GetRegionID(const int id) { return id; }
+
+    static unsigned NumberOfAttachments(const int) { return 0; }
+
   private:
     static void build_key(int id, char *key) { sprintf(key, "%s.%d", "osrm.lock", id); }
 
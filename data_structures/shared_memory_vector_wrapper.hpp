@@ -85,6 +85,10 @@ template <typename DataT> class SharedMemoryWrapper
 
     const DataT &at(const std::size_t index) const { return m_ptr[index]; }
 
+    DataT *data() { return m_ptr; }
+
+    const DataT *data() const { return m_ptr; }
+
     ShMemIterator<DataT> begin() const { return ShMemIterator<DataT>(m_ptr); }
 
     ShMemIterator<DataT> end() const { return ShMemIterator<DataT>(m_ptr + m_size); }
@@ -135,7 +139,7 @@ template <> class SharedMemoryWrapper<bool>
 
     bool empty() const { return 0 == size(); }
 
-    bool operator[](const unsigned index)
+    bool operator[](const unsigned index) const
     {
         BOOST_ASSERT_MSG(index < m_size, "invalid size");
         const unsigned bucket = index / 32;
@@ -145,12 +145,14 @@ template <typename EdgeDataT, bool UseSharedMemory = false> class StaticGraph
 
     EdgeIterator BeginEdges(const NodeIterator n) const
     {
-        return EdgeIterator(node_array.at(n).first_edge);
+        BOOST_ASSERT(n < node_array.size());
+        return EdgeIterator(node_array[n].first_edge);
     }
 
     EdgeIterator EndEdges(const NodeIterator n) const
     {
-        return EdgeIterator(node_array.at(n + 1).first_edge);
+        BOOST_ASSERT(n + 1 < node_array.size());
+        return EdgeIterator(node_array[n + 1].first_edge);
     }
 
     // searches for a specific edge
@@ -50,6 +50,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/thread.hpp>
 
 #include <tbb/parallel_for.h>
@@ -57,6 +58,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <variant/variant.hpp>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #include <algorithm>
 #include <array>
 #include <limits>
@@ -337,7 +342,11 @@ class StaticRTree
     uint64_t m_element_count;
     const std::string m_leaf_node_filename;
     std::shared_ptr<CoordinateListT> m_coordinate_list;
-    boost::filesystem::ifstream leaves_stream;
+    // the leaves are accessed in place through a read-only mapping of the leaf file, which
+    // makes all queries const and lets every thread share a single tree
+    boost::iostreams::mapped_file_source m_leaves_region;
+    const LeafNode *m_leaves;
+    uint64_t m_number_of_leaves;
 
   public:
     StaticRTree() = delete;
@@ -348,7 +357,8 @@ class StaticRTree
                          const std::string tree_node_filename,
                          const std::string leaf_node_filename,
                          const std::vector<QueryNode> &coordinate_list)
-        : m_element_count(input_data_vector.size()), m_leaf_node_filename(leaf_node_filename)
+        : m_element_count(input_data_vector.size()), m_leaf_node_filename(leaf_node_filename),
+          m_leaves(nullptr), m_number_of_leaves(0)
     {
         SimpleLogger().Write() << "constructing r-tree of " << m_element_count
                                << " edge elements build on-top of " << coordinate_list.size()
@@ -506,7 +516,8 @@ class StaticRTree
     // Read-only operation for queries
     explicit StaticRTree(const boost::filesystem::path &node_file,
                          const boost::filesystem::path &leaf_file,
-                         const std::shared_ptr<CoordinateListT> coordinate_list)
+                         const std::shared_ptr<CoordinateListT> coordinate_list,
+                         const bool prefault_leaves = false)
         : m_leaf_node_filename(leaf_file.string())
     {
         // open tree node file and load into RAM.
@@ -531,18 +542,8 @@ class StaticRTree
             tree_node_file.read((char *)&m_search_tree[0], sizeof(TreeNode) * tree_size);
         }
         tree_node_file.close();
-        // open leaf node file and store thread specific pointer
-        if (!boost::filesystem::exists(leaf_file))
-        {
-            throw osrm::exception("mem index file does not exist");
-        }
-        if (0 == boost::filesystem::file_size(leaf_file))
-        {
-            throw osrm::exception("mem index file is empty");
-        }
 
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        MapLeafFile(leaf_file, prefault_leaves);
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
@@ -551,22 +552,12 @@ class StaticRTree
     explicit StaticRTree(TreeNode *tree_node_ptr,
                          const uint64_t number_of_nodes,
                          const boost::filesystem::path &leaf_file,
-                         std::shared_ptr<CoordinateListT> coordinate_list)
+                         std::shared_ptr<CoordinateListT> coordinate_list,
+                         const bool prefault_leaves = false)
         : m_search_tree(tree_node_ptr, number_of_nodes), m_leaf_node_filename(leaf_file.string()),
           m_coordinate_list(coordinate_list)
     {
-        // open leaf node file and store thread specific pointer
-        if (!boost::filesystem::exists(leaf_file))
-        {
-            throw osrm::exception("mem index file does not exist");
-        }
-        if (0 == boost::filesystem::file_size(leaf_file))
-        {
-            throw osrm::exception("mem index file is empty");
-        }
-
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        MapLeafFile(leaf_file, prefault_leaves);
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
@@ -575,7 +566,7 @@ class StaticRTree
 
     bool LocateClosestEndPointForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             FixedPointCoordinate &result_coordinate,
-                                            const unsigned zoom_level)
+                                            const unsigned zoom_level) const
     {
         bool ignore_tiny_components = (zoom_level <= 14);
 
@@ -595,11 +586,11 @@ class StaticRTree
             const bool prune_upward = (current_query_node.min_dist >= min_dist);
             if (!prune_downward && !prune_upward)
             { // downward pruning
-                TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
+                const TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node =
+                        LoadLeafFromDisk(current_tree_node.children[0]);
                     for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
                     {
                         EdgeDataT const &current_edge = current_leaf_node.objects[i];
@@ -646,7 +637,7 @@ class StaticRTree
         const FixedPointCoordinate &input_coordinate,
         std::vector<PhantomNode> &result_phantom_node_vector,
         const unsigned max_number_of_phantom_nodes,
-        const float max_distance = 1100)
+        const float max_distance = 1100) const
     {
         unsigned inspected_elements = 0;
         unsigned number_of_elements_from_big_cc = 0;
@@ -675,8 +666,8 @@ class StaticRTree
                     current_query_node.node.template get<TreeNode>();
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node =
+                        LoadLeafFromDisk(current_tree_node.children[0]);
 
                     // current object represents a block on disk
                     for (const auto i : osrm::irange(0u, current_leaf_node.object_count))
@@ -789,7 +780,7 @@ class StaticRTree
         const double max_distance,
         const unsigned min_number_of_phantom_nodes,
         const unsigned max_number_of_phantom_nodes,
-        const unsigned max_checked_elements = 4 * LEAF_NODE_SIZE)
+        const unsigned max_checked_elements = 4 * LEAF_NODE_SIZE) const
     {
         unsigned inspected_elements = 0;
         unsigned number_of_elements_from_big_cc = 0;
@@ -823,8 +814,8 @@ class StaticRTree
                     current_query_node.node.template get<TreeNode>();
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node =
+                        LoadLeafFromDisk(current_tree_node.children[0]);
 
                     // current object represents a block on disk
                     for (const auto i : osrm::irange(0u, current_leaf_node.object_count))
@@ -955,7 +946,7 @@ class StaticRTree
 
     bool FindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                       PhantomNode &result_phantom_node,
-                                      const unsigned zoom_level)
+                                      const unsigned zoom_level) const
     {
         const bool ignore_tiny_components = (zoom_level <= 14);
         EdgeDataT nearest_edge;
@@ -978,8 +969,8 @@ class StaticRTree
                 const TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node =
+                        LoadLeafFromDisk(current_tree_node.children[0]);
                     for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
                     {
                         const EdgeDataT &current_edge = current_leaf_node.objects[i];
@@ -1086,7 +1077,7 @@ class StaticRTree
                                  const FixedPointCoordinate &input_coordinate,
                                  const float min_dist,
                                  const float min_max_dist,
-                                 QueueT &traversal_queue)
+                                 QueueT &traversal_queue) const
     {
         float new_min_max_dist = min_max_dist;
         // traverse children, prune if global mindist is smaller than local one
@@ -1111,22 +1102,59 @@ class StaticRTree
         return new_min_max_dist;
     }
 
-    inline void LoadLeafFromDisk(const uint32_t leaf_id, LeafNode &result_node)
+    void MapLeafFile(const boost::filesystem::path &leaf_file, const bool prefault_leaves)
     {
-        if (!leaves_stream.is_open())
+        if (!boost::filesystem::exists(leaf_file))
         {
-            leaves_stream.open(m_leaf_node_filename, std::ios::in | std::ios::binary);
+            throw osrm::exception("mem index file does not exist");
+        }
+        if (sizeof(uint64_t) > boost::filesystem::file_size(leaf_file))
+        {
+            throw osrm::exception("mem index file is empty");
+        }
+
+        m_leaves_region.open(leaf_file.string());
+        if (!m_leaves_region.is_open())
+        {
+            throw osrm::exception("mem index file could not be mapped");
+        }
+
+        std::copy(m_leaves_region.data(), m_leaves_region.data() + sizeof(uint64_t),
+                  reinterpret_cast<char *>(&m_element_count));
+        m_leaves = reinterpret_cast<const LeafNode *>(m_leaves_region.data() + sizeof(uint64_t));
+        m_number_of_leaves = (m_leaves_region.size() - sizeof(uint64_t)) / sizeof(LeafNode);
+        static_assert(sizeof(uint64_t) % alignof(LeafNode) == 0,
+                      "leaves in mapped file are not properly aligned");
+
+        if (prefault_leaves)
+        {
+            PrefaultLeaves();
         }
-        if (!leaves_stream.good())
+    }
+
+    // Pulls all leaf pages into the page cache, so the first queries don't pay for page faults
+    void PrefaultLeaves() const
+    {
+        TIMER_START(prefault);
+#ifdef __linux__
+        madvise(const_cast<char *>(m_leaves_region.data()), m_leaves_region.size(),
+                MADV_WILLNEED);
+#endif
+        const std::size_t page_size = boost::iostreams::mapped_file_source::alignment();
+        volatile char checksum = 0;
+        for (std::size_t offset = 0; offset < m_leaves_region.size(); offset += page_size)
         {
-            leaves_stream.clear(std::ios::goodbit);
-            SimpleLogger().Write(logDEBUG) << "Resetting stale filestream";
+            checksum ^= m_leaves_region.data()[offset];
         }
-        const uint64_t seek_pos = sizeof(uint64_t) + leaf_id * sizeof(LeafNode);
-        leaves_stream.seekg(seek_pos);
-        BOOST_ASSERT_MSG(leaves_stream.good(), "Seeking to position in leaf file failed.");
-        leaves_stream.read((char *)&result_node, sizeof(LeafNode));
-        BOOST_ASSERT_MSG(leaves_stream.good(), "Reading from leaf file failed.");
+        TIMER_STOP(prefault);
+        SimpleLogger().Write() << "prefaulted " << m_leaves_region.size() << " bytes of leaf index in "
+                               << TIMER_SEC(prefault) << " seconds";
+    }
+
+    inline const LeafNode &LoadLeafFromDisk(const uint32_t leaf_id) const
+    {
+        BOOST_ASSERT_MSG(leaf_id < m_number_of_leaves, "leaf id out of range");
+        return m_leaves[leaf_id];
     }
 
     inline bool EdgesAreEquivalent(const FixedPointCoordinate &a,
@@ -25,6 +25,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+#include "data_structures/cell_storage.hpp"
+#include "data_structures/multi_level_partition.hpp"
 #include "data_structures/original_edge_data.hpp"
 #include "data_structures/range_table.hpp"
 #include "data_structures/query_edge.hpp"
@@ -57,12 +59,19 @@ using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
 #endif
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/iostreams/seek.hpp>
 
 #include <cstdint>
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <string>
+#include <thread>
+
+// how long to report on osrm-routed releasing the previous regions before exiting anyway
+const constexpr int RELEASE_TIMEOUT_SECONDS = 60;
 
 // delete a shared memory region. report warning if it could not be deleted
 void delete_region(const SharedDataType region)
@@ -199,6 +208,15 @@ int main(const int argc, const char *argv[])
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         BOOST_ASSERT(!paths_iterator->second.empty());
         const boost::filesystem::path &geometries_data_path = paths_iterator->second;
+        // optional, written by osrm-prepare --mld and osrm-customize
+        paths_iterator = server_paths.find("partitiondata");
+        const boost::filesystem::path partition_data_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second
+                                                 : boost::filesystem::path();
+        paths_iterator = server_paths.find("cellsdata");
+        const boost::filesystem::path cells_data_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second
+                                                 : boost::filesystem::path();
 
         // determine segment to use
         bool segment2_in_use = SharedMemory::RegionExists(LAYOUT_2);
@@ -296,6 +314,78 @@ int main(const int argc, const char *argv[])
         shared_layout_ptr->SetBlockSize<QueryGraph::EdgeArrayEntry>(
             SharedDataLayout::GRAPH_EDGE_LIST, number_of_graph_edges);
 
+        // load core marker size, they follow the edges. Older files end before them.
+        const auto graph_data_position = hsgr_input_stream.tellg();
+        hsgr_input_stream.seekg(
+            number_of_graph_nodes * sizeof(QueryGraph::NodeArrayEntry) +
+                number_of_graph_edges * sizeof(QueryGraph::EdgeArrayEntry),
+            std::ios::cur);
+        unsigned number_of_core_markers = 0;
+        hsgr_input_stream.read((char *)&number_of_core_markers, sizeof(unsigned));
+        if (!hsgr_input_stream)
+        {
+            number_of_core_markers = 0;
+        }
+        hsgr_input_stream.clear();
+        hsgr_input_stream.seekg(graph_data_position);
+        // note: there are 32 core markers in one unsigned block
+        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::CORE_MARKER,
+                                                  number_of_core_markers);
+
+        // load multi-level partition sizes, the cells have to be customized for this graph
+        boost::filesystem::ifstream partition_input_stream;
+        boost::filesystem::ifstream cells_input_stream;
+        if (boost::filesystem::is_regular_file(partition_data_path) &&
+            boost::filesystem::is_regular_file(cells_data_path))
+        {
+            SimpleLogger().Write() << "load multi-level partition from: " << partition_data_path;
+            partition_input_stream.open(partition_data_path, std::ios::binary);
+            MultiLevelPartition::LevelID number_of_levels = 0;
+            NodeID number_of_partition_nodes = 0;
+            partition_input_stream.read((char *)&number_of_levels,
+                                        sizeof(MultiLevelPartition::LevelID));
+            partition_input_stream.read((char *)&number_of_partition_nodes, sizeof(NodeID));
+            // the node list of the graph ends with a sentinel
+            if (number_of_partition_nodes + 1 != number_of_graph_nodes)
+            {
+                throw osrm::exception(partition_data_path.string() + " does not match the graph");
+            }
+            shared_layout_ptr->SetBlockSize<MultiLevelPartition::CellID>(
+                SharedDataLayout::PARTITION_NUMBER_OF_CELLS, number_of_levels);
+            shared_layout_ptr->SetBlockSize<MultiLevelPartition::CellID>(
+                SharedDataLayout::PARTITION_CELLS,
+                static_cast<uint64_t>(number_of_levels) * number_of_partition_nodes);
+
+            cells_input_stream.open(cells_data_path, std::ios::binary);
+            unsigned cells_checksum = 0;
+            cells_input_stream.read((char *)&cells_checksum, sizeof(unsigned));
+            if (cells_checksum != checksum)
+            {
+                throw osrm::exception(cells_data_path.string() +
+                                      " is outdated, run osrm-customize");
+            }
+            // every vector of the cells is stored as its size followed by its entries
+            const auto cells_data_position = cells_input_stream.tellg();
+            const auto skip_cells_vector = [&](const SharedDataLayout::BlockID block,
+                                               const std::size_t entry_size)
+            {
+                uint64_t number_of_entries = 0;
+                cells_input_stream.read((char *)&number_of_entries, sizeof(uint64_t));
+                cells_input_stream.seekg(number_of_entries * entry_size, std::ios::cur);
+                shared_layout_ptr->num_entries[block] = number_of_entries;
+                shared_layout_ptr->entry_size[block] = entry_size;
+            };
+            skip_cells_vector(SharedDataLayout::CELL_LEVEL_OFFSETS, sizeof(uint64_t));
+            skip_cells_vector(SharedDataLayout::CELL_DATA, sizeof(CellStorage::CellData));
+            skip_cells_vector(SharedDataLayout::CELL_BOUNDARY_NODES, sizeof(NodeID));
+            skip_cells_vector(SharedDataLayout::CELL_WEIGHTS, sizeof(EdgeWeight));
+            if (!cells_input_stream)
+            {
+                throw osrm::exception(cells_data_path.string() + " is truncated");
+            }
+            cells_input_stream.seekg(cells_data_position);
+        }
+
         // load rsearch tree size
         boost::filesystem::ifstream tree_node_file(ram_index_path, std::ios::binary);
 
@@ -530,30 +620,85 @@ int main(const int argc, const char *argv[])
                 (char *)graph_edge_list_ptr,
                 shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST));
         }
+
+        // load the markers of the uncontracted core
+        unsigned *core_marker_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
+            shared_memory_ptr, SharedDataLayout::CORE_MARKER);
+        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::CORE_MARKER) > 0)
+        {
+            unsigned number_of_core_markers = 0;
+            hsgr_input_stream.read((char *)&number_of_core_markers, sizeof(unsigned));
+            BOOST_ASSERT(number_of_core_markers ==
+                         shared_layout_ptr->num_entries[SharedDataLayout::CORE_MARKER]);
+            hsgr_input_stream.read((char *)core_marker_ptr,
+                                   shared_layout_ptr->GetBlockSize(SharedDataLayout::CORE_MARKER));
+        }
         hsgr_input_stream.close();
 
-        // acquire lock
+        // load the multi-level partition and its cells, the vectors in the order of the files
+        for (const auto block :
+             {SharedDataLayout::PARTITION_NUMBER_OF_CELLS, SharedDataLayout::PARTITION_CELLS,
+              SharedDataLayout::CELL_LEVEL_OFFSETS, SharedDataLayout::CELL_DATA,
+              SharedDataLayout::CELL_BOUNDARY_NODES, SharedDataLayout::CELL_WEIGHTS})
+        {
+            // writes the canaries of the blocks even if they stay empty
+            char *block_ptr = shared_layout_ptr->GetBlockPtr<char, true>(shared_memory_ptr, block);
+            if (!partition_input_stream.is_open())
+            {
+                continue;
+            }
+            if (SharedDataLayout::PARTITION_CELLS >= block)
+            {
+                partition_input_stream.read(block_ptr, shared_layout_ptr->GetBlockSize(block));
+            }
+            else
+            {
+                cells_input_stream.seekg(sizeof(uint64_t), std::ios::cur);
+                cells_input_stream.read(block_ptr, shared_layout_ptr->GetBlockSize(block));
+            }
+        }
+
+        // publish the new regions, running queries keep using the previous ones
         SharedMemory *data_type_memory =
             SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), true, false);
         SharedDataTimestamp *data_timestamp_ptr =
             static_cast<SharedDataTimestamp *>(data_type_memory->Ptr());
 
-        boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-            barrier.query_mutex);
-
-        // notify all processes that were waiting for this condition
-        if (0 < barrier.number_of_queries)
-        {
-            barrier.no_running_queries_condition.wait(query_lock);
-        }
-
+        const int previous_data_id = SharedMemory::GetRegionID(previous_data_region);
+        // an odd timestamp tells readers that layout and data do not match yet
+        data_timestamp_ptr->timestamp += 1;
+        std::atomic_thread_fence(std::memory_order_release);
         data_timestamp_ptr->layout = layout_region;
         data_timestamp_ptr->data = data_region;
+        std::atomic_thread_fence(std::memory_order_release);
         data_timestamp_ptr->timestamp += 1;
+        // processes that still have the previous regions attached keep them until they detach
         delete_region(previous_data_region);
         delete_region(previous_layout_region);
         SimpleLogger().Write() << "all data loaded";
 
+        // osrm-routed notices the new timestamp on its own and releases the previous regions as
+        // soon as its queries on them finished. Waiting only reports when the memory is freed.
+        const auto release_deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(RELEASE_TIMEOUT_SECONDS);
+        unsigned attached_processes = SharedMemory::NumberOfAttachments(previous_data_id);
+        if (0 < attached_processes)
+        {
+            SimpleLogger().Write() << "waiting for " << attached_processes
+                                   << " process(es) to release the previous data";
+        }
+        while (0 < attached_processes && std::chrono::steady_clock::now() < release_deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            attached_processes = SharedMemory::NumberOfAttachments(previous_data_id);
+        }
+        if (0 < attached_processes)
+        {
+            SimpleLogger().Write(logWARNING)
+                << attached_processes << " process(es) did not release the previous data within "
+                << RELEASE_TIMEOUT_SECONDS << " seconds, it is freed once they detach";
+        }
+
         shared_layout_ptr->PrintInformation();
     }
     catch (const std::exception &e)
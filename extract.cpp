@@ -32,6 +32,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem.hpp>
 
 #include <exception>
+#include <set>
+#include <string>
 
 int main(int argc, char *argv[])
 {
@@ -67,11 +69,26 @@ int main(int argc, char *argv[])
             return 1;
         }
 
-        if (!boost::filesystem::is_regular_file(extractor_config.profile_path))
+        for (const auto &profile_path : extractor_config.profile_paths)
         {
-            SimpleLogger().Write(logWARNING) << "Profile " << extractor_config.profile_path.string()
-                                             << " not found!";
-            return 1;
+            if (!boost::filesystem::is_regular_file(profile_path))
+            {
+                SimpleLogger().Write(logWARNING) << "Profile " << profile_path.string()
+                                                 << " not found!";
+                return 1;
+            }
+        }
+
+        // profiles with the same name would write to the same files
+        std::set<std::string> profile_names;
+        for (const auto &profile_path : extractor_config.profile_paths)
+        {
+            if (!profile_names.insert(profile_path.stem().string()).second)
+            {
+                SimpleLogger().Write(logWARNING) << "Profile name " << profile_path.stem().string()
+                                                 << " is used more than once!";
+                return 1;
+            }
         }
         return extractor(extractor_config).run();
     }
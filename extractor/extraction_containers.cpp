@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "extraction_containers.hpp"
 #include "extraction_way.hpp"
+#include "parallel_edge_removal.hpp"
 
 #include "../data_structures/coordinate_calculation.hpp"
 #include "../data_structures/node_id.hpp"
@@ -43,9 +44,194 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stxxl/sort>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 #include <limits>
 
+namespace
+{
+// In-memory copies of the lists the preparation works on. The member names match
+// the ones of ExtractionContainers, so the same code runs on both.
+struct InMemoryLists
+{
+    std::vector<NodeID> used_node_id_list;
+    std::vector<ExternalMemoryNode> all_nodes_list;
+    std::vector<InternalExtractorEdge> all_edges_list;
+    std::vector<InputRestrictionContainer> restrictions_list;
+    std::vector<FirstAndLastSegmentOfWay> way_start_end_id_list;
+};
+
+template <typename T> void MoveToMemory(stxxl::vector<T> &external_list, std::vector<T> &list)
+{
+    list.reserve(external_list.size());
+    list.insert(list.end(), external_list.cbegin(), external_list.cend());
+    external_list.clear();
+}
+
+// Calls function(first, last) on consecutive index ranges that cover the list.
+// stxxl vectors are not thread-safe and are traversed as one range.
+template <typename T, typename FunctionT>
+void ForEachRange(stxxl::vector<T> &list, FunctionT function)
+{
+    function(std::size_t(0), std::size_t(list.size()));
+}
+
+template <typename T, typename FunctionT>
+void ForEachRange(std::vector<T> &list, FunctionT function)
+{
+    const constexpr std::size_t RangeSize = 4096;
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, list.size(), RangeSize),
+                      [&function](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          function(range.begin(), range.end());
+                      });
+}
+
+// Like ForEachRange, but a range never splits consecutive elements i - 1 and i
+// for which is_same_group(i - 1, i) holds.
+template <typename T, typename GroupFunctionT, typename FunctionT>
+void ForEachGroupRange(stxxl::vector<T> &list, GroupFunctionT, FunctionT function)
+{
+    function(std::size_t(0), std::size_t(list.size()));
+}
+
+template <typename T, typename GroupFunctionT, typename FunctionT>
+void ForEachGroupRange(std::vector<T> &list, GroupFunctionT is_same_group, FunctionT function)
+{
+    const constexpr std::size_t RangeSize = 4096;
+    const std::size_t number_of_ranges = (list.size() + RangeSize - 1) / RangeSize;
+
+    // move the range borders behind the group they fall into before anything is modified
+    std::vector<std::size_t> range_begin(number_of_ranges + 1, list.size());
+    tbb::parallel_for(std::size_t(0), number_of_ranges, [&](const std::size_t range)
+                      {
+                          std::size_t i = range * RangeSize;
+                          while (i > 0 && i < list.size() && is_same_group(i - 1, i))
+                          {
+                              ++i;
+                          }
+                          range_begin[range] = i;
+                      });
+
+    tbb::parallel_for(std::size_t(0), number_of_ranges, [&](const std::size_t range)
+                      {
+                          if (range_begin[range] < range_begin[range + 1])
+                          {
+                              function(range_begin[range], range_begin[range + 1]);
+                          }
+                      });
+}
+
+// Translates OSM node ids to internal ids, which are their positions in the sorted list of
+// used node ids. Ids that are not used map to SPECIAL_NODEID.
+template <typename NodeIDListT>
+NodeID GetInternalNodeID(const NodeIDListT &used_node_ids, const NodeID node_id)
+{
+    const auto iter = std::lower_bound(used_node_ids.begin(), used_node_ids.end(), node_id);
+    if (iter == used_node_ids.end() || *iter != node_id)
+    {
+        return SPECIAL_NODEID;
+    }
+    return static_cast<NodeID>(iter - used_node_ids.begin());
+}
+
+// Translates a non-decreasing sequence of used OSM node ids to internal ids by walking the
+// sorted list of used node ids forward instead of searching it for every id.
+template <typename NodeIDListT> class SequentialInternalNodeIDs
+{
+  public:
+    SequentialInternalNodeIDs(const NodeIDListT &used_node_ids, const NodeID first_node_id)
+        : begin(used_node_ids.begin()), end(used_node_ids.end()),
+          current(std::lower_bound(begin, end, first_node_id))
+    {
+    }
+
+    NodeID operator()(const NodeID node_id)
+    {
+        while (current != end && *current < node_id)
+        {
+            ++current;
+        }
+        BOOST_ASSERT(current != end && *current == node_id);
+        return static_cast<NodeID>(current - begin);
+    }
+
+  private:
+    typename NodeIDListT::const_iterator begin;
+    typename NodeIDListT::const_iterator end;
+    typename NodeIDListT::const_iterator current;
+};
+
+template <typename NodeIDListT>
+SequentialInternalNodeIDs<NodeIDListT>
+MakeSequentialInternalNodeIDs(const NodeIDListT &used_node_ids, const NodeID first_node_id)
+{
+    return SequentialInternalNodeIDs<NodeIDListT>(used_node_ids, first_node_id);
+}
+
+// The records are written as they are laid out in memory. Their padding bytes are never
+// initialized, so the fields are copied into zeroed records first. Otherwise the files
+// would differ between runs and between the stxxl and the in-memory lists.
+void WriteRecord(std::ofstream &out, const ExternalMemoryNode &node)
+{
+    ExternalMemoryNode record;
+    std::memset(static_cast<void *>(&record), 0, sizeof(ExternalMemoryNode));
+    record.lat = node.lat;
+    record.lon = node.lon;
+    record.node_id = node.node_id;
+    record.barrier = node.barrier;
+    record.traffic_lights = node.traffic_lights;
+    out.write((char *)&record, sizeof(ExternalMemoryNode));
+}
+
+void WriteRecord(std::ofstream &out, const NodeBasedEdge &edge)
+{
+    NodeBasedEdge record;
+    std::memset(static_cast<void *>(&record), 0, sizeof(NodeBasedEdge));
+    record.source = edge.source;
+    record.target = edge.target;
+    record.name_id = edge.name_id;
+    record.weight = edge.weight;
+    record.forward = edge.forward;
+    record.backward = edge.backward;
+    record.roundabout = edge.roundabout;
+    record.in_tiny_cc = edge.in_tiny_cc;
+    record.access_restricted = edge.access_restricted;
+    record.is_split = edge.is_split;
+    record.travel_mode = edge.travel_mode;
+    out.write((char *)&record, sizeof(NodeBasedEdge));
+}
+
+void WriteRecord(std::ofstream &out, const TurnRestriction &restriction)
+{
+    TurnRestriction record;
+    std::memset(static_cast<void *>(&record), 0, sizeof(TurnRestriction));
+    record.via = restriction.via;
+    record.from = restriction.from;
+    record.to = restriction.to;
+    record.flags = restriction.flags;
+    out.write((char *)&record, sizeof(TurnRestriction));
+}
+
+// first node that can match an edge end point with the given id in a merge step
+template <typename NodeListT>
+typename NodeListT::const_iterator FindFirstNode(const NodeListT &nodes, const NodeID node_id)
+{
+    return std::lower_bound(nodes.begin(), nodes.end(), node_id,
+                            [](const ExternalMemoryNode &node, const NodeID id)
+                            {
+                                return node.node_id < id;
+                            });
+}
+}
+
 ExtractionContainers::ExtractionContainers()
 {
     // Check if stxxl can be instantiated
@@ -73,27 +259,35 @@ ExtractionContainers::~ExtractionContainers()
  * - filter nodes list to nodes that are referenced by ways
  * - merge edges with nodes to include location of start/end points and serialize
  *
+ * With in_memory set, the lists are moved out of stxxl and sorted and merged in
+ * parallel. Both ways produce the same files, byte for byte.
  */
 void ExtractionContainers::PrepareData(const std::string &output_file_name,
                                        const std::string &restrictions_file_name,
-                                       const std::string &name_file_name)
+                                       const std::string &name_file_name,
+                                       const bool in_memory)
 {
     try
     {
-        std::ofstream file_out_stream;
-        file_out_stream.open(output_file_name.c_str(), std::ios::binary);
-        const FingerPrint fingerprint = FingerPrint::GetValid();
-        file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
-
-        PrepareNodes();
-        WriteNodes(file_out_stream);
-        PrepareEdges();
-        WriteEdges(file_out_stream);
-
-        file_out_stream.close();
-
-        PrepareRestrictions();
-        WriteRestrictions(restrictions_file_name);
+        if (in_memory)
+        {
+            std::cout << "[extractor] Moving data to memory     ... " << std::flush;
+            TIMER_START(move_to_memory);
+            InMemoryLists lists;
+            MoveToMemory(used_node_id_list, lists.used_node_id_list);
+            MoveToMemory(all_nodes_list, lists.all_nodes_list);
+            MoveToMemory(all_edges_list, lists.all_edges_list);
+            MoveToMemory(restrictions_list, lists.restrictions_list);
+            MoveToMemory(way_start_end_id_list, lists.way_start_end_id_list);
+            TIMER_STOP(move_to_memory);
+            std::cout << "ok, after " << TIMER_SEC(move_to_memory) << "s" << std::endl;
+
+            PrepareAndWrite(lists, output_file_name, restrictions_file_name);
+        }
+        else
+        {
+            PrepareAndWrite(*this, output_file_name, restrictions_file_name);
+        }
 
         WriteNames(name_file_name);
     }
@@ -103,6 +297,39 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
     }
 }
 
+template <class ListsT>
+void ExtractionContainers::PrepareAndWrite(ListsT &lists,
+                                           const std::string &output_file_name,
+                                           const std::string &restrictions_file_name)
+{
+    std::ofstream file_out_stream;
+    file_out_stream.open(output_file_name.c_str(), std::ios::binary);
+    const FingerPrint fingerprint = FingerPrint::GetValid();
+    file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+
+    PrepareNodes(lists);
+    WriteNodes(file_out_stream, lists);
+    PrepareEdges(lists);
+    WriteEdges(file_out_stream, lists);
+
+    file_out_stream.close();
+
+    PrepareRestrictions(lists);
+    WriteRestrictions(restrictions_file_name, lists);
+}
+
+template <typename T, typename CompareT>
+void ExtractionContainers::Sort(stxxl::vector<T> &list, CompareT compare)
+{
+    stxxl::sort(list.begin(), list.end(), compare, stxxl_memory);
+}
+
+template <typename T, typename CompareT>
+void ExtractionContainers::Sort(std::vector<T> &list, CompareT compare)
+{
+    tbb::parallel_sort(list.begin(), list.end(), compare);
+}
+
 void ExtractionContainers::WriteNames(const std::string& names_file_name) const
 {
     std::cout << "[extractor] writing street name index ... " << std::flush;
@@ -137,263 +364,204 @@ void ExtractionContainers::WriteNames(const std::string& names_file_name) const
     std::cout << "ok, after " << TIMER_SEC(write_name_index) << "s" << std::endl;
 }
 
-void ExtractionContainers::PrepareNodes()
+template <class ListsT> void ExtractionContainers::PrepareNodes(ListsT &lists)
 {
+    auto &used_node_ids = lists.used_node_id_list;
+
     std::cout << "[extractor] Sorting used nodes        ... " << std::flush;
     TIMER_START(sorting_used_nodes);
-    stxxl::sort(used_node_id_list.begin(), used_node_id_list.end(), Cmp(), stxxl_memory);
+    Sort(used_node_ids, Cmp());
     TIMER_STOP(sorting_used_nodes);
     std::cout << "ok, after " << TIMER_SEC(sorting_used_nodes) << "s" << std::endl;
 
     std::cout << "[extractor] Erasing duplicate nodes   ... " << std::flush;
     TIMER_START(erasing_dups);
-    auto new_end = std::unique(used_node_id_list.begin(), used_node_id_list.end());
-    used_node_id_list.resize(new_end - used_node_id_list.begin());
+    auto new_end = std::unique(used_node_ids.begin(), used_node_ids.end());
+    used_node_ids.resize(new_end - used_node_ids.begin());
     TIMER_STOP(erasing_dups);
     std::cout << "ok, after " << TIMER_SEC(erasing_dups) << "s" << std::endl;
 
-    std::cout << "[extractor] Building node id map      ... " << std::flush;
-    TIMER_START(id_map);
-    external_to_internal_node_id_map.reserve(used_node_id_list.size());
-    for (NodeID i = 0u; i < used_node_id_list.size(); ++i)
-        external_to_internal_node_id_map[used_node_id_list[i]] = i;
-    TIMER_STOP(id_map);
-    std::cout << "ok, after " << TIMER_SEC(id_map) << "s" << std::endl;
-
     std::cout << "[extractor] Sorting all nodes         ... " << std::flush;
     TIMER_START(sorting_nodes);
-    stxxl::sort(all_nodes_list.begin(), all_nodes_list.end(), ExternalMemoryNodeSTXXLCompare(),
-                stxxl_memory);
+    Sort(lists.all_nodes_list, ExternalMemoryNodeSTXXLCompare());
     TIMER_STOP(sorting_nodes);
     std::cout << "ok, after " << TIMER_SEC(sorting_nodes) << "s" << std::endl;
 }
 
-void ExtractionContainers::PrepareEdges()
+template <class ListsT> void ExtractionContainers::PrepareEdges(ListsT &lists)
 {
+    const auto &used_node_ids = lists.used_node_id_list;
+    const auto &nodes = lists.all_nodes_list;
+    auto &edges = lists.all_edges_list;
+
     // Sort edges by start.
     std::cout << "[extractor] Sorting edges by start    ... " << std::flush;
     TIMER_START(sort_edges_by_start);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartID(), stxxl_memory);
+    Sort(edges, CmpEdgeByStartID());
     TIMER_STOP(sort_edges_by_start);
     std::cout << "ok, after " << TIMER_SEC(sort_edges_by_start) << "s" << std::endl;
 
     std::cout << "[extractor] Setting start coords      ... " << std::flush;
     TIMER_START(set_start_coords);
     // Traverse list of edges and nodes in parallel and set start coord
-    auto node_iterator = all_nodes_list.begin();
-    auto edge_iterator = all_edges_list.begin();
-    while (edge_iterator != all_edges_list.end() && node_iterator != all_nodes_list.end())
+    ForEachRange(edges, [&](const std::size_t first, const std::size_t last)
     {
-        if (edge_iterator->result.source < node_iterator->node_id)
+        if (first == last)
         {
-            edge_iterator->result.source = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
+            return;
         }
-        if (edge_iterator->result.source > node_iterator->node_id)
+        auto edge_iterator = edges.begin() + first;
+        const auto edge_range_end = edges.begin() + last;
+        auto node_iterator = FindFirstNode(nodes, edge_iterator->result.source);
+        auto internal_node_ids =
+            MakeSequentialInternalNodeIDs(used_node_ids, edge_iterator->result.source);
+        while (edge_iterator != edge_range_end && node_iterator != nodes.end())
         {
-            node_iterator++;
-            continue;
-        }
+            if (edge_iterator->result.source < node_iterator->node_id)
+            {
+                edge_iterator->result.source = SPECIAL_NODEID;
+                ++edge_iterator;
+                continue;
+            }
+            if (edge_iterator->result.source > node_iterator->node_id)
+            {
+                node_iterator++;
+                continue;
+            }
 
-        // remove loops
-        if (edge_iterator->result.source == edge_iterator->result.target)
-        {
-            edge_iterator->result.source = SPECIAL_NODEID;
-            edge_iterator->result.target = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
-        }
+            // remove loops
+            if (edge_iterator->result.source == edge_iterator->result.target)
+            {
+                edge_iterator->result.source = SPECIAL_NODEID;
+                edge_iterator->result.target = SPECIAL_NODEID;
+                ++edge_iterator;
+                continue;
+            }
 
-        BOOST_ASSERT(edge_iterator->result.source == node_iterator->node_id);
+            BOOST_ASSERT(edge_iterator->result.source == node_iterator->node_id);
 
-        // assign new node id
-        auto id_iter = external_to_internal_node_id_map.find(node_iterator->node_id);
-        BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-        edge_iterator->result.source = id_iter->second;
+            // assign new node id
+            edge_iterator->result.source = internal_node_ids(node_iterator->node_id);
 
-        edge_iterator->source_coordinate.lat = node_iterator->lat;
-        edge_iterator->source_coordinate.lon = node_iterator->lon;
-        ++edge_iterator;
-    }
+            edge_iterator->source_coordinate.lat = node_iterator->lat;
+            edge_iterator->source_coordinate.lon = node_iterator->lon;
+            ++edge_iterator;
+        }
+    });
     TIMER_STOP(set_start_coords);
     std::cout << "ok, after " << TIMER_SEC(set_start_coords) << "s" << std::endl;
 
     // Sort Edges by target
     std::cout << "[extractor] Sorting edges by target   ... " << std::flush;
     TIMER_START(sort_edges_by_target);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByTargetID(),
-                stxxl_memory);
+    Sort(edges, CmpEdgeByTargetID());
     TIMER_STOP(sort_edges_by_target);
     std::cout << "ok, after " << TIMER_SEC(sort_edges_by_target) << "s" << std::endl;
 
     // Compute edge weights
     std::cout << "[extractor] Computing edge weights    ... " << std::flush;
     TIMER_START(compute_weights);
-    node_iterator = all_nodes_list.begin();
-    edge_iterator = all_edges_list.begin();
-    while (edge_iterator != all_edges_list.end() && node_iterator != all_nodes_list.end())
+    ForEachRange(edges, [&](const std::size_t first, const std::size_t last)
     {
-        // skip all invalid edges
-        if (edge_iterator->result.source == SPECIAL_NODEID)
+        if (first == last)
         {
-            ++edge_iterator;
-            continue;
+            return;
         }
-
-        if (edge_iterator->result.target < node_iterator->node_id)
+        auto edge_iterator = edges.begin() + first;
+        const auto edge_range_end = edges.begin() + last;
+        auto node_iterator = FindFirstNode(nodes, edge_iterator->result.target);
+        auto internal_node_ids =
+            MakeSequentialInternalNodeIDs(used_node_ids, edge_iterator->result.target);
+        while (edge_iterator != edge_range_end && node_iterator != nodes.end())
         {
-            edge_iterator->result.target = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
-        }
-        if (edge_iterator->result.target > node_iterator->node_id)
-        {
-            ++node_iterator;
-            continue;
-        }
-
-        BOOST_ASSERT(edge_iterator->result.target == node_iterator->node_id);
-        BOOST_ASSERT(edge_iterator->weight_data.speed >= 0);
-        BOOST_ASSERT(edge_iterator->source_coordinate.lat != std::numeric_limits<int>::min());
-        BOOST_ASSERT(edge_iterator->source_coordinate.lon != std::numeric_limits<int>::min());
-
-        const double distance = coordinate_calculation::euclidean_distance(
-            edge_iterator->source_coordinate.lat, edge_iterator->source_coordinate.lon,
-            node_iterator->lat, node_iterator->lon);
-
-        const double weight = [distance](const InternalExtractorEdge::WeightData& data) {
-            switch (data.type)
+            // skip all invalid edges
+            if (edge_iterator->result.source == SPECIAL_NODEID)
             {
-                case InternalExtractorEdge::WeightType::EDGE_DURATION:
-                case InternalExtractorEdge::WeightType::WAY_DURATION:
-                    return data.duration * 10.;
-                    break;
-                case InternalExtractorEdge::WeightType::SPEED:
-                    return (distance * 10.) / (data.speed / 3.6);
-                    break;
-                case InternalExtractorEdge::WeightType::INVALID:
-                    osrm::exception("invalid weight type");
+                ++edge_iterator;
+                continue;
             }
-            return -1.0;
-        }(edge_iterator->weight_data);
 
-        auto& edge = edge_iterator->result;
-        edge.weight = std::max(1, static_cast<int>(std::floor(weight + .5)));
-
-        // assign new node id
-        auto id_iter = external_to_internal_node_id_map.find(node_iterator->node_id);
-        BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-        edge.target = id_iter->second;
+            if (edge_iterator->result.target < node_iterator->node_id)
+            {
+                edge_iterator->result.target = SPECIAL_NODEID;
+                ++edge_iterator;
+                continue;
+            }
+            if (edge_iterator->result.target > node_iterator->node_id)
+            {
+                ++node_iterator;
+                continue;
+            }
 
-        // orient edges consistently: source id < target id
-        // important for multi-edge removal
-        if (edge.source > edge.target)
-        {
-            std::swap(edge.source, edge.target);
+            BOOST_ASSERT(edge_iterator->result.target == node_iterator->node_id);
+            BOOST_ASSERT(edge_iterator->weight_data.speed >= 0);
+            BOOST_ASSERT(edge_iterator->source_coordinate.lat != std::numeric_limits<int>::min());
+            BOOST_ASSERT(edge_iterator->source_coordinate.lon != std::numeric_limits<int>::min());
+
+            const double distance = coordinate_calculation::euclidean_distance(
+                edge_iterator->source_coordinate.lat, edge_iterator->source_coordinate.lon,
+                node_iterator->lat, node_iterator->lon);
+
+            const double weight = [distance](const InternalExtractorEdge::WeightData& data) {
+                switch (data.type)
+                {
+                    case InternalExtractorEdge::WeightType::EDGE_DURATION:
+                    case InternalExtractorEdge::WeightType::WAY_DURATION:
+                        return data.duration * 10.;
+                        break;
+                    case InternalExtractorEdge::WeightType::SPEED:
+                        return (distance * 10.) / (data.speed / 3.6);
+                        break;
+                    case InternalExtractorEdge::WeightType::INVALID:
+                        osrm::exception("invalid weight type");
+                }
+                return -1.0;
+            }(edge_iterator->weight_data);
+
+            auto& edge = edge_iterator->result;
+            edge.weight = std::max(1, static_cast<int>(std::floor(weight + .5)));
+
+            // assign new node id
+            edge.target = internal_node_ids(node_iterator->node_id);
+
+            // orient edges consistently: source id < target id
+            // important for multi-edge removal
+            if (edge.source > edge.target)
+            {
+                std::swap(edge.source, edge.target);
 
-            // std::swap does not work with bit-fields
-            bool temp = edge.forward;
-            edge.forward = edge.backward;
-            edge.backward = temp;
+                // std::swap does not work with bit-fields
+                bool temp = edge.forward;
+                edge.forward = edge.backward;
+                edge.backward = temp;
+            }
+            ++edge_iterator;
         }
-        ++edge_iterator;
-    }
+    });
     TIMER_STOP(compute_weights);
     std::cout << "ok, after " << TIMER_SEC(compute_weights) << "s" << std::endl;
 
     // Sort edges by start.
     std::cout << "[extractor] Sorting edges by renumbered start ... " << std::flush;
     TIMER_START(sort_edges_by_renumbered_start);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartThenTargetID(), stxxl_memory);
+    Sort(edges, CmpEdgeByStartThenTargetID());
     TIMER_STOP(sort_edges_by_renumbered_start);
     std::cout << "ok, after " << TIMER_SEC(sort_edges_by_renumbered_start) << "s" << std::endl;
 
-    BOOST_ASSERT(all_edges_list.size() > 0);
-    for (unsigned i = 0; i < all_edges_list.size();)
+    BOOST_ASSERT(edges.size() > 0);
+    const auto is_parallel_edge = [&edges](const std::size_t i, const std::size_t j)
     {
-        // only invalid edges left
-        if (all_edges_list[i].result.source == SPECIAL_NODEID)
-        {
-            break;
-        }
-        // skip invalid edges
-        if (all_edges_list[i].result.target == SPECIAL_NODEID)
-        {
-            continue;
-        }
-
-        unsigned start_idx = i;
-        NodeID source = all_edges_list[i].result.source;
-        NodeID target = all_edges_list[i].result.target;
-
-        int min_forward_weight = std::numeric_limits<int>::max();
-        int min_backward_weight = std::numeric_limits<int>::max();
-        unsigned min_forward_idx = std::numeric_limits<unsigned>::max();
-        unsigned min_backward_idx = std::numeric_limits<unsigned>::max();
-
-        // find minimal edge in both directions
-        while (all_edges_list[i].result.source == source &&
-               all_edges_list[i].result.target == target)
-        {
-            if (all_edges_list[i].result.forward && all_edges_list[i].result.weight < min_forward_weight)
-            {
-                min_forward_idx = i;
-            }
-            if (all_edges_list[i].result.backward && all_edges_list[i].result.weight < min_backward_weight)
-            {
-                min_backward_idx = i;
-            }
-
-            // this also increments the outer loop counter!
-            i++;
-        }
-
-        BOOST_ASSERT(min_forward_idx == std::numeric_limits<unsigned>::max() || min_forward_idx < i);
-        BOOST_ASSERT(min_backward_idx == std::numeric_limits<unsigned>::max() || min_backward_idx < i);
-        BOOST_ASSERT(min_backward_idx != std::numeric_limits<unsigned>::max() ||
-                     min_forward_idx != std::numeric_limits<unsigned>::max());
-
-        if (min_backward_idx == min_forward_idx)
-        {
-            all_edges_list[min_forward_idx].result.is_split = false;
-            all_edges_list[min_forward_idx].result.forward = true;
-            all_edges_list[min_forward_idx].result.backward = true;
-        }
-        else
-        {
-            bool has_forward = min_forward_idx != std::numeric_limits<unsigned>::max();
-            bool has_backward = min_backward_idx != std::numeric_limits<unsigned>::max();
-            if (has_forward)
-            {
-                all_edges_list[min_forward_idx].result.forward = true;
-                all_edges_list[min_forward_idx].result.backward = false;
-                all_edges_list[min_forward_idx].result.is_split = has_backward;
-            }
-            if (has_backward)
-            {
-                std::swap(all_edges_list[min_backward_idx].result.source,
-                          all_edges_list[min_backward_idx].result.target);
-                all_edges_list[min_backward_idx].result.forward = true;
-                all_edges_list[min_backward_idx].result.backward = false;
-                all_edges_list[min_backward_idx].result.is_split = has_forward;
-            }
-        }
-
-        // invalidate all unused edges
-        for (unsigned j = start_idx; j < i; j++)
-        {
-            if (j == min_forward_idx || j == min_backward_idx)
-            {
-                continue;
-            }
-            all_edges_list[j].result.source = SPECIAL_NODEID;
-            all_edges_list[j].result.target = SPECIAL_NODEID;
-        }
-    }
+        return edges[i].result.source == edges[j].result.source &&
+               edges[i].result.target == edges[j].result.target;
+    };
+    ForEachGroupRange(edges, is_parallel_edge, [&edges](const std::size_t first, const std::size_t last)
+    {
+        RemoveParallelEdges(edges, first, last);
+    });
 }
 
-void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
+template <class ListsT>
+void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream, const ListsT &lists) const
 {
     std::cout << "[extractor] Writing used egdes       ... " << std::flush;
     TIMER_START(write_edges);
@@ -403,14 +571,14 @@ void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
     auto start_position = file_out_stream.tellp();
     file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
 
-    for (const auto& edge : all_edges_list)
+    for (const auto& edge : lists.all_edges_list)
     {
         if (edge.result.source == SPECIAL_NODEID || edge.result.target == SPECIAL_NODEID)
         {
             continue;
         }
 
-        file_out_stream.write((char*) &edge.result, sizeof(NodeBasedEdge));
+        WriteRecord(file_out_stream, edge.result);
         number_of_used_edges++;
     }
     TIMER_STOP(write_edges);
@@ -424,7 +592,8 @@ void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
     SimpleLogger().Write() << "Processed " << number_of_used_edges << " edges";
 }
 
-void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
+template <class ListsT>
+void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream, const ListsT &lists) const
 {
     unsigned number_of_used_nodes = 0;
     // write dummy value, will be overwritten later
@@ -432,9 +601,10 @@ void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
     std::cout << "[extractor] Confirming/Writing used nodes     ... " << std::flush;
     TIMER_START(write_nodes);
     // identify all used nodes by a merging step of two sorted lists
-    auto node_iterator = all_nodes_list.begin();
-    auto node_id_iterator = used_node_id_list.begin();
-    while (node_id_iterator != used_node_id_list.end() && node_iterator != all_nodes_list.end())
+    auto node_iterator = lists.all_nodes_list.begin();
+    auto node_id_iterator = lists.used_node_id_list.begin();
+    while (node_id_iterator != lists.used_node_id_list.end() &&
+           node_iterator != lists.all_nodes_list.end())
     {
         if (*node_id_iterator < node_iterator->node_id)
         {
@@ -448,7 +618,7 @@ void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
         }
         BOOST_ASSERT(*node_id_iterator == node_iterator->node_id);
 
-        file_out_stream.write((char *)&(*node_iterator), sizeof(ExternalMemoryNode));
+        WriteRecord(file_out_stream, *node_iterator);
 
         ++number_of_used_nodes;
         ++node_id_iterator;
@@ -467,7 +637,8 @@ void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
     SimpleLogger().Write() << "Processed " << number_of_used_nodes << " nodes";
 }
 
-void ExtractionContainers::WriteRestrictions(const std::string& path) const
+template <class ListsT>
+void ExtractionContainers::WriteRestrictions(const std::string& path, const ListsT &lists) const
 {
     // serialize restrictions
     std::ofstream restrictions_out_stream;
@@ -478,14 +649,13 @@ void ExtractionContainers::WriteRestrictions(const std::string& path) const
     const auto count_position = restrictions_out_stream.tellp();
     restrictions_out_stream.write((char *)&written_restriction_count, sizeof(unsigned));
 
-    for (const auto &restriction_container : restrictions_list)
+    for (const auto &restriction_container : lists.restrictions_list)
     {
         if (SPECIAL_NODEID != restriction_container.restriction.from.node &&
             SPECIAL_NODEID != restriction_container.restriction.via.node &&
             SPECIAL_NODEID != restriction_container.restriction.to.node)
         {
-            restrictions_out_stream.write((char *)&(restriction_container.restriction),
-                                          sizeof(TurnRestriction));
+            WriteRecord(restrictions_out_stream, restriction_container.restriction);
             ++written_restriction_count;
         }
     }
@@ -495,30 +665,32 @@ void ExtractionContainers::WriteRestrictions(const std::string& path) const
     SimpleLogger().Write() << "usable restrictions: " << written_restriction_count;
 }
 
-void ExtractionContainers::PrepareRestrictions()
+template <class ListsT> void ExtractionContainers::PrepareRestrictions(ListsT &lists)
 {
+    const auto &used_node_ids = lists.used_node_id_list;
+    auto &restrictions = lists.restrictions_list;
+    auto &way_start_end_ids = lists.way_start_end_id_list;
+
     std::cout << "[extractor] Sorting used ways         ... " << std::flush;
     TIMER_START(sort_ways);
-    stxxl::sort(way_start_end_id_list.begin(), way_start_end_id_list.end(),
-                FirstAndLastSegmentOfWayStxxlCompare(), stxxl_memory);
+    Sort(way_start_end_ids, FirstAndLastSegmentOfWayStxxlCompare());
     TIMER_STOP(sort_ways);
     std::cout << "ok, after " << TIMER_SEC(sort_ways) << "s" << std::endl;
 
-    std::cout << "[extractor] Sorting " << restrictions_list.size()
+    std::cout << "[extractor] Sorting " << restrictions.size()
               << " restriction. by from... " << std::flush;
     TIMER_START(sort_restrictions);
-    stxxl::sort(restrictions_list.begin(), restrictions_list.end(),
-                CmpRestrictionContainerByFrom(), stxxl_memory);
+    Sort(restrictions, CmpRestrictionContainerByFrom());
     TIMER_STOP(sort_restrictions);
     std::cout << "ok, after " << TIMER_SEC(sort_restrictions) << "s" << std::endl;
 
     std::cout << "[extractor] Fixing restriction starts ... " << std::flush;
     TIMER_START(fix_restriction_starts);
-    auto restrictions_iterator = restrictions_list.begin();
-    auto way_start_and_end_iterator = way_start_end_id_list.cbegin();
+    auto restrictions_iterator = restrictions.begin();
+    auto way_start_and_end_iterator = way_start_end_ids.cbegin();
 
-    while (way_start_and_end_iterator != way_start_end_id_list.cend() &&
-           restrictions_iterator != restrictions_list.end())
+    while (way_start_and_end_iterator != way_start_end_ids.cend() &&
+           restrictions_iterator != restrictions.end())
     {
         if (way_start_and_end_iterator->way_id < restrictions_iterator->restriction.from.way)
         {
@@ -540,8 +712,7 @@ void ExtractionContainers::PrepareRestrictions()
         const NodeID via_node_id = restrictions_iterator->restriction.via.node;
 
         // check if via is actually valid, if not invalidate
-        auto via_id_iter = external_to_internal_node_id_map.find(via_node_id);
-        if(via_id_iter == external_to_internal_node_id_map.end())
+        if (SPECIAL_NODEID == GetInternalNodeID(used_node_ids, via_node_id))
         {
             SimpleLogger().Write(LogLevel::logDEBUG) << "Restriction references invalid node: " << restrictions_iterator->restriction.via.node;
             restrictions_iterator->restriction.via.node = SPECIAL_NODEID;
@@ -552,18 +723,16 @@ void ExtractionContainers::PrepareRestrictions()
         if (way_start_and_end_iterator->first_segment_source_id == via_node_id)
         {
             // assign new from node id
-            auto id_iter = external_to_internal_node_id_map.find(
-                    way_start_and_end_iterator->first_segment_target_id);
-            BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-            restrictions_iterator->restriction.from.node = id_iter->second;
+            restrictions_iterator->restriction.from.node = GetInternalNodeID(
+                used_node_ids, way_start_and_end_iterator->first_segment_target_id);
+            BOOST_ASSERT(restrictions_iterator->restriction.from.node != SPECIAL_NODEID);
         }
         else if (way_start_and_end_iterator->last_segment_target_id == via_node_id)
         {
             // assign new from node id
-            auto id_iter = external_to_internal_node_id_map.find(
-                    way_start_and_end_iterator->last_segment_source_id);
-            BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-            restrictions_iterator->restriction.from.node = id_iter->second;
+            restrictions_iterator->restriction.from.node = GetInternalNodeID(
+                used_node_ids, way_start_and_end_iterator->last_segment_source_id);
+            BOOST_ASSERT(restrictions_iterator->restriction.from.node != SPECIAL_NODEID);
         }
         ++restrictions_iterator;
     }
@@ -573,17 +742,16 @@ void ExtractionContainers::PrepareRestrictions()
 
     std::cout << "[extractor] Sorting restrictions. by to  ... " << std::flush;
     TIMER_START(sort_restrictions_to);
-    stxxl::sort(restrictions_list.begin(), restrictions_list.end(),
-                CmpRestrictionContainerByTo(), stxxl_memory);
+    Sort(restrictions, CmpRestrictionContainerByTo());
     TIMER_STOP(sort_restrictions_to);
     std::cout << "ok, after " << TIMER_SEC(sort_restrictions_to) << "s" << std::endl;
 
     std::cout << "[extractor] Fixing restriction ends   ... " << std::flush;
     TIMER_START(fix_restriction_ends);
-    restrictions_iterator = restrictions_list.begin();
-    way_start_and_end_iterator = way_start_end_id_list.cbegin();
-    while (way_start_and_end_iterator != way_start_end_id_list.cend() &&
-           restrictions_iterator != restrictions_list.end())
+    restrictions_iterator = restrictions.begin();
+    way_start_and_end_iterator = way_start_end_ids.cbegin();
+    while (way_start_and_end_iterator != way_start_end_ids.cend() &&
+           restrictions_iterator != restrictions.end())
     {
         if (way_start_and_end_iterator->way_id < restrictions_iterator->restriction.to.way)
         {
@@ -608,23 +776,20 @@ void ExtractionContainers::PrepareRestrictions()
         const NodeID via_node_id = restrictions_iterator->restriction.via.node;
 
         // assign new via node id
-        auto via_id_iter = external_to_internal_node_id_map.find(via_node_id);
-        BOOST_ASSERT(via_id_iter != external_to_internal_node_id_map.end());
-        restrictions_iterator->restriction.via.node = via_id_iter->second;
+        restrictions_iterator->restriction.via.node = GetInternalNodeID(used_node_ids, via_node_id);
+        BOOST_ASSERT(restrictions_iterator->restriction.via.node != SPECIAL_NODEID);
 
         if (way_start_and_end_iterator->first_segment_source_id == via_node_id)
         {
-            auto to_id_iter = external_to_internal_node_id_map.find(
-                    way_start_and_end_iterator->first_segment_target_id);
-            BOOST_ASSERT(to_id_iter != external_to_internal_node_id_map.end());
-            restrictions_iterator->restriction.to.node = to_id_iter->second;
+            restrictions_iterator->restriction.to.node = GetInternalNodeID(
+                used_node_ids, way_start_and_end_iterator->first_segment_target_id);
+            BOOST_ASSERT(restrictions_iterator->restriction.to.node != SPECIAL_NODEID);
         }
         else if (way_start_and_end_iterator->last_segment_target_id == via_node_id)
         {
-            auto to_id_iter = external_to_internal_node_id_map.find(
-                    way_start_and_end_iterator->last_segment_source_id);
-            BOOST_ASSERT(to_id_iter != external_to_internal_node_id_map.end());
-            restrictions_iterator->restriction.to.node = to_id_iter->second;
+            restrictions_iterator->restriction.to.node = GetInternalNodeID(
+                used_node_ids, way_start_and_end_iterator->last_segment_source_id);
+            BOOST_ASSERT(restrictions_iterator->restriction.to.node != SPECIAL_NODEID);
         }
         ++restrictions_iterator;
     }
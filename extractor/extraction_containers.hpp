@@ -34,13 +34,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/restriction.hpp"
 
 #include <stxxl/vector>
-#include <unordered_map>
+
+#include <fstream>
+#include <string>
+#include <vector>
 
 /**
  * Uses external memory containers from stxxl to store all the data that
  * is collected by the extractor callbacks.
  *
  * The data is the filtered, aggregated and finally written to disk.
+ * If enough RAM is available, the lists are moved to main memory first,
+ * which allows sorting and merging them in parallel.
  */
 class ExtractionContainers
 {
@@ -51,14 +56,29 @@ class ExtractionContainers
 #else
     const static unsigned stxxl_memory = ((sizeof(std::size_t) == 4) ? INT_MAX : UINT_MAX);
 #endif
-    void PrepareNodes();
-    void PrepareRestrictions();
-    void PrepareEdges();
+    // the list types are either the stxxl vectors below or their in-memory copies
+    template <class ListsT> void PrepareNodes(ListsT &lists);
+    template <class ListsT> void PrepareRestrictions(ListsT &lists);
+    template <class ListsT> void PrepareEdges(ListsT &lists);
+
+    template <class ListsT>
+    void PrepareAndWrite(ListsT &lists,
+                         const std::string &output_file_name,
+                         const std::string &restrictions_file_name);
 
-    void WriteNodes(std::ofstream& file_out_stream) const;
-    void WriteRestrictions(const std::string& restrictions_file_name) const;
-    void WriteEdges(std::ofstream& file_out_stream) const;
+    template <class ListsT>
+    void WriteNodes(std::ofstream &file_out_stream, const ListsT &lists) const;
+    template <class ListsT>
+    void WriteRestrictions(const std::string &restrictions_file_name, const ListsT &lists) const;
+    template <class ListsT>
+    void WriteEdges(std::ofstream &file_out_stream, const ListsT &lists) const;
     void WriteNames(const std::string& names_file_name) const;
+
+    template <typename T, typename CompareT>
+    static void Sort(stxxl::vector<T> &list, CompareT compare);
+    template <typename T, typename CompareT>
+    static void Sort(std::vector<T> &list, CompareT compare);
+
   public:
     using STXXLNodeIDVector = stxxl::vector<NodeID>;
     using STXXLNodeVector = stxxl::vector<ExternalMemoryNode>;
@@ -73,7 +93,6 @@ class ExtractionContainers
     STXXLStringVector name_list;
     STXXLRestrictionsVector restrictions_list;
     STXXLWayIDStartEndVector way_start_end_id_list;
-    std::unordered_map<NodeID, NodeID> external_to_internal_node_id_map;
 
     ExtractionContainers();
 
@@ -81,7 +100,8 @@ class ExtractionContainers
 
     void PrepareData(const std::string &output_file_name,
                      const std::string &restrictions_file_name,
-                     const std::string &names_file_name);
+                     const std::string &names_file_name,
+                     const bool in_memory);
 };
 
 #endif /* EXTRACTION_CONTAINERS_HPP */
@@ -33,14 +33,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "extractor_callbacks.hpp"
 #include "restriction_parser.hpp"
 #include "scripting_environment.hpp"
+#include "way_function_cache.hpp"
 
 #include "../util/git_sha.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/lua_util.hpp"
 #include "../util/make_unique.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/timing_util.hpp"
 
 #include "../typedefs.h"
 
+#include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
@@ -48,7 +52,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osmium/io/any_input.hpp>
 
+#include <tbb/concurrent_vector.h>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/pipeline.h>
 #include <tbb/task_scheduler_init.h>
 
 #include <variant/optional.hpp>
@@ -60,10 +67,81 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+namespace
+{
+// The results of the profile functions for the entities of a buffer, keyed by the position of
+// the entity.
+struct ProfileResults
+{
+    tbb::concurrent_vector<std::pair<std::size_t, ExtractionNode>> resulting_nodes;
+    tbb::concurrent_vector<std::pair<std::size_t, ExtractionWay>> resulting_ways;
+    tbb::concurrent_vector<
+        std::pair<std::size_t, mapbox::util::optional<InputRestrictionContainer>>>
+        resulting_restrictions;
+};
+
+// A buffer of the input file on its way through the pipeline, together with the results of each
+// profile for its entities.
+struct ParsedBuffer
+{
+    explicit ParsedBuffer(const std::size_t number_of_profiles) : results(number_of_profiles) {}
+
+    osmium::memory::Buffer buffer;
+    std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
+    std::vector<ProfileResults> results;
+};
+
+struct CompareElementPosition
+{
+    template <typename ResultT> bool operator()(const ResultT &lhs, const ResultT &rhs) const
+    {
+        return lhs.first < rhs.first;
+    }
+};
+
+// Everything that is kept per profile: its lua states and the data collected with it.
+struct ProfileExtraction
+{
+    explicit ProfileExtraction(const boost::filesystem::path &profile_path)
+        : scripting_environment(profile_path.string().c_str()),
+          restriction_parser(scripting_environment.get_lua_state()),
+          way_function_cache(WayFunctionDependsOnlyOnTags(scripting_environment.get_lua_state())),
+          extractor_callbacks(osrm::make_unique<ExtractorCallbacks>(extraction_containers))
+    {
+        if (way_function_cache.IsEnabled())
+        {
+            SimpleLogger().Write() << "Caching results of way_function by tags";
+        }
+    }
+
+    // profiles declare if the results of their way_function only depend on the tags
+    static bool WayFunctionDependsOnlyOnTags(lua_State *lua_state)
+    {
+        bool depends_only_on_tags = false;
+        if (0 == luaL_dostring(lua_state, "return way_function_depends_only_on_tags\n") &&
+            lua_isboolean(lua_state, -1))
+        {
+            depends_only_on_tags = lua_toboolean(lua_state, -1);
+        }
+        // the value or the error message
+        lua_pop(lua_state, 1);
+        return depends_only_on_tags;
+    }
+
+    ScriptingEnvironment scripting_environment;
+    const RestrictionParser restriction_parser;
+    WayFunctionCache way_function_cache;
+    ExtractionContainers extraction_containers;
+    std::unique_ptr<ExtractorCallbacks> extractor_callbacks;
+};
+}
+
 /**
  * TODO: Refactor this function into smaller functions for better readability.
  *
@@ -81,6 +159,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *  .osrm  : Nodes and edges in a intermediate format that easy to digest for osrm-prepare
  *  .restrictions : Turn restrictions that are used my osrm-prepare to construct the edge-expanded graph
  *
+ * Several profiles can be extracted from a single pass over the input file: it is decoded once
+ * and every profile runs on the same buffers, writing its own set of files.
  */
 int extractor::run()
 {
@@ -95,14 +175,19 @@ int extractor::run()
         tbb::task_scheduler_init init(number_of_threads);
 
         SimpleLogger().Write() << "Input file: " << config.input_path.filename().string();
-        SimpleLogger().Write() << "Profile: " << config.profile_path.filename().string();
+        for (const auto &profile_path : config.profile_paths)
+        {
+            SimpleLogger().Write() << "Profile: " << profile_path.filename().string();
+        }
         SimpleLogger().Write() << "Threads: " << number_of_threads;
 
-        // setup scripting environment
-        ScriptingEnvironment scripting_environment(config.profile_path.string().c_str());
-
-        ExtractionContainers extraction_containers;
-        auto extractor_callbacks = osrm::make_unique<ExtractorCallbacks>(extraction_containers);
+        // setup scripting environments, restriction parsers and containers
+        std::vector<std::unique_ptr<ProfileExtraction>> profiles;
+        for (const auto &profile_path : config.profile_paths)
+        {
+            profiles.emplace_back(osrm::make_unique<ProfileExtraction>(profile_path));
+        }
+        BOOST_ASSERT(profiles.size() == config.output_files.size());
 
         const osmium::io::File input_file(config.input_path.string());
         osmium::io::Reader reader(input_file);
@@ -131,95 +216,173 @@ int extractor::run()
         }
         SimpleLogger().Write() << "timestamp: " << timestamp;
 
-        boost::filesystem::ofstream timestamp_out(config.timestamp_file_name);
-        timestamp_out.write(timestamp.c_str(), timestamp.length());
-        timestamp_out.close();
-
-        // initialize vectors holding parsed objects
-        tbb::concurrent_vector<std::pair<std::size_t, ExtractionNode>> resulting_nodes;
-        tbb::concurrent_vector<std::pair<std::size_t, ExtractionWay>> resulting_ways;
-        tbb::concurrent_vector<mapbox::util::optional<InputRestrictionContainer>>
-            resulting_restrictions;
-
-        // setup restriction parser
-        const RestrictionParser restriction_parser(scripting_environment.get_lua_state());
-
-        while (const osmium::memory::Buffer buffer = reader.read())
+        for (const auto &output_files : config.output_files)
         {
-            // create a vector of iterators into the buffer
-            std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
-            for (auto iter = std::begin(buffer); iter != std::end(buffer); ++iter)
-            {
-                osm_elements.push_back(iter);
-            }
-
-            // clear resulting vectors
-            resulting_nodes.clear();
-            resulting_ways.clear();
-            resulting_restrictions.clear();
+            boost::filesystem::ofstream timestamp_out(output_files.timestamp_file_name);
+            timestamp_out.write(timestamp.c_str(), timestamp.length());
+            timestamp_out.close();
+        }
 
-            // parse OSM entities in parallel, store in resulting vectors
-            tbb::parallel_for(
-                tbb::blocked_range<std::size_t>(0, osm_elements.size()),
-                [&](const tbb::blocked_range<std::size_t> &range)
+        // Reading the file, running the profiles and feeding the results into the extraction
+        // containers overlap: while the callbacks consume one buffer, the next ones are
+        // already being read and processed. The callbacks see the buffers in file order.
+        const std::size_t max_buffers_in_flight = 2 * number_of_threads;
+        tbb::parallel_pipeline(
+            max_buffers_in_flight,
+            tbb::make_filter<void, std::shared_ptr<ParsedBuffer>>(
+                tbb::filter::serial_in_order,
+                [&](tbb::flow_control &flow_control)
                 {
-                    ExtractionNode result_node;
-                    ExtractionWay result_way;
-                    lua_State *local_state = scripting_environment.get_lua_state();
-
-                    for (auto x = range.begin(); x != range.end(); ++x)
+                    auto parsed_buffer = std::make_shared<ParsedBuffer>(profiles.size());
+                    parsed_buffer->buffer = reader.read();
+                    if (!parsed_buffer->buffer)
                     {
-                        const auto entity = osm_elements[x];
-
-                        switch (entity->type())
+                        flow_control.stop();
+                        return std::shared_ptr<ParsedBuffer>();
+                    }
+                    // create a vector of iterators into the buffer
+                    const osmium::memory::Buffer &buffer = parsed_buffer->buffer;
+                    for (auto iter = std::begin(buffer); iter != std::end(buffer); ++iter)
+                    {
+                        parsed_buffer->osm_elements.push_back(iter);
+                        switch (iter->type())
                         {
                         case osmium::item_type::node:
-                            result_node.clear();
                             ++number_of_nodes;
-                            luabind::call_function<void>(
-                                local_state, "node_function",
-                                boost::cref(static_cast<const osmium::Node &>(*entity)),
-                                boost::ref(result_node));
-                            resulting_nodes.push_back(std::make_pair(x, result_node));
                             break;
                         case osmium::item_type::way:
-                            result_way.clear();
                             ++number_of_ways;
-                            luabind::call_function<void>(
-                                local_state, "way_function",
-                                boost::cref(static_cast<const osmium::Way &>(*entity)),
-                                boost::ref(result_way));
-                            resulting_ways.push_back(std::make_pair(x, result_way));
                             break;
                         case osmium::item_type::relation:
                             ++number_of_relations;
-                            resulting_restrictions.push_back(restriction_parser.TryParse(
-                                static_cast<const osmium::Relation &>(*entity)));
                             break;
                         default:
                             ++number_of_others;
                             break;
                         }
                     }
-                });
+                    return parsed_buffer;
+                }) &
+                tbb::make_filter<std::shared_ptr<ParsedBuffer>, std::shared_ptr<ParsedBuffer>>(
+                    tbb::filter::parallel,
+                    [&](std::shared_ptr<ParsedBuffer> parsed_buffer)
+                    {
+                        const auto &osm_elements = parsed_buffer->osm_elements;
+
+                        // parse OSM entities in parallel, store in resulting vectors
+                        tbb::parallel_for(
+                            tbb::blocked_range<std::size_t>(0, osm_elements.size()),
+                            [&](const tbb::blocked_range<std::size_t> &range)
+                            {
+                                ExtractionNode result_node;
+                                ExtractionWay result_way;
+
+                                for (const auto profile_index :
+                                     osrm::irange<std::size_t>(0, profiles.size()))
+                                {
+                                    ProfileExtraction &profile = *profiles[profile_index];
+                                    ProfileResults &results =
+                                        parsed_buffer->results[profile_index];
+                                    lua_State *local_state =
+                                        profile.scripting_environment.get_lua_state();
+
+                                    for (auto x = range.begin(); x != range.end(); ++x)
+                                    {
+                                        const auto entity = osm_elements[x];
+
+                                        switch (entity->type())
+                                        {
+                                        case osmium::item_type::node:
+                                            result_node.clear();
+                                            luabind::call_function<void>(
+                                                local_state, "node_function",
+                                                boost::cref(
+                                                    static_cast<const osmium::Node &>(*entity)),
+                                                boost::ref(result_node));
+                                            results.resulting_nodes.push_back(
+                                                std::make_pair(x, result_node));
+                                            break;
+                                        case osmium::item_type::way:
+                                        {
+                                            const auto &way =
+                                                static_cast<const osmium::Way &>(*entity);
+                                            if (!profile.way_function_cache.Find(way, result_way))
+                                            {
+                                                result_way.clear();
+                                                luabind::call_function<void>(
+                                                    local_state, "way_function",
+                                                    boost::cref(way), boost::ref(result_way));
+                                                profile.way_function_cache.Insert(way,
+                                                                                  result_way);
+                                            }
+                                            results.resulting_ways.push_back(
+                                                std::make_pair(x, result_way));
+                                            break;
+                                        }
+                                        case osmium::item_type::relation:
+                                            results.resulting_restrictions.push_back(
+                                                std::make_pair(
+                                                    x, profile.restriction_parser.TryParse(
+                                                           static_cast<const osmium::Relation &>(
+                                                               *entity))));
+                                            break;
+                                        default:
+                                            break;
+                                        }
+                                    }
+                                }
+                            });
+
+                        // restore the order of the file, so the output does not depend on
+                        // the scheduling of the threads
+                        for (auto &results : parsed_buffer->results)
+                        {
+                            tbb::parallel_sort(results.resulting_nodes.begin(),
+                                               results.resulting_nodes.end(),
+                                               CompareElementPosition());
+                            tbb::parallel_sort(results.resulting_ways.begin(),
+                                               results.resulting_ways.end(),
+                                               CompareElementPosition());
+                            tbb::parallel_sort(results.resulting_restrictions.begin(),
+                                               results.resulting_restrictions.end(),
+                                               CompareElementPosition());
+                        }
+                        return parsed_buffer;
+                    }) &
+                tbb::make_filter<std::shared_ptr<ParsedBuffer>, void>(
+                    tbb::filter::serial_in_order,
+                    [&](std::shared_ptr<ParsedBuffer> parsed_buffer)
+                    {
+                        const auto &osm_elements = parsed_buffer->osm_elements;
 
-            // put parsed objects thru extractor callbacks
-            for (const auto &result : resulting_nodes)
-            {
-                extractor_callbacks->ProcessNode(
-                    static_cast<const osmium::Node &>(*(osm_elements[result.first])),
-                    result.second);
-            }
-            for (const auto &result : resulting_ways)
-            {
-                extractor_callbacks->ProcessWay(
-                    static_cast<const osmium::Way &>(*(osm_elements[result.first])), result.second);
-            }
-            for (const auto &result : resulting_restrictions)
-            {
-                extractor_callbacks->ProcessRestriction(result);
-            }
-        }
+                        // put parsed objects thru extractor callbacks
+                        for (const auto profile_index :
+                             osrm::irange<std::size_t>(0, profiles.size()))
+                        {
+                            ExtractorCallbacks &extractor_callbacks =
+                                *profiles[profile_index]->extractor_callbacks;
+                            const ProfileResults &results = parsed_buffer->results[profile_index];
+
+                            for (const auto &result : results.resulting_nodes)
+                            {
+                                extractor_callbacks.ProcessNode(
+                                    static_cast<const osmium::Node &>(
+                                        *(osm_elements[result.first])),
+                                    result.second);
+                            }
+                            for (const auto &result : results.resulting_ways)
+                            {
+                                extractor_callbacks.ProcessWay(
+                                    static_cast<const osmium::Way &>(
+                                        *(osm_elements[result.first])),
+                                    result.second);
+                            }
+                            for (const auto &result : results.resulting_restrictions)
+                            {
+                                extractor_callbacks.ProcessRestriction(result.second);
+                            }
+                        }
+                    }));
         TIMER_STOP(parsing);
         SimpleLogger().Write() << "Parsing finished after " << TIMER_SEC(parsing) << " seconds";
 
@@ -228,22 +391,52 @@ int extractor::run()
                                << number_of_relations.load() << " relations, and "
                                << number_of_others.load() << " unknown entities";
 
-        extractor_callbacks.reset();
+        bool input_is_empty = false;
+        for (const auto profile_index : osrm::irange<std::size_t>(0, profiles.size()))
+        {
+            ProfileExtraction &profile = *profiles[profile_index];
+            const ExtractorOutputFiles &output_files = config.output_files[profile_index];
+
+            SimpleLogger().Write() << "Writing data of profile "
+                                   << config.profile_paths[profile_index].filename().string();
+
+            if (profile.way_function_cache.IsEnabled())
+            {
+                const auto hits = profile.way_function_cache.GetNumberOfHits();
+                const auto lookups = hits + profile.way_function_cache.GetNumberOfMisses();
+                SimpleLogger().Write()
+                    << "way_function cache: " << hits << " of " << lookups << " ways ("
+                    << (0 == lookups ? 0. : 100. * hits / lookups) << "%) hit "
+                    << profile.way_function_cache.GetNumberOfEntries()
+                    << " cached tag combinations";
+            }
 
-        if (extraction_containers.all_edges_list.empty())
+            profile.extractor_callbacks.reset();
+
+            if (profile.extraction_containers.all_edges_list.empty())
+            {
+                SimpleLogger().Write(logWARNING) << "The input data is empty, skipping.";
+                input_is_empty = true;
+                continue;
+            }
+
+            profile.extraction_containers.PrepareData(
+                output_files.output_file_name, output_files.restriction_file_name,
+                output_files.names_file_name, config.use_in_memory);
+        }
+        if (input_is_empty)
         {
-            SimpleLogger().Write(logWARNING) << "The input data is empty, exiting.";
             return 1;
         }
 
-        extraction_containers.PrepareData(config.output_file_name,
-                                          config.restriction_file_name,
-                                          config.names_file_name);
         TIMER_STOP(extracting);
         SimpleLogger().Write() << "extraction finished after " << TIMER_SEC(extracting) << "s";
-        SimpleLogger().Write() << "To prepare the data for routing, run: "
-                               << "./osrm-prepare " << config.output_file_name
-                               << std::endl;
+        for (const auto &output_files : config.output_files)
+        {
+            SimpleLogger().Write() << "To prepare the data for routing, run: "
+                                   << "./osrm-prepare " << output_files.output_file_name
+                                   << std::endl;
+        }
     }
     catch (std::exception &e)
     {
@@ -48,14 +48,22 @@ ExtractorOptions::ParseArguments(int argc, char *argv[], ExtractorConfig &extrac
 
     // declare a group of options that will be allowed both on command line and in config file
     boost::program_options::options_description config_options("Configuration");
-    config_options.add_options()("profile,p",
-                                 boost::program_options::value<boost::filesystem::path>(
-                                     &extractor_config.profile_path)->default_value("profile.lua"),
-                                 "Path to LUA routing profile")(
+    config_options.add_options()(
+        "profile,p",
+        boost::program_options::value<std::vector<boost::filesystem::path>>(
+            &extractor_config.profile_paths)
+            ->composing()
+            ->default_value(std::vector<boost::filesystem::path>{"profile.lua"}, "profile.lua"),
+        "Path to LUA routing profile, repeat to extract for several profiles at once")(
         "threads,t",
         boost::program_options::value<unsigned int>(&extractor_config.requested_num_threads)
             ->default_value(tbb::task_scheduler_init::default_num_threads()),
-        "Number of threads to use");
+        "Number of threads to use")(
+        "in-memory",
+        boost::program_options::value<bool>(&extractor_config.use_in_memory)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Sort and merge the collected data in RAM instead of with stxxl");
 
     // hidden options, will be allowed both on command line and in config file, but will not be
     // shown to the user
@@ -132,47 +140,57 @@ ExtractorOptions::ParseArguments(int argc, char *argv[], ExtractorConfig &extrac
 
 void ExtractorOptions::GenerateOutputFilesNames(ExtractorConfig &extractor_config)
 {
-    boost::filesystem::path &input_path = extractor_config.input_path;
-    extractor_config.output_file_name = input_path.string();
-    extractor_config.restriction_file_name = input_path.string();
-    extractor_config.names_file_name = input_path.string();
-    extractor_config.timestamp_file_name = input_path.string();
-    std::string::size_type pos = extractor_config.output_file_name.find(".osm.bz2");
+    const std::string input_file_name = extractor_config.input_path.string();
+
+    // the file extension of the input is replaced, or the suffix appended if there is none
+    std::string::size_type pos = input_file_name.find(".osm.bz2");
+    std::string::size_type length = 8;
     if (pos == std::string::npos)
     {
-        pos = extractor_config.output_file_name.find(".osm.pbf");
+        pos = input_file_name.find(".osm.pbf");
         if (pos == std::string::npos)
         {
-            pos = extractor_config.output_file_name.find(".osm.xml");
+            pos = input_file_name.find(".osm.xml");
         }
     }
     if (pos == std::string::npos)
     {
-        pos = extractor_config.output_file_name.find(".pbf");
+        pos = input_file_name.find(".pbf");
     }
     if (pos == std::string::npos)
     {
-        pos = extractor_config.output_file_name.find(".osm");
+        pos = input_file_name.find(".osm");
+        length = 5;
+    }
+    const auto file_name = [&](const std::string &suffix)
+    {
+        std::string name = input_file_name;
         if (pos == std::string::npos)
         {
-            extractor_config.output_file_name.append(".osrm");
-            extractor_config.restriction_file_name.append(".osrm.restrictions");
-            extractor_config.names_file_name.append(".osrm.names");
-            extractor_config.timestamp_file_name.append(".osrm.timestamp");
+            name.append(suffix);
         }
         else
         {
-            extractor_config.output_file_name.replace(pos, 5, ".osrm");
-            extractor_config.restriction_file_name.replace(pos, 5, ".osrm.restrictions");
-            extractor_config.names_file_name.replace(pos, 5, ".osrm.names");
-            extractor_config.timestamp_file_name.replace(pos, 5, ".osrm.timestamp");
+            name.replace(pos, length, suffix);
         }
-    }
-    else
+        return name;
+    };
+
+    // with several profiles, the name of each profile becomes part of its file names,
+    // e.g. map.car.osrm and map.foot.osrm
+    extractor_config.output_files.clear();
+    for (const auto &profile_path : extractor_config.profile_paths)
     {
-        extractor_config.output_file_name.replace(pos, 8, ".osrm");
-        extractor_config.restriction_file_name.replace(pos, 8, ".osrm.restrictions");
-        extractor_config.names_file_name.replace(pos, 8, ".osrm.names");
-        extractor_config.timestamp_file_name.replace(pos, 8, ".osrm.timestamp");
+        std::string prefix;
+        if (extractor_config.profile_paths.size() > 1)
+        {
+            prefix = "." + profile_path.stem().string();
+        }
+        ExtractorOutputFiles output_files;
+        output_files.output_file_name = file_name(prefix + ".osrm");
+        output_files.restriction_file_name = file_name(prefix + ".osrm.restrictions");
+        output_files.names_file_name = file_name(prefix + ".osrm.names");
+        output_files.timestamp_file_name = file_name(prefix + ".osrm.timestamp");
+        extractor_config.output_files.push_back(output_files);
     }
 }
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem/path.hpp>
 
 #include <string>
+#include <vector>
 
 enum class return_code : unsigned
 {
@@ -39,19 +40,28 @@ enum class return_code : unsigned
     exit
 };
 
-struct ExtractorConfig
+// the files written for one profile
+struct ExtractorOutputFiles
 {
-    ExtractorConfig() noexcept : requested_num_threads(0) {}
-    boost::filesystem::path config_file_path;
-    boost::filesystem::path input_path;
-    boost::filesystem::path profile_path;
-
     std::string output_file_name;
     std::string restriction_file_name;
     std::string names_file_name;
     std::string timestamp_file_name;
+};
+
+struct ExtractorConfig
+{
+    ExtractorConfig() noexcept : requested_num_threads(0), use_in_memory(false) {}
+    boost::filesystem::path config_file_path;
+    boost::filesystem::path input_path;
+    // all profiles are run on the same pass over the input file
+    std::vector<boost::filesystem::path> profile_paths;
+
+    // one entry per profile, in the same order
+    std::vector<ExtractorOutputFiles> output_files;
 
     unsigned requested_num_threads;
+    bool use_in_memory;
 };
 
 struct ExtractorOptions
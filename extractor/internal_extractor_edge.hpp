@@ -36,6 +36,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
+#include <tuple>
+
 struct InternalExtractorEdge
 {
     // specify the type of the weight data
@@ -110,9 +112,31 @@ struct CmpEdgeByStartThenTargetID
     using value_type = InternalExtractorEdge;
     bool operator()(const InternalExtractorEdge &lhs, const InternalExtractorEdge &rhs) const
     {
-        return (lhs.result.source <  rhs.result.source) ||
-              ((lhs.result.source == rhs.result.source) &&
-               (lhs.result.target <  rhs.result.target));
+        if (lhs.result.source != rhs.result.source)
+        {
+            return lhs.result.source < rhs.result.source;
+        }
+        if (lhs.result.target != rhs.result.target)
+        {
+            return lhs.result.target < rhs.result.target;
+        }
+        // invalidated edges are all equal to max_value()
+        if (lhs.result.source == SPECIAL_NODEID)
+        {
+            return false;
+        }
+        // break ties between parallel edges, so the multi-edge removal picks the same edge
+        // regardless of how the edges were sorted
+        return TieBreakKey(lhs.result) < TieBreakKey(rhs.result);
+    }
+
+    using TieBreakKeyT =
+        std::tuple<EdgeWeight, NodeID, bool, bool, bool, bool, bool, bool, unsigned>;
+    static TieBreakKeyT TieBreakKey(const NodeBasedEdge &edge)
+    {
+        return TieBreakKeyT(edge.weight, edge.name_id, edge.forward, edge.backward,
+                            edge.roundabout, edge.in_tiny_cc, edge.access_restricted,
+                            edge.is_split, edge.travel_mode);
     }
 
     value_type max_value() { return InternalExtractorEdge::max_value(); }
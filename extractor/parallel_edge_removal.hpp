@@ -0,0 +1,140 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef PARALLEL_EDGE_REMOVAL_HPP
+#define PARALLEL_EDGE_REMOVAL_HPP
+
+#include "internal_extractor_edge.hpp"
+
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+/**
+ * Keeps one edge per direction out of each group of parallel edges in edges[first, last)
+ * and invalidates the others. The edges have to be oriented so that source < target and
+ * sorted by CmpEdgeByStartThenTargetID. A range must not split a group.
+ */
+template <typename EdgeListT>
+void RemoveParallelEdges(EdgeListT &edges, const std::size_t first, const std::size_t last)
+{
+    const auto is_parallel_edge = [&edges](const std::size_t i, const std::size_t j)
+    {
+        return edges[i].result.source == edges[j].result.source &&
+               edges[i].result.target == edges[j].result.target;
+    };
+
+    for (std::size_t i = first; i < last;)
+    {
+        // only invalid edges left
+        if (edges[i].result.source == SPECIAL_NODEID)
+        {
+            break;
+        }
+        // skip invalid edges
+        if (edges[i].result.target == SPECIAL_NODEID)
+        {
+            ++i;
+            continue;
+        }
+
+        const std::size_t start_idx = i;
+
+        int min_forward_weight = std::numeric_limits<int>::max();
+        int min_backward_weight = std::numeric_limits<int>::max();
+        std::size_t min_forward_idx = std::numeric_limits<std::size_t>::max();
+        std::size_t min_backward_idx = std::numeric_limits<std::size_t>::max();
+
+        // find minimal edge in both directions
+        do
+        {
+            if (edges[i].result.forward && edges[i].result.weight < min_forward_weight)
+            {
+                min_forward_weight = edges[i].result.weight;
+                min_forward_idx = i;
+            }
+            if (edges[i].result.backward && edges[i].result.weight < min_backward_weight)
+            {
+                min_backward_weight = edges[i].result.weight;
+                min_backward_idx = i;
+            }
+
+            // this also increments the outer loop counter!
+            i++;
+        } while (i < last && is_parallel_edge(start_idx, i));
+
+        BOOST_ASSERT(min_forward_idx == std::numeric_limits<std::size_t>::max() ||
+                     min_forward_idx < i);
+        BOOST_ASSERT(min_backward_idx == std::numeric_limits<std::size_t>::max() ||
+                     min_backward_idx < i);
+        BOOST_ASSERT(min_backward_idx != std::numeric_limits<std::size_t>::max() ||
+                     min_forward_idx != std::numeric_limits<std::size_t>::max());
+
+        if (min_backward_idx == min_forward_idx)
+        {
+            edges[min_forward_idx].result.is_split = false;
+            edges[min_forward_idx].result.forward = true;
+            edges[min_forward_idx].result.backward = true;
+        }
+        else
+        {
+            bool has_forward = min_forward_idx != std::numeric_limits<std::size_t>::max();
+            bool has_backward = min_backward_idx != std::numeric_limits<std::size_t>::max();
+            if (has_forward)
+            {
+                edges[min_forward_idx].result.forward = true;
+                edges[min_forward_idx].result.backward = false;
+                edges[min_forward_idx].result.is_split = has_backward;
+            }
+            if (has_backward)
+            {
+                std::swap(edges[min_backward_idx].result.source,
+                          edges[min_backward_idx].result.target);
+                edges[min_backward_idx].result.forward = true;
+                edges[min_backward_idx].result.backward = false;
+                edges[min_backward_idx].result.is_split = has_forward;
+            }
+        }
+
+        // invalidate all unused edges
+        for (std::size_t j = start_idx; j < i; j++)
+        {
+            if (j == min_forward_idx || j == min_backward_idx)
+            {
+                continue;
+            }
+            edges[j].result.source = SPECIAL_NODEID;
+            edges[j].result.target = SPECIAL_NODEID;
+        }
+    }
+}
+
+#endif // PARALLEL_EDGE_REMOVAL_HPP
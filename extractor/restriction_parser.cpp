@@ -69,6 +69,8 @@ void RestrictionParser::ReadUseRestrictionsSetting(lua_State *lua_state)
     {
         use_turn_restrictions = lua_toboolean(lua_state, -1);
     }
+    // the value or the error message
+    lua_pop(lua_state, 1);
 
     if (use_turn_restrictions)
     {
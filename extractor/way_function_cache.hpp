@@ -0,0 +1,112 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef WAY_FUNCTION_CACHE_HPP
+#define WAY_FUNCTION_CACHE_HPP
+
+#include "extraction_way.hpp"
+
+#include <osmium/osm/way.hpp>
+
+#include <tbb/concurrent_unordered_map.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * Caches the results of the way_function of a profile, keyed by the tags of the way.
+ *
+ * Most ways share one of a few tag combinations, so a cache hit saves a call into lua.
+ * This is only correct for profiles whose way_function depends on nothing but the tags,
+ * which they declare by setting way_function_depends_only_on_tags = true.
+ * Lookups and insertions are thread-safe.
+ */
+class WayFunctionCache
+{
+  public:
+    // bounds the memory used by tag combinations that never repeat, e.g. because of names
+    static constexpr std::size_t MaxEntries = 1 << 20;
+
+    explicit WayFunctionCache(const bool enabled) : enabled(enabled), hits(0), misses(0) {}
+
+    bool IsEnabled() const { return enabled; }
+
+    // copies the cached result for the tags of the way into result, returns false on a miss
+    bool Find(const osmium::Way &way, ExtractionWay &result)
+    {
+        if (!enabled)
+        {
+            return false;
+        }
+        const auto iter = cache.find(GetKey(way));
+        if (iter == cache.end())
+        {
+            ++misses;
+            return false;
+        }
+        ++hits;
+        result = iter->second;
+        return true;
+    }
+
+    void Insert(const osmium::Way &way, const ExtractionWay &result)
+    {
+        if (!enabled || cache.size() >= MaxEntries)
+        {
+            return;
+        }
+        cache.insert(std::make_pair(GetKey(way), result));
+    }
+
+    std::uint64_t GetNumberOfHits() const { return hits; }
+    std::uint64_t GetNumberOfMisses() const { return misses; }
+    std::size_t GetNumberOfEntries() const { return cache.size(); }
+
+  private:
+    // all keys and values in order of the file, separated by the zero byte that cannot be
+    // part of a tag
+    static std::string GetKey(const osmium::Way &way)
+    {
+        std::string key;
+        for (const osmium::Tag &tag : way.tags())
+        {
+            key += tag.key();
+            key += '\0';
+            key += tag.value();
+            key += '\0';
+        }
+        return key;
+    }
+
+    const bool enabled;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+    tbb::concurrent_unordered_map<std::string, ExtractionWay> cache;
+};
+
+#endif // WAY_FUNCTION_CACHE_HPP
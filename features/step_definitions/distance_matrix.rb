@@ -7,10 +7,10 @@ When /^I request a travel time matrix I should get$/ do |table|
   nodes = []
   column_headers = table.headers[1..-1]
   row_headers = table.rows.map { |h| h.first }
-  unless column_headers==row_headers
-    raise "*** Column and row headers must match in matrix table, got #{column_headers.inspect} and #{row_headers.inspect}"
-  end
-  column_headers.each do |node_name|
+  # rows are sources and columns are destinations, request a rectangular table if they differ
+  symmetric = column_headers==row_headers
+  node_names = symmetric ? column_headers : (row_headers + column_headers).uniq
+  node_names.each do |node_name|
     node = find_node_by_name(node_name)
     raise "*** unknown node '#{node_name}" unless node
     nodes << node
@@ -23,6 +23,12 @@ When /^I request a travel time matrix I should get$/ do |table|
     
     # compute matrix
     params = @query_params
+    unless symmetric
+      params = params.merge({
+        'sources' => row_headers.map { |n| node_names.index n }.join(','),
+        'destinations' => column_headers.map { |n| node_names.index n }.join(',')
+      })
+    end
     response = request_table nodes, params
     if response.body.empty? == false
       json = JSON.parse response.body
@@ -34,7 +40,7 @@ When /^I request a travel time matrix I should get$/ do |table|
       
       # fuzzy match
       ok = true
-      0.upto(nodes.size-1) do |i|
+      0.upto(column_headers.size-1) do |i|
         if FuzzyMatch.match result[ri][i], row[i+1]
           result[ri][i] = row[i+1]
         elsif row[i+1]=="" and result[ri][i]==no_route
@@ -100,3 +100,31 @@ Feature: Basic Distance Matrix
             | y | 500 | 0   | 300 | 200 |
             | d | 200 | 300 | 0   | 300 |
             | e | 300 | 400 | 100 | 0   |
+
+    Scenario: Testbot - Travel time matrix with sources and destinations
+        Given the node map
+            | a | b | c | d |
+
+        And the ways
+            | nodes |
+            | abcd  |
+
+        When I request a travel time matrix I should get
+            |   | b   | c   | d   |
+            | a | 100 | 200 | 300 |
+            | d | 200 | 100 | 0   |
+
+    Scenario: Testbot - Travel time matrix with a single source
+        Given the node map
+            | x | a | b | y |
+            |   | d | e |   |
+
+        And the ways
+            | nodes | oneway |
+            | abeda | yes    |
+            | xa    |        |
+            | by    |        |
+
+        When I request a travel time matrix I should get
+            |   | x   | y   | d   | e   |
+            | e | 300 | 400 | 100 | 0   |
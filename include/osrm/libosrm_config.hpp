@@ -35,13 +35,14 @@ struct libosrm_config
     libosrm_config(const libosrm_config &) = delete;
     libosrm_config()
         : max_locations_distance_table(100), max_locations_map_matching(-1),
-          use_shared_memory(true)
+          use_shared_memory(true), prefault_index(false)
     {
     }
 
     libosrm_config(const ServerPaths &paths, const bool sharedmemory_flag, const int max_table, const int max_matching)
         : server_paths(paths), max_locations_distance_table(max_table),
-          max_locations_map_matching(max_matching), use_shared_memory(sharedmemory_flag)
+          max_locations_map_matching(max_matching), use_shared_memory(sharedmemory_flag),
+          prefault_index(false)
     {
     }
 
@@ -49,6 +50,8 @@ struct libosrm_config
     int max_locations_distance_table;
     int max_locations_map_matching;
     bool use_shared_memory;
+    // touch every page of the memory-mapped leaf index at startup
+    bool prefault_index;
 };
 
 #endif // SERVER_CONFIG_HPP
@@ -81,6 +81,10 @@ struct RouteParameters
     
     void getCoordinatesFromGeometry(const std::string geometry_string);
 
+    void setSources(const std::vector<unsigned> &indices);
+
+    void setDestinations(const std::vector<unsigned> &indices);
+
     short zoom_level;
     bool print_instructions;
     bool alternate_route;
@@ -101,6 +105,9 @@ struct RouteParameters
     std::vector<unsigned> timestamps;
     std::vector<bool> uturns;
     std::vector<FixedPointCoordinate> coordinates;
+    // indices into coordinates, used by the distance table
+    std::vector<unsigned> sources;
+    std::vector<unsigned> destinations;
 };
 
 #endif // ROUTE_PARAMETERS_HPP
@@ -25,14 +25,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-namespace boost
-{
-namespace interprocess
-{
-class named_mutex;
-}
-}
-
 #include "osrm_impl.hpp"
 #include "osrm.hpp"
 
@@ -45,59 +37,103 @@ class named_mutex;
 #include "../plugins/match.hpp"
 #include "../server/data_structures/datafacade_base.hpp"
 #include "../server/data_structures/internal_datafacade.hpp"
-#include "../server/data_structures/shared_barriers.hpp"
 #include "../server/data_structures/shared_datafacade.hpp"
 #include "../util/make_unique.hpp"
 #include "../util/routed_options.hpp"
 #include "../util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
-#include <boost/interprocess/sync/named_condition.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 
 #include <osrm/route_parameters.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <thread>
 #include <utility>
 #include <vector>
 
 OSRM_impl::OSRM_impl(libosrm_config &lib_config)
+    : max_locations_distance_table(lib_config.max_locations_distance_table),
+      max_locations_map_matching(lib_config.max_locations_map_matching),
+      use_shared_memory(lib_config.use_shared_memory), prefault_index(lib_config.prefault_index),
+      current_generation(0), stop_watching(false)
 {
-    if (lib_config.use_shared_memory)
+    active_queries[0] = 0;
+    active_queries[1] = 0;
+
+    if (use_shared_memory)
     {
-        barrier = osrm::make_unique<SharedBarriers>();
-        query_data_facade = new SharedDataFacade<QueryEdge::EdgeData>();
+        datasets[0] = LoadDataset(new SharedDataFacade<QueryEdge::EdgeData>(prefault_index));
+        watcher_thread = std::thread(&OSRM_impl::WatchSharedMemory, this);
     }
     else
     {
         // populate base path
         populate_base_path(lib_config.server_paths);
-        query_data_facade = new InternalDataFacade<QueryEdge::EdgeData>(lib_config.server_paths);
+        datasets[0] = LoadDataset(
+            new InternalDataFacade<QueryEdge::EdgeData>(lib_config.server_paths, prefault_index));
     }
+}
 
+template <class DataFacadeT>
+std::unique_ptr<OSRM_impl::Dataset> OSRM_impl::LoadDataset(DataFacadeT *facade)
+{
+    auto dataset = osrm::make_unique<Dataset>();
+    dataset->facade.reset(facade);
+    RegisterPlugins(facade, dataset->plugin_map);
+    return dataset;
+}
+
+// The plugins are instantiated on the concrete (final) facade type, so that the graph accessors
+// in the search loops are bound statically and can be inlined instead of going through the
+// virtual interface of BaseDataFacade.
+template <class DataFacadeT>
+void OSRM_impl::RegisterPlugins(DataFacadeT *facade, PluginMap &plugin_map) const
+{
     // The following plugins handle all requests.
-    RegisterPlugin(new DistanceTablePlugin<BaseDataFacade<QueryEdge::EdgeData>>(
-        query_data_facade, lib_config.max_locations_distance_table));
-    RegisterPlugin(new HelloWorldPlugin());
-    RegisterPlugin(new LocatePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new NearestPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new MapMatchingPlugin<BaseDataFacade<QueryEdge::EdgeData>>(
-        query_data_facade, lib_config.max_locations_map_matching));
-    RegisterPlugin(new TimestampPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new ViaRoutePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
+    RegisterPlugin(plugin_map, new HelloWorldPlugin());
+    RegisterPlugin(plugin_map, new LocatePlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugin_map, new NearestPlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugin_map, new TimestampPlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugin_map, new ViaRoutePlugin<DataFacadeT>(facade));
+
+    // The many-to-many searches of these need a contracted graph. Requests for them are refused
+    // on data of osrm-prepare --mld, the overlay is only searched for shortest paths.
+    if (facade->HasMultiLevelPartition())
+    {
+        SimpleLogger().Write(logWARNING)
+            << "table and match are not available on a multi-level partition";
+        return;
+    }
+    RegisterPlugin(plugin_map,
+                   new DistanceTablePlugin<DataFacadeT>(facade, max_locations_distance_table));
+    RegisterPlugin(plugin_map,
+                   new MapMatchingPlugin<DataFacadeT>(facade, max_locations_map_matching));
 }
 
 OSRM_impl::~OSRM_impl()
 {
-    delete query_data_facade;
+    if (watcher_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> reload_lock(reload_mutex);
+            stop_watching = true;
+        }
+        reload_condition.notify_all();
+        watcher_thread.join();
+    }
+}
+
+OSRM_impl::Dataset::~Dataset()
+{
     for (PluginMap::value_type &plugin_pointer : plugin_map)
     {
         delete plugin_pointer.second;
     }
 }
 
-void OSRM_impl::RegisterPlugin(BasePlugin *plugin)
+void OSRM_impl::RegisterPlugin(PluginMap &plugin_map, BasePlugin *plugin) const
 {
     SimpleLogger().Write() << "loaded plugin: " << plugin->GetDescriptor();
     if (plugin_map.find(plugin->GetDescriptor()) != plugin_map.end())
@@ -109,65 +145,113 @@ void OSRM_impl::RegisterPlugin(BasePlugin *plugin)
 
 int OSRM_impl::RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result)
 {
-    const auto &plugin_iterator = plugin_map.find(route_parameters.service);
+    const unsigned generation = AcquireDataset();
+    const Dataset &dataset = *datasets[generation % 2];
 
-    if (plugin_map.end() == plugin_iterator)
+    const auto &plugin_iterator = dataset.plugin_map.find(route_parameters.service);
+    if (dataset.plugin_map.end() == plugin_iterator)
     {
+        ReleaseDataset(generation);
         return 400;
     }
 
-    increase_concurrent_query_count();
-    plugin_iterator->second->HandleRequest(route_parameters, json_result);
-    decrease_concurrent_query_count();
+    try
+    {
+        plugin_iterator->second->HandleRequest(route_parameters, json_result);
+    }
+    catch (...)
+    {
+        ReleaseDataset(generation);
+        throw;
+    }
+    ReleaseDataset(generation);
     return 200;
 }
 
-// decrease number of concurrent queries
-void OSRM_impl::decrease_concurrent_query_count()
+unsigned OSRM_impl::AcquireDataset()
 {
-    if (!barrier)
+    while (true)
     {
-        return;
+        const unsigned generation = current_generation.load();
+        ++active_queries[generation % 2];
+        // the generation might have been replaced before it was pinned, its slot may be reused
+        if (generation == current_generation.load())
+        {
+            return generation;
+        }
+        ReleaseDataset(generation);
     }
-    // lock query
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-        barrier->query_mutex);
+}
 
-    // decrement query count
-    --(barrier->number_of_queries);
-    BOOST_ASSERT_MSG(0 <= barrier->number_of_queries, "invalid number of queries");
+void OSRM_impl::ReleaseDataset(const unsigned generation)
+{
+    const int remaining_queries = --active_queries[generation % 2];
+    BOOST_ASSERT_MSG(0 <= remaining_queries, "invalid number of queries");
 
-    // notify all processes that were waiting for this condition
-    if (0 == barrier->number_of_queries)
+    // the watcher waits for the last query on a retired generation before it frees it
+    if (0 == remaining_queries && generation != current_generation.load())
     {
-        barrier->no_running_queries_condition.notify_all();
+        std::lock_guard<std::mutex> reload_lock(reload_mutex);
+        reload_condition.notify_all();
     }
 }
 
-// increase number of concurrent queries
-void OSRM_impl::increase_concurrent_query_count()
+void OSRM_impl::WatchSharedMemory()
 {
-    if (!barrier)
-    {
-        return;
-    }
+    const auto poll_interval = std::chrono::milliseconds(100);
+    const auto retry_interval = std::chrono::seconds(10);
 
-    // lock update pending
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> pending_lock(
-        barrier->pending_update_mutex);
-
-    // lock query
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-        barrier->query_mutex);
-
-    // unlock update pending
-    pending_lock.unlock();
+    std::unique_lock<std::mutex> reload_lock(reload_mutex);
+    while (!reload_condition.wait_for(reload_lock, poll_interval, [this]
+                                      {
+                                          return stop_watching;
+                                      }))
+    {
+        const unsigned generation = current_generation.load();
+        const auto *facade = static_cast<const SharedDataFacade<QueryEdge::EdgeData> *>(
+            datasets[generation % 2]->facade.get());
+        if (!facade->IsOutdated())
+        {
+            continue;
+        }
 
-    // increment query count
-    ++(barrier->number_of_queries);
+        // queries keep running on the current generation while the next one is loaded, the
+        // slot of the next generation is only touched by this thread
+        const unsigned next_slot = (generation + 1) % 2;
+        BOOST_ASSERT(!datasets[next_slot]);
+        reload_lock.unlock();
+        try
+        {
+            datasets[next_slot] =
+                LoadDataset(new SharedDataFacade<QueryEdge::EdgeData>(prefault_index));
+        }
+        catch (const std::exception &e)
+        {
+            SimpleLogger().Write(logWARNING) << "could not load the new dataset, retrying in "
+                                             << retry_interval.count() << "s: " << e.what();
+        }
+        reload_lock.lock();
+        if (!datasets[next_slot])
+        {
+            reload_condition.wait_for(reload_lock, retry_interval, [this]
+                                      {
+                                          return stop_watching;
+                                      });
+            continue;
+        }
+        current_generation.store(generation + 1);
+        SimpleLogger().Write() << "switched to dataset generation " << generation + 1;
 
-    (static_cast<SharedDataFacade<QueryEdge::EdgeData> *>(query_data_facade))
-        ->CheckAndReloadFacade();
+        // Queries that pin the retired slot from now on find the generation changed and back
+        // off without touching it. Freeing it unmaps the shared memory regions, so that
+        // osrm-datastore can finish.
+        const unsigned retired_slot = generation % 2;
+        reload_condition.wait(reload_lock, [this, retired_slot]
+                              {
+                                  return stop_watching || 0 == active_queries[retired_slot].load();
+                              });
+        datasets[retired_slot].reset();
+    }
 }
 
 // proxy code for compilation firewall
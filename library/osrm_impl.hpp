@@ -36,11 +36,15 @@ struct RouteParameters;
 #include <osrm/json_container.hpp>
 #include <osrm/libosrm_config.hpp>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <string>
+#include <thread>
 
-struct SharedBarriers;
 template <class EdgeDataT> class BaseDataFacade;
 
 class OSRM_impl
@@ -48,6 +52,17 @@ class OSRM_impl
   private:
     using PluginMap = std::unordered_map<std::string, BasePlugin *>;
 
+    // a facade together with the plugins that answer queries on it
+    struct Dataset
+    {
+        Dataset() = default;
+        Dataset(const Dataset &) = delete;
+        ~Dataset();
+
+        std::unique_ptr<BaseDataFacade<QueryEdge::EdgeData>> facade;
+        PluginMap plugin_map;
+    };
+
   public:
     OSRM_impl(libosrm_config &lib_config);
     OSRM_impl(const OSRM_impl &) = delete;
@@ -55,17 +70,37 @@ class OSRM_impl
     int RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result);
 
   private:
-    void RegisterPlugin(BasePlugin *plugin);
-    PluginMap plugin_map;
-    // will only be initialized if shared memory is used
-    std::unique_ptr<SharedBarriers> barrier;
-    // base class pointer to the objects
-    BaseDataFacade<QueryEdge::EdgeData> *query_data_facade;
-
-    // decrease number of concurrent queries
-    void decrease_concurrent_query_count();
-    // increase number of concurrent queries
-    void increase_concurrent_query_count();
+    template <class DataFacadeT> std::unique_ptr<Dataset> LoadDataset(DataFacadeT *facade);
+    template <class DataFacadeT>
+    void RegisterPlugins(DataFacadeT *facade, PluginMap &plugin_map) const;
+    void RegisterPlugin(PluginMap &plugin_map, BasePlugin *plugin) const;
+
+    // pin the current dataset generation for the duration of a query
+    unsigned AcquireDataset();
+    void ReleaseDataset(const unsigned generation);
+    // Runs on its own thread while shared memory is used. Loads the dataset osrm-datastore
+    // published last, makes it the current generation and frees the previous one once no query
+    // runs on it anymore. Queries never wait for this.
+    void WatchSharedMemory();
+
+    const int max_locations_distance_table;
+    const int max_locations_map_matching;
+    const bool use_shared_memory;
+    const bool prefault_index;
+
+    // Generation g lives in slot g % 2. Queries never lock, they count themselves into the slot
+    // of the current generation. A slot is only reused or freed after the generation moved on
+    // and its counter drained, so at most two datasets are mapped at any time.
+    std::array<std::unique_ptr<Dataset>, 2> datasets;
+    std::array<std::atomic<int>, 2> active_queries;
+    std::atomic<unsigned> current_generation;
+
+    // guards stop_watching and the wakeups of the watcher, queries only take it when they were
+    // the last one on a retired generation
+    std::mutex reload_mutex;
+    std::condition_variable reload_condition;
+    bool stop_watching;
+    std::thread watcher_thread;
 };
 
 #endif // OSRM_IMPL_HPP
@@ -76,13 +76,72 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
         }
 
         const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
-        unsigned max_locations =
-            std::min(static_cast<unsigned>(max_locations_distance_table),
-                     static_cast<unsigned>(route_parameters.coordinates.size()));
+        const auto number_of_coordinates =
+            static_cast<unsigned>(route_parameters.coordinates.size());
 
-        PhantomNodeArray phantom_node_vector(max_locations);
-        for (const auto i : osrm::irange(0u, max_locations))
+        std::vector<unsigned> source_indices = route_parameters.sources;
+        std::vector<unsigned> destination_indices = route_parameters.destinations;
+        if (source_indices.empty() && destination_indices.empty())
         {
+            // square table over the first max_locations coordinates
+            const unsigned max_locations =
+                std::min(static_cast<unsigned>(max_locations_distance_table), number_of_coordinates);
+            for (const auto i : osrm::irange(0u, max_locations))
+            {
+                source_indices.push_back(i);
+            }
+            destination_indices = source_indices;
+        }
+        else
+        {
+            // a missing list means all coordinates
+            for (auto *indices : {&source_indices, &destination_indices})
+            {
+                if (indices->empty())
+                {
+                    for (const auto i : osrm::irange(0u, number_of_coordinates))
+                    {
+                        indices->push_back(i);
+                    }
+                }
+            }
+            const auto is_out_of_range = [number_of_coordinates](const unsigned index)
+            {
+                return index >= number_of_coordinates;
+            };
+            if (std::any_of(source_indices.begin(), source_indices.end(), is_out_of_range) ||
+                std::any_of(destination_indices.begin(), destination_indices.end(),
+                            is_out_of_range))
+            {
+                return 400;
+            }
+            // rectangular tables may have as many entries as the largest square one
+            const auto max_entries = static_cast<std::size_t>(max_locations_distance_table) *
+                                     static_cast<std::size_t>(max_locations_distance_table);
+            if (source_indices.size() * destination_indices.size() > max_entries)
+            {
+                return 400;
+            }
+        }
+
+        // only snap coordinates that are actually part of the table
+        std::vector<bool> is_used(number_of_coordinates, false);
+        for (const auto index : source_indices)
+        {
+            is_used[index] = true;
+        }
+        for (const auto index : destination_indices)
+        {
+            is_used[index] = true;
+        }
+
+        PhantomNodeArray phantom_node_vector(number_of_coordinates);
+        for (const auto i : osrm::irange(0u, number_of_coordinates))
+        {
+            if (!is_used[i])
+            {
+                continue;
+            }
             if (checksum_OK && i < route_parameters.hints.size() &&
                 !route_parameters.hints[i].empty())
             {
@@ -100,9 +159,22 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
             BOOST_ASSERT(phantom_node_vector[i].front().is_valid(facade->GetNumberOfNodes()));
         }
 
+        PhantomNodeArray source_phantoms;
+        source_phantoms.reserve(source_indices.size());
+        for (const auto index : source_indices)
+        {
+            source_phantoms.push_back(phantom_node_vector[index]);
+        }
+        PhantomNodeArray destination_phantoms;
+        destination_phantoms.reserve(destination_indices.size());
+        for (const auto index : destination_indices)
+        {
+            destination_phantoms.push_back(phantom_node_vector[index]);
+        }
+
         // TIMER_START(distance_table);
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            search_engine_ptr->distance_table(phantom_node_vector);
+            search_engine_ptr->distance_table(source_phantoms, destination_phantoms);
         // TIMER_STOP(distance_table);
 
         if (!result_table)
@@ -111,12 +183,13 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
         }
 
         osrm::json::Array json_array;
-        const auto number_of_locations = phantom_node_vector.size();
-        for (const auto row : osrm::irange<std::size_t>(0, number_of_locations))
+        const auto number_of_sources = source_phantoms.size();
+        const auto number_of_destinations = destination_phantoms.size();
+        for (const auto row : osrm::irange<std::size_t>(0, number_of_sources))
         {
             osrm::json::Array json_row;
-            auto row_begin_iterator = result_table->begin() + (row * number_of_locations);
-            auto row_end_iterator = result_table->begin() + ((row + 1) * number_of_locations);
+            auto row_begin_iterator = result_table->begin() + (row * number_of_destinations);
+            auto row_end_iterator = result_table->begin() + ((row + 1) * number_of_destinations);
             json_row.values.insert(json_row.values.end(), row_begin_iterator, row_end_iterator);
             json_array.values.push_back(json_row);
         }
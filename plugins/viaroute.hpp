@@ -153,7 +153,10 @@ template <class DataFacadeT> class ViaRoutePlugin final : public BasePlugin
         };
         osrm::for_each_pair(phantom_node_pair_list, build_phantom_pairs);
 
-        if (route_parameters.alternate_route && 1 == raw_route.segment_end_coordinates.size())
+        // the alternative search needs a contracted graph, on the overlay of a multi-level
+        // partition only the shortest path is computed
+        if (route_parameters.alternate_route && 1 == raw_route.segment_end_coordinates.size() &&
+            !facade->HasMultiLevelPartition())
         {
             search_engine_ptr->alternative_path(raw_route.segment_end_coordinates.front(),
                                                 raw_route);
@@ -86,6 +86,45 @@ int main(int argc, char *argv[])
             return 1;
         }
 
+        if (!contractor_config.segment_speed_lookup_path.empty() &&
+            !boost::filesystem::is_regular_file(contractor_config.segment_speed_lookup_path))
+        {
+            SimpleLogger().Write(logWARNING)
+                << "Segment speed file " << contractor_config.segment_speed_lookup_path.string()
+                << " not found!";
+            return 1;
+        }
+
+        if (contractor_config.use_cached_priority &&
+            !boost::filesystem::is_regular_file(contractor_config.level_output_path))
+        {
+            SimpleLogger().Write(logWARNING) << "Level file " << contractor_config.level_output_path
+                                             << " not found!";
+            return 1;
+        }
+
+        if (contractor_config.core_factor < 0.0 || contractor_config.core_factor > 1.0)
+        {
+            SimpleLogger().Write(logWARNING) << "Core factor " << contractor_config.core_factor
+                                             << " is not in [0.0, 1.0]!";
+            return 1;
+        }
+
+        if (contractor_config.resume &&
+            !boost::filesystem::is_regular_file(contractor_config.checkpoint_output_path))
+        {
+            SimpleLogger().Write(logWARNING) << "Checkpoint "
+                                             << contractor_config.checkpoint_output_path
+                                             << " not found!";
+            return 1;
+        }
+
+        if (contractor_config.use_mld)
+        {
+            // the partition is built on top of the uncontracted graph
+            contractor_config.core_factor = 0.0;
+        }
+
         SimpleLogger().Write() << "Input file: " << contractor_config.osrm_input_path.filename().string();
         SimpleLogger().Write() << "Restrictions file: " << contractor_config.restrictions_path.filename().string();
         SimpleLogger().Write() << "Profile: " << contractor_config.profile_path.filename().string();
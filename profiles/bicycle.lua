@@ -92,6 +92,8 @@ surface_speeds = {
 
 traffic_signal_penalty          = 2
 use_turn_restrictions           = false
+-- way_function only looks at the tags, so its results can be cached by tags
+way_function_depends_only_on_tags = true
 
 local obey_oneway               = true
 local obey_bollards             = false
@@ -405,6 +407,8 @@ function way_function (way, result)
   limit( result, maxspeed, maxspeed_forward, maxspeed_backward )
 end
 
+-- osrm-prepare samples turn_function once over all angles, set
+-- precompute_turn_penalties = false if it depends on anything but the angle
 function turn_function (angle)
   -- compute turn penalty as angle^2, with a left/right bias
   k = turn_penalty/(90.0*90.0)
@@ -131,6 +131,8 @@ maxspeed_table = {
 
 traffic_signal_penalty          = 2
 use_turn_restrictions           = true
+-- way_function only looks at the tags, so its results can be cached by tags
+way_function_depends_only_on_tags = true
 
 local obey_oneway               = true
 local obey_bollards             = true
@@ -67,6 +67,8 @@ leisure_speeds = {
 traffic_signal_penalty   = 2
 u_turn_penalty       = 2
 use_turn_restrictions   = false
+-- way_function only looks at the tags, so its results can be cached by tags
+way_function_depends_only_on_tags = true
 
 --modes
 local mode_normal = 1
@@ -3,6 +3,8 @@
 
 require 'testbot'
 
+-- osrm-prepare samples turn_function once over all angles, set
+-- precompute_turn_penalties = false if it depends on anything but the angle
 function turn_function (angle)
     return 200*math.abs(angle)/180 -- penalty 
 end
@@ -71,7 +71,9 @@ int main(int argc, const char *argv[])
 
         bool trial_run = false;
         std::string ip_address;
-        int ip_port, requested_thread_num;
+        int ip_port, requested_thread_num, requested_io_thread_num, max_queued_requests;
+        int keepalive_timeout, keepalive_max_requests;
+        std::unordered_map<std::string, unsigned> service_limits;
 
         libosrm_config lib_config;
         // make the behaviour of routed backward compatible
@@ -79,7 +81,9 @@ int main(int argc, const char *argv[])
 
         const unsigned init_result = GenerateServerProgramOptions(
             argc, argv, lib_config.server_paths, ip_address, ip_port, requested_thread_num,
-            lib_config.use_shared_memory, trial_run, lib_config.max_locations_distance_table,
+            requested_io_thread_num, max_queued_requests, service_limits, keepalive_timeout,
+            keepalive_max_requests, lib_config.use_shared_memory,
+            lib_config.prefault_index, trial_run, lib_config.max_locations_distance_table,
             lib_config.max_locations_map_matching);
         if (init_result == INIT_OK_DO_NOT_START_ENGINE)
         {
@@ -105,8 +109,16 @@ int main(int argc, const char *argv[])
         }
 
         SimpleLogger().Write(logDEBUG) << "Threads:\t" << requested_thread_num;
+        SimpleLogger().Write(logDEBUG) << "I/O threads:\t" << requested_io_thread_num;
+        SimpleLogger().Write(logDEBUG) << "Queue size:\t" << max_queued_requests;
+        for (const auto &limit : service_limits)
+        {
+            SimpleLogger().Write(logDEBUG) << "Limit:\t\t" << limit.first << "=" << limit.second;
+        }
         SimpleLogger().Write(logDEBUG) << "IP address:\t" << ip_address;
         SimpleLogger().Write(logDEBUG) << "IP port:\t" << ip_port;
+        SimpleLogger().Write(logDEBUG) << "Keep-alive:\t" << keepalive_timeout << "s, "
+                                       << keepalive_max_requests << " requests";
 #ifndef _WIN32
         int sig = 0;
         sigset_t new_mask;
@@ -116,7 +128,9 @@ int main(int argc, const char *argv[])
 #endif
 
         OSRM osrm_lib(lib_config);
-        auto routing_server = Server::CreateServer(ip_address, ip_port, requested_thread_num);
+        auto routing_server = Server::CreateServer(
+            ip_address, ip_port, requested_thread_num, keepalive_timeout, keepalive_max_requests,
+            requested_io_thread_num, max_queued_requests, service_limits);
 
         routing_server->GetRequestHandlerPtr().RegisterRoutingMachine(&osrm_lib);
 
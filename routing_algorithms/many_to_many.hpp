@@ -31,12 +31,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "routing_base.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../typedefs.h"
+#include "../util/integer_range.hpp"
+#include "../util/iterator_range.hpp"
 
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <memory>
-#include <unordered_map>
+#include <tuple>
 #include <vector>
 
 template <class DataFacadeT>
@@ -49,14 +58,57 @@ class ManyToManyRouting final
 
     struct NodeBucket
     {
-        unsigned target_id; // essentially a row in the distance matrix
+        NodeID middle_node;
+        unsigned target_id; // essentially a column in the distance matrix
         EdgeWeight distance;
-        NodeBucket(const unsigned target_id, const EdgeWeight distance)
-            : target_id(target_id), distance(distance)
+        NodeBucket(const NodeID middle_node, const unsigned target_id, const EdgeWeight distance)
+            : middle_node(middle_node), target_id(target_id), distance(distance)
+        {
+        }
+
+        bool operator<(const NodeBucket &other) const
         {
+            return std::tie(middle_node, target_id) < std::tie(other.middle_node, other.target_id);
         }
     };
-    using SearchSpaceWithBuckets = std::unordered_map<NodeID, std::vector<NodeBucket>>;
+
+    // All backward search spaces in one flat array sorted by node. Every node that carries
+    // buckets is listed once in bucket_nodes, its buckets are
+    // [bucket_offsets[i], bucket_offsets[i+1]).
+    struct SearchSpaceWithBuckets
+    {
+        std::vector<NodeBucket> buckets;
+        std::vector<NodeID> bucket_nodes;
+        std::vector<unsigned> bucket_offsets;
+
+        void BuildIndex()
+        {
+            bucket_nodes.clear();
+            bucket_offsets.clear();
+            for (const auto i : osrm::irange<std::size_t>(0, buckets.size()))
+            {
+                if (bucket_nodes.empty() || bucket_nodes.back() != buckets[i].middle_node)
+                {
+                    bucket_nodes.push_back(buckets[i].middle_node);
+                    bucket_offsets.push_back(static_cast<unsigned>(i));
+                }
+            }
+            bucket_offsets.push_back(static_cast<unsigned>(buckets.size()));
+        }
+
+        osrm::iter_range<const NodeBucket *> GetBuckets(const NodeID node) const
+        {
+            const auto node_iter = std::lower_bound(bucket_nodes.begin(), bucket_nodes.end(), node);
+            if (node_iter == bucket_nodes.end() || *node_iter != node)
+            {
+                return osrm::iter_range<const NodeBucket *>(nullptr, nullptr);
+            }
+            const auto index = std::distance(bucket_nodes.begin(), node_iter);
+            return osrm::iter_range<const NodeBucket *>(buckets.data() + bucket_offsets[index],
+                                                   buckets.data() + bucket_offsets[index + 1]);
+        }
+    };
+    using BucketList = std::vector<NodeBucket>;
 
   public:
     ManyToManyRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
@@ -69,195 +121,167 @@ class ManyToManyRouting final
     std::shared_ptr<std::vector<EdgeWeight>>
     operator()(const PhantomNodeArray &phantom_nodes_array) const
     {
-        const auto number_of_locations = phantom_nodes_array.size();
+        return (*this)(phantom_nodes_array, phantom_nodes_array);
+    }
+
+    // Computes a |sources| x |targets| table in row-major order. Backward searches are only run
+    // from the targets and forward searches only from the sources. Both phases run in parallel,
+    // every worker uses the heaps of its own thread. Each entry is the minimum over all meeting
+    // nodes, so the result does not depend on the order in which searches finish.
+    std::shared_ptr<std::vector<EdgeWeight>>
+    operator()(const PhantomNodeArray &source_phantoms_array,
+               const PhantomNodeArray &target_phantoms_array) const
+    {
+        const auto number_of_sources = source_phantoms_array.size();
+        const auto number_of_targets = target_phantoms_array.size();
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            std::make_shared<std::vector<EdgeWeight>>(number_of_locations * number_of_locations,
+            std::make_shared<std::vector<EdgeWeight>>(number_of_sources * number_of_targets,
                                                       std::numeric_limits<EdgeWeight>::max());
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
 
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-
-        QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
-
-        SearchSpaceWithBuckets search_space_with_buckets;
-
-        unsigned target_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
-        {
-            query_heap.Clear();
-            // insert target(s) at distance 0
-
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+        // run backward searches from all targets, each thread collects its own buckets
+        tbb::enumerable_thread_specific<BucketList> thread_buckets;
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, number_of_targets),
+            [&](const tbb::blocked_range<std::size_t> &range)
             {
-                if (SPECIAL_NODEID != phantom_node.forward_node_id)
-                {
-                    query_heap.Insert(phantom_node.forward_node_id,
-                                      phantom_node.GetForwardWeightPlusOffset(),
-                                      phantom_node.forward_node_id);
-                }
-                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+                BucketList &bucket_list = thread_buckets.local();
+
+                for (auto target_id = range.begin(); target_id != range.end(); ++target_id)
                 {
-                    query_heap.Insert(phantom_node.reverse_node_id,
-                                      phantom_node.GetReverseWeightPlusOffset(),
-                                      phantom_node.reverse_node_id);
+                    query_heap.Clear();
+                    // insert target(s) at distance 0
+                    for (const PhantomNode &phantom_node : target_phantoms_array[target_id])
+                    {
+                        if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                        {
+                            query_heap.Insert(phantom_node.forward_node_id,
+                                              phantom_node.GetForwardWeightPlusOffset(),
+                                              phantom_node.forward_node_id);
+                        }
+                        if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                        {
+                            query_heap.Insert(phantom_node.reverse_node_id,
+                                              phantom_node.GetReverseWeightPlusOffset(),
+                                              phantom_node.reverse_node_id);
+                        }
+                    }
+
+                    // explore search space
+                    while (!query_heap.Empty())
+                    {
+                        BackwardRoutingStep(static_cast<unsigned>(target_id), query_heap,
+                                            bucket_list);
+                    }
                 }
-            }
+            });
 
-            // explore search space
-            while (!query_heap.Empty())
-            {
-                BackwardRoutingStep(target_id, query_heap, search_space_with_buckets);
-            }
-            ++target_id;
+        SearchSpaceWithBuckets search_space_with_buckets;
+        std::size_t number_of_buckets = 0;
+        for (const BucketList &bucket_list : thread_buckets)
+        {
+            number_of_buckets += bucket_list.size();
         }
-
-        // for each source do forward search
-        unsigned source_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
+        search_space_with_buckets.buckets.reserve(number_of_buckets);
+        for (const BucketList &bucket_list : thread_buckets)
         {
-            query_heap.Clear();
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+            search_space_with_buckets.buckets.insert(search_space_with_buckets.buckets.end(),
+                                                     bucket_list.begin(), bucket_list.end());
+        }
+        tbb::parallel_sort(search_space_with_buckets.buckets.begin(),
+                           search_space_with_buckets.buckets.end());
+        search_space_with_buckets.BuildIndex();
+
+        // run forward searches from all sources, every source only writes its own row
+        std::vector<EdgeWeight> &table = *result_table;
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, number_of_sources),
+            [&](const tbb::blocked_range<std::size_t> &range)
             {
-                // insert sources at distance 0
-                if (SPECIAL_NODEID != phantom_node.forward_node_id)
-                {
-                    query_heap.Insert(phantom_node.forward_node_id,
-                                      -phantom_node.GetForwardWeightPlusOffset(),
-                                      phantom_node.forward_node_id);
-                }
-                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+
+                for (auto source_id = range.begin(); source_id != range.end(); ++source_id)
                 {
-                    query_heap.Insert(phantom_node.reverse_node_id,
-                                      -phantom_node.GetReverseWeightPlusOffset(),
-                                      phantom_node.reverse_node_id);
-                }
-            }
+                    query_heap.Clear();
+                    for (const PhantomNode &phantom_node : source_phantoms_array[source_id])
+                    {
+                        // insert sources at distance 0
+                        if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                        {
+                            query_heap.Insert(phantom_node.forward_node_id,
+                                              -phantom_node.GetForwardWeightPlusOffset(),
+                                              phantom_node.forward_node_id);
+                        }
+                        if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                        {
+                            query_heap.Insert(phantom_node.reverse_node_id,
+                                              -phantom_node.GetReverseWeightPlusOffset(),
+                                              phantom_node.reverse_node_id);
+                        }
+                    }
 
-            // explore search space
-            while (!query_heap.Empty())
-            {
-                ForwardRoutingStep(source_id, number_of_locations, query_heap,
-                                   search_space_with_buckets, result_table);
-            }
+                    // explore search space
+                    while (!query_heap.Empty())
+                    {
+                        ForwardRoutingStep(static_cast<unsigned>(source_id),
+                                           static_cast<unsigned>(number_of_targets), query_heap,
+                                           search_space_with_buckets, table);
+                    }
+                }
+            });
 
-            ++source_id;
-        }
-        BOOST_ASSERT(source_id == target_id);
         return result_table;
     }
 
     void ForwardRoutingStep(const unsigned source_id,
-                            const unsigned number_of_locations,
+                            const unsigned number_of_targets,
                             QueryHeap &query_heap,
                             const SearchSpaceWithBuckets &search_space_with_buckets,
-                            std::shared_ptr<std::vector<EdgeWeight>> result_table) const
+                            std::vector<EdgeWeight> &result_table) const
     {
         const NodeID node = query_heap.DeleteMin();
         const int source_distance = query_heap.GetKey(node);
 
-        // check if each encountered node has an entry
-        const auto bucket_iterator = search_space_with_buckets.find(node);
-        // iterate bucket if there exists one
-        if (bucket_iterator != search_space_with_buckets.end())
+        // iterate the buckets of the encountered node, if there are any
+        for (const NodeBucket &current_bucket : search_space_with_buckets.GetBuckets(node))
         {
-            const std::vector<NodeBucket> &bucket_list = bucket_iterator->second;
-            for (const NodeBucket &current_bucket : bucket_list)
+            // get target id from bucket entry
+            const unsigned target_id = current_bucket.target_id;
+            const int target_distance = current_bucket.distance;
+            EdgeWeight &current_distance = result_table[source_id * number_of_targets + target_id];
+            // check if new distance is better
+            const EdgeWeight new_distance = source_distance + target_distance;
+            if (new_distance >= 0 && new_distance < current_distance)
             {
-                // get target id from bucket entry
-                const unsigned target_id = current_bucket.target_id;
-                const int target_distance = current_bucket.distance;
-                const EdgeWeight current_distance =
-                    (*result_table)[source_id * number_of_locations + target_id];
-                // check if new distance is better
-                const EdgeWeight new_distance = source_distance + target_distance;
-                if (new_distance >= 0 && new_distance < current_distance)
-                {
-                    (*result_table)[source_id * number_of_locations + target_id] =
-                        (source_distance + target_distance);
-                }
+                current_distance = new_distance;
             }
         }
-        if (StallAtNode<true>(node, source_distance, query_heap))
+        if (super::template StallAtNode<true>(node, source_distance, query_heap))
         {
             return;
         }
-        RelaxOutgoingEdges<true>(node, source_distance, query_heap);
+        super::template RelaxOutgoingEdges<true>(node, source_distance, query_heap);
     }
 
     void BackwardRoutingStep(const unsigned target_id,
                              QueryHeap &query_heap,
-                             SearchSpaceWithBuckets &search_space_with_buckets) const
+                             BucketList &bucket_list) const
     {
         const NodeID node = query_heap.DeleteMin();
         const int target_distance = query_heap.GetKey(node);
 
         // store settled nodes in search space bucket
-        search_space_with_buckets[node].emplace_back(target_id, target_distance);
+        bucket_list.emplace_back(node, target_id, target_distance);
 
-        if (StallAtNode<false>(node, target_distance, query_heap))
+        if (super::template StallAtNode<false>(node, target_distance, query_heap))
         {
             return;
         }
 
-        RelaxOutgoingEdges<false>(node, target_distance, query_heap);
-    }
-
-    template <bool forward_direction>
-    inline void
-    RelaxOutgoingEdges(const NodeID node, const EdgeWeight distance, QueryHeap &query_heap) const
-    {
-        for (auto edge : super::facade->GetAdjacentEdgeRange(node))
-        {
-            const auto &data = super::facade->GetEdgeData(edge);
-            const bool direction_flag = (forward_direction ? data.forward : data.backward);
-            if (direction_flag)
-            {
-                const NodeID to = super::facade->GetTarget(edge);
-                const int edge_weight = data.distance;
-
-                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
-                const int to_distance = distance + edge_weight;
-
-                // New Node discovered -> Add to Heap + Node Info Storage
-                if (!query_heap.WasInserted(to))
-                {
-                    query_heap.Insert(to, to_distance, node);
-                }
-                // Found a shorter Path -> Update distance
-                else if (to_distance < query_heap.GetKey(to))
-                {
-                    // new parent
-                    query_heap.GetData(to).parent = node;
-                    query_heap.DecreaseKey(to, to_distance);
-                }
-            }
-        }
-    }
-
-    // Stalling
-    template <bool forward_direction>
-    inline bool
-    StallAtNode(const NodeID node, const EdgeWeight distance, QueryHeap &query_heap) const
-    {
-        for (auto edge : super::facade->GetAdjacentEdgeRange(node))
-        {
-            const auto &data = super::facade->GetEdgeData(edge);
-            const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
-            if (reverse_flag)
-            {
-                const NodeID to = super::facade->GetTarget(edge);
-                const int edge_weight = data.distance;
-                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
-                if (query_heap.WasInserted(to))
-                {
-                    if (query_heap.GetKey(to) + edge_weight < distance)
-                    {
-                        return true;
-                    }
-                }
-            }
-        }
-        return false;
+        super::template RelaxOutgoingEdges<false>(node, target_distance, query_heap);
     }
 };
 #endif
@@ -39,7 +39,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
 #include <iomanip>
+#include <limits>
 #include <numeric>
+#include <tuple>
+#include <vector>
 
 namespace osrm
 {
@@ -78,6 +81,156 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
     using QueryHeap = SearchEngineData::QueryHeap;
     SearchEngineData &engine_working_data;
 
+    // settled node of the backward search from one candidate of the current timestamp
+    struct NodeBucket
+    {
+        NodeID node;
+        NodeID parent;
+        unsigned target_index;
+        EdgeWeight distance;
+        NodeBucket(const NodeID node,
+                   const NodeID parent,
+                   const unsigned target_index,
+                   const EdgeWeight distance)
+            : node(node), parent(parent), target_index(target_index), distance(distance)
+        {
+        }
+
+        bool operator<(const NodeBucket &other) const
+        {
+            return std::tie(node, target_index) < std::tie(other.node, other.target_index);
+        }
+    };
+    using BucketList = std::vector<NodeBucket>;
+
+    // Runs one backward search from every candidate and keeps all settled nodes, sorted by
+    // (node, candidate), in a single flat array.
+    void BuildBuckets(const osrm::matching::CandidateList &candidates,
+                      QueryHeap &query_heap,
+                      BucketList &buckets) const
+    {
+        buckets.clear();
+        for (const auto target_index : osrm::irange<unsigned>(0u, candidates.size()))
+        {
+            const PhantomNode &phantom_node = candidates[target_index].first;
+            query_heap.Clear();
+            if (SPECIAL_NODEID != phantom_node.forward_node_id)
+            {
+                query_heap.Insert(phantom_node.forward_node_id,
+                                  phantom_node.GetForwardWeightPlusOffset(),
+                                  phantom_node.forward_node_id);
+            }
+            if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            {
+                query_heap.Insert(phantom_node.reverse_node_id,
+                                  phantom_node.GetReverseWeightPlusOffset(),
+                                  phantom_node.reverse_node_id);
+            }
+
+            while (!query_heap.Empty())
+            {
+                const NodeID node = query_heap.DeleteMin();
+                const EdgeWeight distance = query_heap.GetKey(node);
+                buckets.emplace_back(node, query_heap.GetData(node).parent, target_index,
+                                     distance);
+
+                if (!super::template StallAtNode<false>(node, distance, query_heap))
+                {
+                    super::template RelaxOutgoingEdges<false>(node, distance, query_heap);
+                }
+            }
+        }
+        std::sort(buckets.begin(), buckets.end());
+    }
+
+    // Runs one forward search from source_phantom and records for every candidate the length
+    // of the shortest path and the node at which it meets the candidate's backward search.
+    void ForwardSearch(const PhantomNode &source_phantom,
+                       QueryHeap &query_heap,
+                       const BucketList &buckets,
+                       std::vector<EdgeWeight> &target_distances,
+                       std::vector<NodeID> &middle_nodes) const
+    {
+        std::fill(target_distances.begin(), target_distances.end(), INVALID_EDGE_WEIGHT);
+        std::fill(middle_nodes.begin(), middle_nodes.end(), SPECIAL_NODEID);
+
+        query_heap.Clear();
+        if (SPECIAL_NODEID != source_phantom.forward_node_id)
+        {
+            query_heap.Insert(source_phantom.forward_node_id,
+                              -source_phantom.GetForwardWeightPlusOffset(),
+                              source_phantom.forward_node_id);
+        }
+        if (SPECIAL_NODEID != source_phantom.reverse_node_id)
+        {
+            query_heap.Insert(source_phantom.reverse_node_id,
+                              -source_phantom.GetReverseWeightPlusOffset(),
+                              source_phantom.reverse_node_id);
+        }
+
+        while (!query_heap.Empty())
+        {
+            const NodeID node = query_heap.DeleteMin();
+            const EdgeWeight distance = query_heap.GetKey(node);
+
+            for (auto bucket_iter =
+                     std::lower_bound(buckets.begin(), buckets.end(),
+                                      NodeBucket(node, SPECIAL_NODEID, 0, INVALID_EDGE_WEIGHT));
+                 bucket_iter != buckets.end() && bucket_iter->node == node; ++bucket_iter)
+            {
+                const EdgeWeight new_distance = distance + bucket_iter->distance;
+                if (new_distance >= 0 && new_distance < target_distances[bucket_iter->target_index])
+                {
+                    target_distances[bucket_iter->target_index] = new_distance;
+                    middle_nodes[bucket_iter->target_index] = node;
+                }
+            }
+
+            if (!super::template StallAtNode<true>(node, distance, query_heap))
+            {
+                super::template RelaxOutgoingEdges<true>(node, distance, query_heap);
+            }
+        }
+    }
+
+    // Geometric length of the path found by the last forward search, the part from the middle
+    // node to the target is read from the parents stored in the buckets.
+    double GetNetworkDistance(const QueryHeap &forward_heap,
+                              const BucketList &buckets,
+                              const NodeID middle_node,
+                              const unsigned target_index,
+                              const PhantomNode &source_phantom,
+                              const PhantomNode &target_phantom) const
+    {
+        if (SPECIAL_NODEID == middle_node)
+        {
+            return std::numeric_limits<double>::max();
+        }
+
+        std::vector<NodeID> packed_leg;
+        super::RetrievePackedPathFromSingleHeap(forward_heap, middle_node, packed_leg);
+        std::reverse(packed_leg.begin(), packed_leg.end());
+        packed_leg.emplace_back(middle_node);
+
+        NodeID current_node = middle_node;
+        while (true)
+        {
+            const auto bucket_iter =
+                std::lower_bound(buckets.begin(), buckets.end(),
+                                 NodeBucket(current_node, SPECIAL_NODEID, target_index, 0));
+            BOOST_ASSERT(bucket_iter != buckets.end() && bucket_iter->node == current_node &&
+                         bucket_iter->target_index == target_index);
+            if (bucket_iter->parent == current_node)
+            {
+                break;
+            }
+            current_node = bucket_iter->parent;
+            packed_leg.emplace_back(current_node);
+        }
+
+        return super::get_path_length(packed_leg, source_phantom, target_phantom);
+    }
+
   public:
     MapMatching(DataFacadeT *facade, SearchEngineData &engine_working_data)
         : super(facade), engine_working_data(engine_working_data)
@@ -110,6 +263,12 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
         MatchingDebugInfo matching_debug(osrm::json::Logger::get());
         matching_debug.initialize(candidates_list);
 
+        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
+            super::facade->GetNumberOfNodes());
+        BucketList buckets;
+        std::vector<EdgeWeight> target_distances;
+        std::vector<NodeID> middle_nodes;
+
         std::size_t breakage_begin = osrm::matching::INVALID_STATE;
         std::vector<std::size_t> split_points;
         std::vector<std::size_t> prev_unbroken_timestamps;
@@ -177,14 +336,17 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
             const auto &current_timestamps_list = candidates_list[t];
             const auto &current_coordinate = trace_coordinates[t];
 
-            engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-                super::facade->GetNumberOfNodes());
-            engine_working_data.InitializeOrClearSecondThreadLocalStorage(
-                super::facade->GetNumberOfNodes());
-
             QueryHeap &forward_heap = *(engine_working_data.forward_heap_1);
             QueryHeap &reverse_heap = *(engine_working_data.reverse_heap_1);
 
+            // one backward search per candidate of this timestamp, shared by all transitions
+            BuildBuckets(current_timestamps_list, reverse_heap, buckets);
+            target_distances.resize(current_timestamps_list.size());
+            middle_nodes.resize(current_timestamps_list.size());
+
+            const auto great_circle_distance =
+                coordinate_calculation::great_circle_distance(prev_coordinate, current_coordinate);
+
             // compute d_t for this timestamp and the next one
             for (const auto s : osrm::irange<std::size_t>(0u, prev_viterbi.size()))
             {
@@ -193,6 +355,10 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                     continue;
                 }
 
+                // one forward search yields the distances to all candidates of this timestamp
+                ForwardSearch(prev_unbroken_timestamps_list[s].first, forward_heap, buckets,
+                              target_distances, middle_nodes);
+
                 for (const auto s_prime : osrm::irange<std::size_t>(0u, current_viterbi.size()))
                 {
                     // how likely is candidate s_prime at time t to be emitted?
@@ -204,16 +370,11 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                         continue;
                     }
 
-                    forward_heap.Clear();
-                    reverse_heap.Clear();
-
                     // get distance diff between loc1/2 and locs/s_prime
-                    const auto network_distance = super::get_network_distance(
-                        forward_heap, reverse_heap, prev_unbroken_timestamps_list[s].first,
+                    const auto network_distance = GetNetworkDistance(
+                        forward_heap, buckets, middle_nodes[s_prime], s_prime,
+                        prev_unbroken_timestamps_list[s].first,
                         current_timestamps_list[s_prime].first);
-                    const auto great_circle_distance =
-                        coordinate_calculation::great_circle_distance(prev_coordinate,
-                                                                      current_coordinate);
 
                     const auto d_t = std::abs(network_distance - great_circle_distance);
 
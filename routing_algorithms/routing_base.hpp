@@ -28,14 +28,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ROUTING_BASE_HPP
 #define ROUTING_BASE_HPP
 
+#include "../data_structures/cell_storage.hpp"
 #include "../data_structures/coordinate_calculation.hpp"
 #include "../data_structures/internal_route_result.hpp"
+#include "../data_structures/multi_level_partition.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../data_structures/turn_instructions.hpp"
+#include "../util/integer_range.hpp"
 // #include "../util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
 #include <stack>
 
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::forward_heap_1;
@@ -59,8 +63,10 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
     explicit BasicRoutingInterface(DataFacadeT *facade) : facade(facade) {}
     ~BasicRoutingInterface() {}
 
-    void RoutingStep(SearchEngineData::QueryHeap &forward_heap,
-                     SearchEngineData::QueryHeap &reverse_heap,
+    // the heap type is a parameter so that heap-bench can run the same step on other storages
+    template <class QueryHeapT>
+    void RoutingStep(QueryHeapT &forward_heap,
+                     QueryHeapT &reverse_heap,
                      NodeID *middle_node_id,
                      int *upper_bound,
                      const int min_edge_offset,
@@ -149,6 +155,428 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
         }
     }
 
+    // Plain Dijkstra step without stalling, the core is not contracted
+    void CoreRoutingStep(SearchEngineData::QueryHeap &forward_heap,
+                         SearchEngineData::QueryHeap &reverse_heap,
+                         NodeID *middle_node_id,
+                         int *upper_bound,
+                         const bool forward_direction) const
+    {
+        const NodeID node = forward_heap.DeleteMin();
+        const int distance = forward_heap.GetKey(node);
+
+        if (reverse_heap.WasInserted(node))
+        {
+            const int new_distance = reverse_heap.GetKey(node) + distance;
+            if (new_distance < *upper_bound && new_distance >= 0)
+            {
+                *middle_node_id = node;
+                *upper_bound = new_distance;
+            }
+        }
+
+        if (forward_direction)
+        {
+            RelaxOutgoingEdges<true>(node, distance, forward_heap);
+        }
+        else
+        {
+            RelaxOutgoingEdges<false>(node, distance, forward_heap);
+        }
+    }
+
+    // Search on a graph with an uncontracted core. The CH search settles core nodes without
+    // expanding them, they are the sources of a bidirectional Dijkstra search inside the core.
+    // Fills packed_leg if a path was found.
+    void SearchWithCore(SearchEngineData::QueryHeap &forward_heap,
+                        SearchEngineData::QueryHeap &reverse_heap,
+                        SearchEngineData::QueryHeap &forward_core_heap,
+                        SearchEngineData::QueryHeap &reverse_core_heap,
+                        NodeID *middle_node_id,
+                        int *upper_bound,
+                        const int min_edge_offset,
+                        std::vector<NodeID> &packed_leg) const
+    {
+        std::vector<std::pair<NodeID, int>> forward_entry_points;
+        std::vector<std::pair<NodeID, int>> reverse_entry_points;
+
+        while (0 < (forward_heap.Size() + reverse_heap.Size()))
+        {
+            if (!forward_heap.Empty())
+            {
+                if (facade->IsCoreNode(forward_heap.Min()))
+                {
+                    const NodeID node = forward_heap.DeleteMin();
+                    forward_entry_points.emplace_back(node, forward_heap.GetKey(node));
+                }
+                else
+                {
+                    RoutingStep(forward_heap, reverse_heap, middle_node_id, upper_bound,
+                                min_edge_offset, true);
+                }
+            }
+            if (!reverse_heap.Empty())
+            {
+                if (facade->IsCoreNode(reverse_heap.Min()))
+                {
+                    const NodeID node = reverse_heap.DeleteMin();
+                    reverse_entry_points.emplace_back(node, reverse_heap.GetKey(node));
+                }
+                else
+                {
+                    RoutingStep(reverse_heap, forward_heap, middle_node_id, upper_bound,
+                                min_edge_offset, false);
+                }
+            }
+        }
+
+        forward_core_heap.Clear();
+        reverse_core_heap.Clear();
+        // entry points are their own parents, the path below them is in the CH heaps
+        for (const auto &entry_point : forward_entry_points)
+        {
+            forward_core_heap.Insert(entry_point.first, entry_point.second, entry_point.first);
+        }
+        for (const auto &entry_point : reverse_entry_points)
+        {
+            reverse_core_heap.Insert(entry_point.first, entry_point.second, entry_point.first);
+        }
+
+        // stop once no path through the core can beat the best one found so far
+        NodeID core_middle_node_id = SPECIAL_NODEID;
+        while (0 < forward_core_heap.Size() && 0 < reverse_core_heap.Size() &&
+               forward_core_heap.GetKey(forward_core_heap.Min()) +
+                       reverse_core_heap.GetKey(reverse_core_heap.Min()) <
+                   *upper_bound)
+        {
+            CoreRoutingStep(forward_core_heap, reverse_core_heap, &core_middle_node_id,
+                            upper_bound, true);
+            CoreRoutingStep(reverse_core_heap, forward_core_heap, &core_middle_node_id,
+                            upper_bound, false);
+        }
+
+        if (SPECIAL_NODEID != core_middle_node_id)
+        {
+            *middle_node_id = core_middle_node_id;
+
+            std::vector<NodeID> packed_core_leg;
+            RetrievePackedPathFromHeap(forward_core_heap, reverse_core_heap, core_middle_node_id,
+                                       packed_core_leg);
+            RetrievePackedPathFromSingleHeap(forward_heap, packed_core_leg.front(), packed_leg);
+            std::reverse(packed_leg.begin(), packed_leg.end());
+            packed_leg.insert(packed_leg.end(), packed_core_leg.begin(), packed_core_leg.end());
+            RetrievePackedPathFromSingleHeap(reverse_heap, packed_core_leg.back(), packed_leg);
+        }
+        else if (SPECIAL_NODEID != *middle_node_id)
+        {
+            RetrievePackedPathFromHeap(forward_heap, reverse_heap, *middle_node_id, packed_leg);
+        }
+    }
+
+    // Search on the overlay of a multi-level partition. A node is settled on the highest level
+    // whose cell contains none of the end points, there the search only uses the clique of the cell
+    // and the edges leaving it. Fills packed_leg with a path of the graph itself if one was found.
+    void SearchWithMultiLevelPartition(SearchEngineData::QueryHeap &forward_heap,
+                                       SearchEngineData::QueryHeap &reverse_heap,
+                                       SearchEngineData::QueryHeap &unpack_heap,
+                                       const PhantomNodes &phantom_nodes,
+                                       NodeID *middle_node_id,
+                                       int *upper_bound,
+                                       std::vector<NodeID> &packed_leg) const
+    {
+        const std::vector<NodeID> end_points = {
+            phantom_nodes.source_phantom.forward_node_id,
+            phantom_nodes.source_phantom.reverse_node_id,
+            phantom_nodes.target_phantom.forward_node_id,
+            phantom_nodes.target_phantom.reverse_node_id};
+
+        while (0 < forward_heap.Size() && 0 < reverse_heap.Size() &&
+               forward_heap.GetKey(forward_heap.Min()) + reverse_heap.GetKey(reverse_heap.Min()) <
+                   *upper_bound)
+        {
+            MultiLevelRoutingStep<true>(forward_heap, reverse_heap, end_points, middle_node_id,
+                                        upper_bound);
+            MultiLevelRoutingStep<false>(reverse_heap, forward_heap, end_points, middle_node_id,
+                                         upper_bound);
+        }
+
+        if (SPECIAL_NODEID == *middle_node_id || INVALID_EDGE_WEIGHT == *upper_bound)
+        {
+            return;
+        }
+
+        std::vector<NodeID> overlay_path;
+        RetrievePackedPathFromHeap(forward_heap, reverse_heap, *middle_node_id, overlay_path);
+
+        const auto &partition = facade->GetMultiLevelPartition();
+        packed_leg.push_back(overlay_path.front());
+        for (const auto i : osrm::irange<std::size_t>(1, overlay_path.size()))
+        {
+            const NodeID from = overlay_path[i - 1];
+            const NodeID to = overlay_path[i];
+            // the edges between cells of a level are edges of the graph, cliques stay inside
+            const auto level = std::min(GetQueryLevel(end_points, from),
+                                        GetQueryLevel(end_points, to));
+            if (level > 0 && partition.GetCell(level, from) == partition.GetCell(level, to))
+            {
+                UnpackCliqueEdge(unpack_heap, level, from, to, packed_leg);
+            }
+            else
+            {
+                packed_leg.push_back(to);
+            }
+        }
+    }
+
+    // highest level on which the cell of node contains none of the end points
+    MultiLevelPartition::LevelID GetQueryLevel(const std::vector<NodeID> &end_points,
+                                               const NodeID node) const
+    {
+        const auto &partition = facade->GetMultiLevelPartition();
+        MultiLevelPartition::LevelID level = partition.GetNumberOfLevels();
+        for (const NodeID end_point : end_points)
+        {
+            if (SPECIAL_NODEID != end_point)
+            {
+                level = std::min(level, partition.GetHighestDifferentLevel(end_point, node));
+            }
+        }
+        return level;
+    }
+
+    template <bool forward_direction>
+    void MultiLevelRoutingStep(SearchEngineData::QueryHeap &forward_heap,
+                               SearchEngineData::QueryHeap &reverse_heap,
+                               const std::vector<NodeID> &end_points,
+                               NodeID *middle_node_id,
+                               int *upper_bound) const
+    {
+        const NodeID node = forward_heap.DeleteMin();
+        const int distance = forward_heap.GetKey(node);
+
+        if (reverse_heap.WasInserted(node))
+        {
+            const int new_distance = reverse_heap.GetKey(node) + distance;
+            if (new_distance < *upper_bound && new_distance >= 0)
+            {
+                *middle_node_id = node;
+                *upper_bound = new_distance;
+            }
+        }
+
+        const auto level = GetQueryLevel(end_points, node);
+        if (0 == level)
+        {
+            RelaxOutgoingEdges<forward_direction>(node, distance, forward_heap);
+            return;
+        }
+
+        const auto &partition = facade->GetMultiLevelPartition();
+        const auto cell_id = partition.GetCell(level, node);
+        const auto cell = facade->GetCellStorage().GetCell(level, cell_id);
+        if (forward_direction)
+        {
+            const unsigned source_index = cell.GetSourceIndex(node);
+            if (source_index < cell.GetNumberOfSources())
+            {
+                for (const auto destination_index :
+                     osrm::irange(0u, cell.GetNumberOfDestinations()))
+                {
+                    const EdgeWeight weight = cell.GetWeight(source_index, destination_index);
+                    if (INVALID_EDGE_WEIGHT != weight)
+                    {
+                        RelaxOverlayEdge(forward_heap, node, cell.GetDestination(destination_index),
+                                         distance + weight);
+                    }
+                }
+            }
+        }
+        else
+        {
+            const unsigned destination_index = cell.GetDestinationIndex(node);
+            if (destination_index < cell.GetNumberOfDestinations())
+            {
+                for (const auto source_index : osrm::irange(0u, cell.GetNumberOfSources()))
+                {
+                    const EdgeWeight weight = cell.GetWeight(source_index, destination_index);
+                    if (INVALID_EDGE_WEIGHT != weight)
+                    {
+                        RelaxOverlayEdge(forward_heap, node, cell.GetSource(source_index),
+                                         distance + weight);
+                    }
+                }
+            }
+        }
+
+        // leave the cell through the edges of the graph
+        for (const auto edge : facade->GetAdjacentEdgeRange(node))
+        {
+            const auto &data = facade->GetEdgeData(edge);
+            const bool direction_flag = (forward_direction ? data.forward : data.backward);
+            const NodeID to = facade->GetTarget(edge);
+            if (direction_flag && partition.GetCell(level, to) != cell_id)
+            {
+                RelaxOverlayEdge(forward_heap, node, to, distance + data.distance);
+            }
+        }
+    }
+
+    void RelaxOverlayEdge(SearchEngineData::QueryHeap &query_heap,
+                          const NodeID node,
+                          const NodeID to,
+                          const int to_distance) const
+    {
+        if (!query_heap.WasInserted(to))
+        {
+            query_heap.Insert(to, to_distance, node);
+        }
+        else if (to_distance < query_heap.GetKey(to))
+        {
+            query_heap.GetData(to).parent = node;
+            query_heap.DecreaseKey(to, to_distance);
+        }
+    }
+
+    // Replaces the clique edge (from, to) of a cell on level by the path of the graph it stands
+    // for, appends the path without from. Searches the overlay of the subcells and recurses.
+    void UnpackCliqueEdge(SearchEngineData::QueryHeap &unpack_heap,
+                          const MultiLevelPartition::LevelID level,
+                          const NodeID from,
+                          const NodeID to,
+                          std::vector<NodeID> &unpacked_path) const
+    {
+        const auto &partition = facade->GetMultiLevelPartition();
+        const auto &cell_storage = facade->GetCellStorage();
+        const auto cell_id = partition.GetCell(level, from);
+        const auto sublevel = level - 1;
+
+        unpack_heap.Clear();
+        unpack_heap.Insert(from, 0, from);
+        while (!unpack_heap.Empty())
+        {
+            const NodeID node = unpack_heap.DeleteMin();
+            const int distance = unpack_heap.GetKey(node);
+            if (node == to)
+            {
+                break;
+            }
+
+            if (sublevel > 0)
+            {
+                const auto subcell =
+                    cell_storage.GetCell(sublevel, partition.GetCell(sublevel, node));
+                const unsigned source_index = subcell.GetSourceIndex(node);
+                if (source_index < subcell.GetNumberOfSources())
+                {
+                    for (const auto destination_index :
+                         osrm::irange(0u, subcell.GetNumberOfDestinations()))
+                    {
+                        const EdgeWeight weight =
+                            subcell.GetWeight(source_index, destination_index);
+                        if (INVALID_EDGE_WEIGHT != weight)
+                        {
+                            RelaxOverlayEdge(unpack_heap, node,
+                                             subcell.GetDestination(destination_index),
+                                             distance + weight);
+                        }
+                    }
+                }
+            }
+
+            for (const auto edge : facade->GetAdjacentEdgeRange(node))
+            {
+                const auto &data = facade->GetEdgeData(edge);
+                const NodeID target = facade->GetTarget(edge);
+                if (data.forward && partition.GetCell(level, target) == cell_id &&
+                    (0 == sublevel ||
+                     partition.GetCell(sublevel, target) != partition.GetCell(sublevel, node)))
+                {
+                    RelaxOverlayEdge(unpack_heap, node, target, distance + data.distance);
+                }
+            }
+        }
+        BOOST_ASSERT_MSG(unpack_heap.WasInserted(to), "clique edge without path in its cell");
+
+        std::vector<NodeID> subpath;
+        RetrievePackedPathFromSingleHeap(unpack_heap, to, subpath);
+        std::reverse(subpath.begin(), subpath.end());
+        subpath.push_back(to);
+
+        // the heap is reused by the recursion, the path has been copied out of it
+        for (const auto i : osrm::irange<std::size_t>(1, subpath.size()))
+        {
+            if (sublevel > 0 && partition.GetCell(sublevel, subpath[i - 1]) ==
+                                    partition.GetCell(sublevel, subpath[i]))
+            {
+                UnpackCliqueEdge(unpack_heap, sublevel, subpath[i - 1], subpath[i], unpacked_path);
+            }
+            else
+            {
+                unpacked_path.push_back(subpath[i]);
+            }
+        }
+    }
+
+    template <bool forward_direction>
+    inline void RelaxOutgoingEdges(const NodeID node,
+                                   const EdgeWeight distance,
+                                   SearchEngineData::QueryHeap &query_heap) const
+    {
+        for (auto edge : facade->GetAdjacentEdgeRange(node))
+        {
+            const auto &data = facade->GetEdgeData(edge);
+            const bool direction_flag = (forward_direction ? data.forward : data.backward);
+            if (direction_flag)
+            {
+                const NodeID to = facade->GetTarget(edge);
+                const int edge_weight = data.distance;
+
+                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+                const int to_distance = distance + edge_weight;
+
+                // New Node discovered -> Add to Heap + Node Info Storage
+                if (!query_heap.WasInserted(to))
+                {
+                    query_heap.Insert(to, to_distance, node);
+                }
+                // Found a shorter Path -> Update distance
+                else if (to_distance < query_heap.GetKey(to))
+                {
+                    // new parent
+                    query_heap.GetData(to).parent = node;
+                    query_heap.DecreaseKey(to, to_distance);
+                }
+            }
+        }
+    }
+
+    // Stalling, true if node can be reached by a shorter path through an already inserted node
+    template <bool forward_direction>
+    inline bool StallAtNode(const NodeID node,
+                            const EdgeWeight distance,
+                            SearchEngineData::QueryHeap &query_heap) const
+    {
+        for (auto edge : facade->GetAdjacentEdgeRange(node))
+        {
+            const auto &data = facade->GetEdgeData(edge);
+            const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
+            if (reverse_flag)
+            {
+                const NodeID to = facade->GetTarget(edge);
+                const int edge_weight = data.distance;
+                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+                if (query_heap.WasInserted(to))
+                {
+                    if (query_heap.GetKey(to) + edge_weight < distance)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
     void UnpackPath(const std::vector<NodeID> &packed_path,
                     const PhantomNodes &phantom_node_pair,
                     std::vector<PathData> &unpacked_path) const
@@ -468,25 +896,34 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
         {
             std::vector<NodeID> packed_leg;
             RetrievePackedPathFromHeap(forward_heap, reverse_heap, middle_node, packed_leg);
-            std::vector<PathData> unpacked_path;
-            PhantomNodes nodes;
-            nodes.source_phantom = source_phantom;
-            nodes.target_phantom = target_phantom;
-            UnpackPath(packed_leg, nodes, unpacked_path);
-
-            FixedPointCoordinate previous_coordinate = source_phantom.location;
-            FixedPointCoordinate current_coordinate;
-            distance = 0;
-            for (const auto &p : unpacked_path)
-            {
-                current_coordinate = facade->GetCoordinateOfNode(p.node);
-                distance += coordinate_calculation::great_circle_distance(previous_coordinate,
-                                                                          current_coordinate);
-                previous_coordinate = current_coordinate;
-            }
+            distance = get_path_length(packed_leg, source_phantom, target_phantom);
+        }
+        return distance;
+    }
+
+    // geometric length of the unpacked path between two phantom nodes
+    double get_path_length(const std::vector<NodeID> &packed_leg,
+                           const PhantomNode &source_phantom,
+                           const PhantomNode &target_phantom) const
+    {
+        std::vector<PathData> unpacked_path;
+        PhantomNodes nodes;
+        nodes.source_phantom = source_phantom;
+        nodes.target_phantom = target_phantom;
+        UnpackPath(packed_leg, nodes, unpacked_path);
+
+        FixedPointCoordinate previous_coordinate = source_phantom.location;
+        FixedPointCoordinate current_coordinate;
+        double distance = 0;
+        for (const auto &p : unpacked_path)
+        {
+            current_coordinate = facade->GetCoordinateOfNode(p.node);
             distance += coordinate_calculation::great_circle_distance(previous_coordinate,
-                                                                      target_phantom.location);
+                                                                      current_coordinate);
+            previous_coordinate = current_coordinate;
         }
+        distance += coordinate_calculation::great_circle_distance(previous_coordinate,
+                                                                  target_phantom.location);
         return distance;
     }
 };
@@ -75,6 +75,9 @@ class ShortestPathRouting final
         QueryHeap &reverse_heap1 = *(engine_working_data.reverse_heap_1);
         QueryHeap &forward_heap2 = *(engine_working_data.forward_heap_2);
         QueryHeap &reverse_heap2 = *(engine_working_data.reverse_heap_2);
+        // used by the search inside an uncontracted core and to unpack multi-level paths only
+        QueryHeap &forward_core_heap = *(engine_working_data.forward_heap_3);
+        QueryHeap &reverse_core_heap = *(engine_working_data.reverse_heap_3);
 
         std::size_t current_leg = 0;
         // Get distance to next pair of target nodes.
@@ -149,36 +152,80 @@ class ShortestPathRouting final
                 // phantom_node_pair.target_phantom.reverse_node_id << ", w: " << phantom_node_pair.target_phantom.GetReverseWeightPlusOffset();
             }
 
-            // run two-Target Dijkstra routing step.
-            while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
+            std::vector<NodeID> temporary_packed_leg1;
+            std::vector<NodeID> temporary_packed_leg2;
+
+            if (super::facade->HasMultiLevelPartition())
             {
-                if (!forward_heap1.Empty())
+                super::SearchWithMultiLevelPartition(forward_heap1, reverse_heap1,
+                                                     forward_core_heap, phantom_node_pair,
+                                                     &middle1, &local_upper_bound1,
+                                                     temporary_packed_leg1);
+                if (!reverse_heap2.Empty())
                 {
-                    super::RoutingStep(forward_heap1, reverse_heap1, &middle1, &local_upper_bound1,
-                                       min_edge_offset, true);
+                    super::SearchWithMultiLevelPartition(forward_heap2, reverse_heap2,
+                                                         forward_core_heap, phantom_node_pair,
+                                                         &middle2, &local_upper_bound2,
+                                                         temporary_packed_leg2);
                 }
-                if (!reverse_heap1.Empty())
+            }
+            else if (super::facade->HasCoreNodes())
+            {
+                super::SearchWithCore(forward_heap1, reverse_heap1, forward_core_heap,
+                                      reverse_core_heap, &middle1, &local_upper_bound1,
+                                      min_edge_offset, temporary_packed_leg1);
+                if (!reverse_heap2.Empty())
                 {
-                    super::RoutingStep(reverse_heap1, forward_heap1, &middle1, &local_upper_bound1,
-                                       min_edge_offset, false);
+                    super::SearchWithCore(forward_heap2, reverse_heap2, forward_core_heap,
+                                          reverse_core_heap, &middle2, &local_upper_bound2,
+                                          min_edge_offset, temporary_packed_leg2);
                 }
             }
-
-            if (!reverse_heap2.Empty())
+            else
             {
-                while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
+                // run two-Target Dijkstra routing step.
+                while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
                 {
-                    if (!forward_heap2.Empty())
+                    if (!forward_heap1.Empty())
                     {
-                        super::RoutingStep(forward_heap2, reverse_heap2, &middle2,
-                                           &local_upper_bound2, min_edge_offset, true);
+                        super::RoutingStep(forward_heap1, reverse_heap1, &middle1,
+                                           &local_upper_bound1, min_edge_offset, true);
                     }
-                    if (!reverse_heap2.Empty())
+                    if (!reverse_heap1.Empty())
                     {
-                        super::RoutingStep(reverse_heap2, forward_heap2, &middle2,
-                                           &local_upper_bound2, min_edge_offset, false);
+                        super::RoutingStep(reverse_heap1, forward_heap1, &middle1,
+                                           &local_upper_bound1, min_edge_offset, false);
                     }
                 }
+
+                if (!reverse_heap2.Empty())
+                {
+                    while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
+                    {
+                        if (!forward_heap2.Empty())
+                        {
+                            super::RoutingStep(forward_heap2, reverse_heap2, &middle2,
+                                               &local_upper_bound2, min_edge_offset, true);
+                        }
+                        if (!reverse_heap2.Empty())
+                        {
+                            super::RoutingStep(reverse_heap2, forward_heap2, &middle2,
+                                               &local_upper_bound2, min_edge_offset, false);
+                        }
+                    }
+                }
+
+                if (INVALID_EDGE_WEIGHT != local_upper_bound1)
+                {
+                    super::RetrievePackedPathFromHeap(forward_heap1, reverse_heap1, middle1,
+                                                      temporary_packed_leg1);
+                }
+
+                if (INVALID_EDGE_WEIGHT != local_upper_bound2)
+                {
+                    super::RetrievePackedPathFromHeap(forward_heap2, reverse_heap2, middle2,
+                                                      temporary_packed_leg2);
+                }
             }
 
             // No path found for both target nodes?
@@ -205,25 +252,9 @@ class ShortestPathRouting final
             BOOST_ASSERT_MSG((INVALID_EDGE_WEIGHT != distance1 || INVALID_EDGE_WEIGHT != distance2),
                              "no path found");
 
-            // Unpack paths if they exist
-            std::vector<NodeID> temporary_packed_leg1;
-            std::vector<NodeID> temporary_packed_leg2;
-
             BOOST_ASSERT(current_leg < packed_legs1.size());
             BOOST_ASSERT(current_leg < packed_legs2.size());
 
-            if (INVALID_EDGE_WEIGHT != local_upper_bound1)
-            {
-                super::RetrievePackedPathFromHeap(forward_heap1, reverse_heap1, middle1,
-                                                  temporary_packed_leg1);
-            }
-
-            if (INVALID_EDGE_WEIGHT != local_upper_bound2)
-            {
-                super::RetrievePackedPathFromHeap(forward_heap2, reverse_heap2, middle2,
-                                                  temporary_packed_leg2);
-            }
-
             // if one of the paths was not found, replace it with the other one.
             if ((allow_u_turn && local_upper_bound1 > local_upper_bound2) ||
                 temporary_packed_leg1.empty())
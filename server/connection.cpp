@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "connection.hpp"
 #include "request_handler.hpp"
 #include "request_parser.hpp"
+#include "worker_pool.hpp"
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
@@ -40,16 +41,48 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace http
 {
 
-Connection::Connection(boost::asio::io_service &io_service, RequestHandler &handler)
-    : strand(io_service), TCP_socket(io_service), request_handler(handler)
+namespace
+{
+// name of the requested service, i.e. "viaroute" for "/viaroute?loc=..."
+std::string get_service(const std::string &uri)
+{
+    const auto begin = uri.find_first_not_of('/');
+    if (std::string::npos == begin)
+    {
+        return "";
+    }
+    const auto end = uri.find_first_of("?/", begin);
+    return uri.substr(begin, std::string::npos == end ? std::string::npos : end - begin);
+}
+}
+
+Connection::Connection(boost::asio::io_service &io_service,
+                       RequestHandler &handler,
+                       WorkerPool &worker_pool,
+                       const unsigned keepalive_timeout,
+                       const unsigned keepalive_max_requests)
+    : strand(io_service), TCP_socket(io_service), timer(io_service), request_handler(handler),
+      worker_pool(worker_pool), keepalive_timeout(keepalive_timeout),
+      keepalive_max_requests(keepalive_max_requests), processed_requests(0), keep_alive(false),
+      pending_begin(nullptr), pending_end(nullptr)
 {
 }
 
 boost::asio::ip::tcp::socket &Connection::socket() { return TCP_socket; }
 
 /// Start the first asynchronous operation for the connection.
-void Connection::start()
+void Connection::start() { start_read(); }
+
+void Connection::start_read()
 {
+    if (keepalive_timeout > 0)
+    {
+        timer.expires_from_now(boost::posix_time::seconds(keepalive_timeout));
+        timer.async_wait(strand.wrap(boost::bind(&Connection::handle_timeout,
+                                                 this->shared_from_this(),
+                                                 boost::asio::placeholders::error)));
+    }
+
     TCP_socket.async_read_some(
         boost::asio::buffer(incoming_data_buffer),
         strand.wrap(boost::bind(&Connection::handle_read, this->shared_from_this(),
@@ -61,88 +94,154 @@ void Connection::handle_read(const boost::system::error_code &error, std::size_t
 {
     if (error)
     {
+        // the pending wait holds a reference to this connection until it expires
+        timer.cancel();
         return;
     }
 
+    // disarm the idle timer while the request is being processed
+    timer.expires_at(boost::posix_time::pos_infin);
+
+    process_input(incoming_data_buffer.data(), incoming_data_buffer.data() + bytes_transferred);
+}
+
+void Connection::process_input(char *begin, char *end)
+{
     // no error detected, let's parse the request
     compression_type compression_type(no_compression);
     osrm::tribool result;
-    std::tie(result, compression_type) =
-        request_parser.parse(current_request, incoming_data_buffer.data(),
-                             incoming_data_buffer.data() + bytes_transferred);
+    std::tie(result, compression_type, pending_begin) =
+        request_parser.parse(current_request, begin, end);
+    pending_end = end;
 
     // the request has been parsed
     if (result == osrm::tribool::yes)
     {
+        ++processed_requests;
+        keep_alive = current_request.keep_alive && keepalive_timeout > 0 &&
+                     processed_requests < keepalive_max_requests;
+
         current_request.endpoint = TCP_socket.remote_endpoint().address();
-        request_handler.handle_request(current_request, current_reply);
 
-        // Header compression_header;
-        std::vector<char> compressed_output;
-        std::vector<boost::asio::const_buffer> output_buffer;
+        // route on the worker pool, the reply is written from the strand again
+        auto self = this->shared_from_this();
+        const bool accepted = worker_pool.TryPost(
+            get_service(current_request.uri), [self, compression_type]()
+            {
+                self->request_handler.handle_request(self->current_request, self->current_reply);
+                self->prepare_reply(compression_type);
+                self->strand.post(boost::bind(&Connection::write_reply, self));
+            });
 
-        // compress the result w/ gzip/deflate if requested
-        switch (compression_type)
+        if (!accepted)
         {
-        case deflate_rfc1951:
-            // use deflate for compression
-            current_reply.headers.insert(current_reply.headers.begin(),
-                                         {"Content-Encoding", "deflate"});
-            compressed_output = compress_buffers(current_reply.content, compression_type);
-            current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
-            output_buffer = current_reply.headers_to_buffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case gzip_rfc1952:
-            // use gzip for compression
-            current_reply.headers.insert(current_reply.headers.begin(),
-                                         {"Content-Encoding", "gzip"});
-            compressed_output = compress_buffers(current_reply.content, compression_type);
-            current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
-            output_buffer = current_reply.headers_to_buffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case no_compression:
-            // don't use any compression
-            current_reply.set_uncompressed_size();
-            output_buffer = current_reply.to_buffers();
-            break;
+            // shed load instead of queueing up more work
+            current_reply = reply::stock_reply(reply::service_unavailable);
+            current_reply.headers.emplace_back("Retry-After", "1");
+            prepare_reply(no_compression);
+            write_reply();
         }
-        // write result to stream
-        boost::asio::async_write(
-            TCP_socket, output_buffer,
-            strand.wrap(boost::bind(&Connection::handle_write, this->shared_from_this(),
-                                    boost::asio::placeholders::error)));
     }
     else if (result == osrm::tribool::no)
     { // request is not parseable
+        keep_alive = false;
         current_reply = reply::stock_reply(reply::bad_request);
-
-        boost::asio::async_write(
-            TCP_socket, current_reply.to_buffers(),
-            strand.wrap(boost::bind(&Connection::handle_write, this->shared_from_this(),
-                                    boost::asio::placeholders::error)));
+        prepare_reply(no_compression);
+        write_reply();
     }
     else
     {
         // we don't have a result yet, so continue reading
-        TCP_socket.async_read_some(
-            boost::asio::buffer(incoming_data_buffer),
-            strand.wrap(boost::bind(&Connection::handle_read, this->shared_from_this(),
-                                    boost::asio::placeholders::error,
-                                    boost::asio::placeholders::bytes_transferred)));
+        start_read();
+    }
+}
+
+void Connection::prepare_reply(const compression_type compression_type)
+{
+    current_reply.headers.emplace_back("Connection", keep_alive ? "keep-alive" : "close");
+
+    // compress the result w/ gzip/deflate if requested
+    switch (compression_type)
+    {
+    case deflate_rfc1951:
+        // use deflate for compression
+        current_reply.headers.insert(current_reply.headers.begin(),
+                                     {"Content-Encoding", "deflate"});
+        compressed_output = compress_buffers(current_reply.content, compression_type);
+        current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
+        output_buffer = current_reply.headers_to_buffers();
+        output_buffer.push_back(boost::asio::buffer(compressed_output));
+        break;
+    case gzip_rfc1952:
+        // use gzip for compression
+        current_reply.headers.insert(current_reply.headers.begin(), {"Content-Encoding", "gzip"});
+        compressed_output = compress_buffers(current_reply.content, compression_type);
+        current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
+        output_buffer = current_reply.headers_to_buffers();
+        output_buffer.push_back(boost::asio::buffer(compressed_output));
+        break;
+    case no_compression:
+        // don't use any compression
+        current_reply.set_uncompressed_size();
+        output_buffer = current_reply.to_buffers();
+        break;
     }
 }
 
+void Connection::write_reply()
+{
+    boost::asio::async_write(
+        TCP_socket, output_buffer,
+        strand.wrap(boost::bind(&Connection::handle_write, this->shared_from_this(),
+                                boost::asio::placeholders::error)));
+}
+
 /// Handle completion of a write operation.
 void Connection::handle_write(const boost::system::error_code &error)
 {
-    if (!error)
+    if (error)
+    {
+        return;
+    }
+
+    if (!keep_alive)
     {
         // Initiate graceful connection closure.
         boost::system::error_code ignore_error;
         TCP_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore_error);
+        return;
     }
+
+    // get ready for the next request on this connection
+    request_parser = RequestParser();
+    current_request = request();
+    current_reply = reply();
+    compressed_output.clear();
+    output_buffer.clear();
+
+    // a pipelined request may have arrived with the previous one
+    if (pending_begin != pending_end)
+    {
+        process_input(pending_begin, pending_end);
+    }
+    else
+    {
+        start_read();
+    }
+}
+
+void Connection::handle_timeout(const boost::system::error_code &error)
+{
+    // the timer was cancelled or re-armed in the meantime
+    if (error == boost::asio::error::operation_aborted ||
+        timer.expires_at() > boost::asio::deadline_timer::traits_type::now())
+    {
+        return;
+    }
+
+    boost::system::error_code ignore_error;
+    TCP_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore_error);
+    TCP_socket.close(ignore_error);
 }
 
 std::vector<char> Connection::compress_buffers(const std::vector<char> &uncompressed_data,
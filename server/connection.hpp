@@ -54,15 +54,25 @@ template <class T> T *get_pointer(std::shared_ptr<T> &p) { return p.get(); }
 #endif
 
 class RequestHandler;
+class WorkerPool;
 
 namespace http
 {
 
 /// Represents a single connection from a client.
+/// Connections are kept alive for up to keepalive_max_requests requests as long as no request
+/// takes longer than keepalive_timeout seconds to arrive. A timeout of zero closes the connection
+/// after every reply.
+/// Parsed requests are handed to the worker pool, the io threads only read and write. If the
+/// pool rejects a request the connection replies 503 immediately.
 class Connection : public std::enable_shared_from_this<Connection>
 {
   public:
-    explicit Connection(boost::asio::io_service &io_service, RequestHandler &handler);
+    explicit Connection(boost::asio::io_service &io_service,
+                        RequestHandler &handler,
+                        WorkerPool &worker_pool,
+                        const unsigned keepalive_timeout,
+                        const unsigned keepalive_max_requests);
     Connection(const Connection &) = delete;
     Connection() = delete;
 
@@ -72,21 +82,47 @@ class Connection : public std::enable_shared_from_this<Connection>
     void start();
 
   private:
+    void start_read();
+
     void handle_read(const boost::system::error_code &e, std::size_t bytes_transferred);
 
+    /// Parse [begin, end) and reply as soon as a complete request was read.
+    void process_input(char *begin, char *end);
+
+    /// Add the connection header, compress if requested and fill output_buffer.
+    void prepare_reply(const compression_type compression_type);
+
+    /// Write output_buffer to the socket, must run on the strand.
+    void write_reply();
+
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code &e);
 
+    /// Close the connection if the client stayed idle for too long.
+    void handle_timeout(const boost::system::error_code &e);
+
     std::vector<char> compress_buffers(const std::vector<char> &uncompressed_data,
                                        const compression_type compression_type);
 
     boost::asio::io_service::strand strand;
     boost::asio::ip::tcp::socket TCP_socket;
+    boost::asio::deadline_timer timer;
     RequestHandler &request_handler;
+    WorkerPool &worker_pool;
     RequestParser request_parser;
     boost::array<char, 8192> incoming_data_buffer;
     request current_request;
     reply current_reply;
+    std::vector<char> compressed_output;
+    std::vector<boost::asio::const_buffer> output_buffer;
+
+    const unsigned keepalive_timeout;
+    const unsigned keepalive_max_requests;
+    unsigned processed_requests;
+    bool keep_alive;
+    // bytes of a pipelined request that were read along with the current one
+    char *pending_begin;
+    char *pending_end;
 };
 
 } // namespace http
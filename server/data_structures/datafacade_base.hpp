@@ -78,6 +78,15 @@ template <class EdgeDataT> class BaseDataFacade
     virtual EdgeID
     FindEdgeIndicateIfReverse(const NodeID from, const NodeID to, bool &result) const = 0;
 
+    // nodes left uncontracted by osrm-prepare --core, the graph has none if fully contracted
+    virtual bool HasCoreNodes() const = 0;
+
+    virtual bool IsCoreNode(const NodeID id) const = 0;
+
+    // Nested cells of osrm-prepare --mld and their customized cliques. Their storage depends on
+    // the facade, the concrete facades provide GetMultiLevelPartition() and GetCellStorage().
+    virtual bool HasMultiLevelPartition() const = 0;
+
     // node and edge information access
     virtual FixedPointCoordinate GetCoordinateOfNode(const unsigned id) const = 0;
 
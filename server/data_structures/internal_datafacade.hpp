@@ -32,6 +32,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "datafacade_base.hpp"
 
+#include "../../data_structures/cell_storage.hpp"
+#include "../../data_structures/multi_level_partition.hpp"
 #include "../../data_structures/original_edge_data.hpp"
 #include "../../data_structures/query_node.hpp"
 #include "../../data_structures/query_edge.hpp"
@@ -46,6 +48,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/coordinate.hpp>
 #include <osrm/server_paths.hpp>
 
+#include <algorithm>
 #include <limits>
 
 template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacade<EdgeDataT>
@@ -56,6 +59,7 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
     using QueryGraph = StaticGraph<typename super::EdgeData>;
     using InputEdge = typename QueryGraph::InputEdge;
     using RTreeLeaf = typename super::RTreeLeaf;
+    using InternalRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>;
 
     InternalDataFacade() {}
 
@@ -71,11 +75,13 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
     ShM<TravelMode, false>::vector m_travel_mode_list;
     ShM<char, false>::vector m_names_char_list;
     ShM<bool, false>::vector m_edge_is_compressed;
+    ShM<bool, false>::vector m_is_core_node;
     ShM<unsigned, false>::vector m_geometry_indices;
     ShM<unsigned, false>::vector m_geometry_list;
+    MultiLevelPartition m_partition;
+    CellStorage m_cell_storage;
 
-    boost::thread_specific_ptr<
-        StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>> m_static_rtree;
+    std::shared_ptr<InternalRTree> m_static_rtree;
     boost::filesystem::path ram_index_path;
     boost::filesystem::path file_index_path;
     RangeTable<16, false> m_name_table;
@@ -110,7 +116,8 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
         SimpleLogger().Write() << "loading graph from " << hsgr_path.string();
 
-        m_number_of_nodes = readHSGRFromStream(hsgr_path, node_list, edge_list, &m_check_sum);
+        m_number_of_nodes =
+            readHSGRFromStream(hsgr_path, node_list, edge_list, &m_check_sum, &m_is_core_node);
 
         BOOST_ASSERT_MSG(0 != node_list.size(), "node list empty");
         // BOOST_ASSERT_MSG(0 != edge_list.size(), "edge list empty");
@@ -121,6 +128,35 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         BOOST_ASSERT_MSG(0 == node_list.size(), "node list not flushed");
         BOOST_ASSERT_MSG(0 == edge_list.size(), "edge list not flushed");
         SimpleLogger().Write() << "Data checksum is " << m_check_sum;
+        if (!m_is_core_node.empty())
+        {
+            SimpleLogger().Write() << "graph has an uncontracted core of "
+                                   << std::count(m_is_core_node.begin(), m_is_core_node.end(), true)
+                                   << " nodes";
+        }
+    }
+
+    void LoadMultiLevelPartition(const boost::filesystem::path &partition_path,
+                                 const boost::filesystem::path &cells_path)
+    {
+        boost::filesystem::ifstream partition_stream(partition_path, std::ios::binary);
+        partition_stream >> m_partition;
+        // the node array of the .hsgr has a sentinel, the graph and the partition do not
+        if (m_partition.GetNumberOfNodes() != m_query_graph->GetNumberOfNodes())
+        {
+            throw osrm::exception(partition_path.string() + " does not match the graph");
+        }
+
+        boost::filesystem::ifstream cells_stream(cells_path, std::ios::binary);
+        unsigned cells_check_sum = 0;
+        cells_stream.read((char *)&cells_check_sum, sizeof(unsigned));
+        if (cells_check_sum != m_check_sum)
+        {
+            throw osrm::exception(cells_path.string() + " is outdated, run osrm-customize");
+        }
+        cells_stream >> m_cell_storage;
+        SimpleLogger().Write() << "loaded partition of " << m_partition.GetNumberOfLevels()
+                               << " levels";
     }
 
     void LoadNodeAndEdgeInformation(const boost::filesystem::path &nodes_file,
@@ -199,12 +235,12 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         geometry_stream.close();
     }
 
-    void LoadRTree()
+    void LoadRTree(const bool prefault_index)
     {
         BOOST_ASSERT_MSG(!m_coordinate_list->empty(), "coordinates must be loaded before r-tree");
 
-        m_static_rtree.reset(
-            new StaticRTree<RTreeLeaf>(ram_index_path, file_index_path, m_coordinate_list));
+        m_static_rtree = std::make_shared<InternalRTree>(ram_index_path, file_index_path,
+                                                         m_coordinate_list, prefault_index);
     }
 
     void LoadStreetNames(const boost::filesystem::path &names_file)
@@ -232,7 +268,7 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         m_static_rtree.reset();
     }
 
-    explicit InternalDataFacade(const ServerPaths &server_paths)
+    explicit InternalDataFacade(const ServerPaths &server_paths, const bool prefault_index = false)
     {
         // generate paths of data files
         if (server_paths.find("hsgrdata") == server_paths.end())
@@ -288,11 +324,26 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         paths_iterator = server_paths.find("geometries");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         const boost::filesystem::path &geometries_path = paths_iterator->second;
+        // optional, written by osrm-prepare --mld
+        paths_iterator = server_paths.find("partitiondata");
+        const boost::filesystem::path partition_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second
+                                                 : boost::filesystem::path();
+        paths_iterator = server_paths.find("cellsdata");
+        const boost::filesystem::path cells_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second
+                                                 : boost::filesystem::path();
 
         // load data
         SimpleLogger().Write() << "loading graph data";
         AssertPathExists(hsgr_path);
         LoadGraph(hsgr_path);
+        if (boost::filesystem::is_regular_file(partition_path) &&
+            boost::filesystem::is_regular_file(cells_path))
+        {
+            SimpleLogger().Write() << "loading multi-level partition";
+            LoadMultiLevelPartition(partition_path, cells_path);
+        }
         SimpleLogger().Write() << "loading edge information";
         AssertPathExists(nodes_data_path);
         AssertPathExists(edges_data_path);
@@ -303,6 +354,7 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         SimpleLogger().Write() << "loading r-tree";
         AssertPathExists(ram_index_path);
         AssertPathExists(file_index_path);
+        LoadRTree(prefault_index);
         SimpleLogger().Write() << "loading timestamp";
         LoadTimestamp(timestamp_path);
         SimpleLogger().Write() << "loading street names";
@@ -353,36 +405,52 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         return m_query_graph->FindEdgeIndicateIfReverse(from, to, result);
     }
 
+    bool HasCoreNodes() const override final { return !m_is_core_node.empty(); }
+
+    bool IsCoreNode(const NodeID id) const override final
+    {
+        BOOST_ASSERT(m_is_core_node.empty() || id < m_is_core_node.size());
+        return !m_is_core_node.empty() && m_is_core_node[id];
+    }
+
+    bool HasMultiLevelPartition() const override final
+    {
+        return m_partition.GetNumberOfLevels() > 0;
+    }
+
+    const MultiLevelPartition &GetMultiLevelPartition() const { return m_partition; }
+
+    const CellStorage &GetCellStorage() const { return m_cell_storage; }
+
     // node and edge information access
     FixedPointCoordinate GetCoordinateOfNode(const unsigned id) const override final
     {
-        return m_coordinate_list->at(id);
+        BOOST_ASSERT(id < m_coordinate_list->size());
+        return (*m_coordinate_list)[id];
     };
 
     bool EdgeIsCompressed(const unsigned id) const override final
     {
-        return m_edge_is_compressed.at(id);
+        BOOST_ASSERT(id < m_edge_is_compressed.size());
+        return m_edge_is_compressed[id];
     }
 
     TurnInstruction GetTurnInstructionForEdgeID(const unsigned id) const override final
     {
-        return m_turn_instruction_list.at(id);
+        BOOST_ASSERT(id < m_turn_instruction_list.size());
+        return m_turn_instruction_list[id];
     }
 
     TravelMode GetTravelModeForEdgeID(const unsigned id) const override final
     {
-        return m_travel_mode_list.at(id);
+        BOOST_ASSERT(id < m_travel_mode_list.size());
+        return m_travel_mode_list[id];
     }
 
     bool LocateClosestEndPointForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) override final
     {
-        if (!m_static_rtree.get())
-        {
-            LoadRTree();
-        }
-
         return m_static_rtree->LocateClosestEndPointForCoordinate(input_coordinate, result,
                                                                   zoom_level);
     }
@@ -407,11 +475,6 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned number_of_results) override final
     {
-        if (!m_static_rtree.get())
-        {
-            LoadRTree();
-        }
-
         return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
             input_coordinate, resulting_phantom_node_vector, number_of_results);
     }
@@ -423,11 +486,6 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         const unsigned min_number_of_phantom_nodes,
         const unsigned max_number_of_phantom_nodes) override final
     {
-        if (!m_static_rtree.get())
-        {
-            LoadRTree();
-        }
-
         return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
             input_coordinate, resulting_phantom_node_vector, max_distance,
             min_number_of_phantom_nodes, max_number_of_phantom_nodes);
@@ -437,7 +495,8 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const override final
     {
-        return m_name_ID_list.at(id);
+        BOOST_ASSERT(id < m_name_ID_list.size());
+        return m_name_ID_list[id];
     }
 
     std::string get_name_for_id(const unsigned name_id) const override final
@@ -461,14 +520,16 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const override final
     {
-        return m_via_node_list.at(id);
+        BOOST_ASSERT(id < m_via_node_list.size());
+        return m_via_node_list[id];
     }
 
     virtual void GetUncompressedGeometry(const unsigned id,
                                          std::vector<unsigned> &result_nodes) const override final
     {
-        const unsigned begin = m_geometry_indices.at(id);
-        const unsigned end = m_geometry_indices.at(id + 1);
+        BOOST_ASSERT(id + 1 < m_geometry_indices.size());
+        const unsigned begin = m_geometry_indices[id];
+        const unsigned end = m_geometry_indices[id + 1];
 
         result_nodes.clear();
         result_nodes.insert(result_nodes.begin(), m_geometry_list.begin() + begin,
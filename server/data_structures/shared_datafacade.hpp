@@ -33,6 +33,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "datafacade_base.hpp"
 #include "shared_datatype.hpp"
 
+#include "../../data_structures/cell_storage.hpp"
+#include "../../data_structures/multi_level_partition.hpp"
 #include "../../data_structures/range_table.hpp"
 #include "../../data_structures/static_graph.hpp"
 #include "../../data_structures/static_rtree.hpp"
@@ -41,14 +43,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../util/simple_logger.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <limits>
 #include <memory>
+#include <thread>
 
 template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<EdgeDataT>
 {
+  public:
+    using EdgeData = EdgeDataT;
 
   private:
-    using EdgeData = EdgeDataT;
     using super = BaseDataFacade<EdgeData>;
     using QueryGraph = StaticGraph<EdgeData, true>;
     using GraphNode = typename StaticGraph<EdgeData, true>::NodeArrayEntry;
@@ -57,8 +63,9 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
     using InputEdge = typename QueryGraph::InputEdge;
     using RTreeLeaf = typename super::RTreeLeaf;
     using SharedRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>;
-    using TimeStampedRTreePair = std::pair<unsigned, std::shared_ptr<SharedRTree>>;
     using RTreeNode = typename SharedRTree::TreeNode;
+    using SharedMultiLevelPartition = MultiLevelPartitionImpl<true>;
+    using SharedCellStorage = CellStorageImpl<true>;
 
     SharedDataLayout *data_layout;
     char *shared_memory;
@@ -70,6 +77,7 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
 
     unsigned m_check_sum;
     std::unique_ptr<QueryGraph> m_query_graph;
+    std::unique_ptr<SharedMemory> m_timestamp_memory;
     std::unique_ptr<SharedMemory> m_layout_memory;
     std::unique_ptr<SharedMemory> m_large_memory;
     std::string m_timestamp;
@@ -82,11 +90,16 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
     ShM<char, true>::vector m_names_char_list;
     ShM<unsigned, true>::vector m_name_begin_indices;
     ShM<bool, true>::vector m_edge_is_compressed;
+    ShM<bool, true>::vector m_is_core_node;
+    // empty unless osrm-datastore loaded the partition of osrm-prepare --mld
+    SharedMultiLevelPartition m_partition;
+    SharedCellStorage m_cell_storage;
     ShM<unsigned, true>::vector m_geometry_indices;
     ShM<unsigned, true>::vector m_geometry_list;
 
-    boost::thread_specific_ptr<std::pair<unsigned, std::shared_ptr<SharedRTree>>> m_static_rtree;
+    std::shared_ptr<SharedRTree> m_static_rtree;
     boost::filesystem::path file_index_path;
+    bool prefault_index;
 
     std::shared_ptr<RangeTable<16, true>> m_name_table;
 
@@ -113,11 +126,9 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
 
         RTreeNode *tree_ptr =
             data_layout->GetBlockPtr<RTreeNode>(shared_memory, SharedDataLayout::R_SEARCH_TREE);
-        m_static_rtree.reset(new TimeStampedRTreePair(
-            CURRENT_TIMESTAMP,
-            osrm::make_unique<SharedRTree>(
-                tree_ptr, data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
-                file_index_path, m_coordinate_list)));
+        m_static_rtree = std::make_shared<SharedRTree>(
+            tree_ptr, data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE], file_index_path,
+            m_coordinate_list, prefault_index);
     }
 
     void LoadGraph()
@@ -133,6 +144,57 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         typename ShM<GraphEdge, true>::vector edge_list(
             graph_edges_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
         m_query_graph.reset(new QueryGraph(node_list, edge_list));
+
+        unsigned *core_marker_ptr =
+            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::CORE_MARKER);
+        typename ShM<bool, true>::vector is_core_node(
+            core_marker_ptr, data_layout->num_entries[SharedDataLayout::CORE_MARKER]);
+        m_is_core_node.swap(is_core_node);
+    }
+
+    void LoadMultiLevelPartition()
+    {
+        using CellID = SharedMultiLevelPartition::CellID;
+        using CellData = SharedCellStorage::CellData;
+
+        const auto number_of_levels =
+            data_layout->num_entries[SharedDataLayout::PARTITION_NUMBER_OF_CELLS];
+        if (0 == number_of_levels)
+        {
+            return;
+        }
+
+        CellID *number_of_cells_ptr = data_layout->GetBlockPtr<CellID>(
+            shared_memory, SharedDataLayout::PARTITION_NUMBER_OF_CELLS);
+        CellID *cells_ptr =
+            data_layout->GetBlockPtr<CellID>(shared_memory, SharedDataLayout::PARTITION_CELLS);
+        m_partition = SharedMultiLevelPartition(
+            static_cast<SharedMultiLevelPartition::LevelID>(number_of_levels),
+            m_query_graph->GetNumberOfNodes(),
+            SharedMultiLevelPartition::CellVector(number_of_cells_ptr, number_of_levels),
+            SharedMultiLevelPartition::CellVector(
+                cells_ptr, data_layout->num_entries[SharedDataLayout::PARTITION_CELLS]));
+
+        std::uint64_t *level_offsets_ptr = data_layout->GetBlockPtr<std::uint64_t>(
+            shared_memory, SharedDataLayout::CELL_LEVEL_OFFSETS);
+        CellData *cell_data_ptr =
+            data_layout->GetBlockPtr<CellData>(shared_memory, SharedDataLayout::CELL_DATA);
+        NodeID *boundary_nodes_ptr =
+            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::CELL_BOUNDARY_NODES);
+        EdgeWeight *weights_ptr =
+            data_layout->GetBlockPtr<EdgeWeight>(shared_memory, SharedDataLayout::CELL_WEIGHTS);
+        m_cell_storage = SharedCellStorage(
+            ShM<std::uint64_t, true>::vector(
+                level_offsets_ptr, data_layout->num_entries[SharedDataLayout::CELL_LEVEL_OFFSETS]),
+            ShM<CellData, true>::vector(cell_data_ptr,
+                                        data_layout->num_entries[SharedDataLayout::CELL_DATA]),
+            ShM<NodeID, true>::vector(
+                boundary_nodes_ptr,
+                data_layout->num_entries[SharedDataLayout::CELL_BOUNDARY_NODES]),
+            ShM<EdgeWeight, true>::vector(
+                weights_ptr, data_layout->num_entries[SharedDataLayout::CELL_WEIGHTS]));
+        SimpleLogger().Write() << "loaded partition of " << m_partition.GetNumberOfLevels()
+                               << " levels";
     }
 
     void LoadNodeAndEdgeInformation()
@@ -218,70 +280,102 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
   public:
     virtual ~SharedDataFacade() {}
 
-    SharedDataFacade()
+    // Maps the regions that osrm-datastore published last. The facade never reloads itself, a
+    // newer dataset is loaded into a new facade while queries keep running on this one.
+    explicit SharedDataFacade(const bool prefault_leaf_index = false)
+        : prefault_index(prefault_leaf_index)
     {
-        data_timestamp_ptr = (SharedDataTimestamp *)SharedMemoryFactory::Get(
-                                 CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)->Ptr();
-        CURRENT_LAYOUT = LAYOUT_NONE;
-        CURRENT_DATA = DATA_NONE;
-        CURRENT_TIMESTAMP = 0;
+        m_timestamp_memory.reset(
+            SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false));
+        data_timestamp_ptr = (SharedDataTimestamp *)m_timestamp_memory->Ptr();
 
-        // load data
-        CheckAndReloadFacade();
+        AttachRegions();
+        LoadData();
     }
 
-    void CheckAndReloadFacade()
+    // true if osrm-datastore published newer regions after this facade was loaded
+    bool IsOutdated() const { return CURRENT_TIMESTAMP != data_timestamp_ptr->timestamp.load(); }
+
+  private:
+    // Attaches the regions osrm-datastore published last. It may publish again (and remove
+    // the regions we are about to attach) at any time, so the regions only count if the
+    // timestamp was even and did not change until they were attached. Attached regions stay
+    // valid after they were removed.
+    void AttachRegions()
     {
-        if (CURRENT_LAYOUT != data_timestamp_ptr->layout ||
-            CURRENT_DATA != data_timestamp_ptr->data ||
-            CURRENT_TIMESTAMP != data_timestamp_ptr->timestamp)
+        while (true)
         {
-            // release the previous shared memory segments
-            SharedMemory::Remove(CURRENT_LAYOUT);
-            SharedMemory::Remove(CURRENT_DATA);
-
+            const unsigned timestamp = data_timestamp_ptr->timestamp.load();
+            if (timestamp % 2 != 0)
+            {
+                // the regions are being replaced right now
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
             CURRENT_LAYOUT = data_timestamp_ptr->layout;
             CURRENT_DATA = data_timestamp_ptr->data;
-            CURRENT_TIMESTAMP = data_timestamp_ptr->timestamp;
-
-            m_layout_memory.reset(SharedMemoryFactory::Get(CURRENT_LAYOUT));
-
-            data_layout = (SharedDataLayout *)(m_layout_memory->Ptr());
 
-            m_large_memory.reset(SharedMemoryFactory::Get(CURRENT_DATA));
-            shared_memory = (char *)(m_large_memory->Ptr());
+            try
+            {
+                m_layout_memory.reset(SharedMemoryFactory::Get(CURRENT_LAYOUT));
+                m_large_memory.reset(SharedMemoryFactory::Get(CURRENT_DATA));
+            }
+            catch (const std::exception &)
+            {
+                if (timestamp == data_timestamp_ptr->timestamp.load())
+                {
+                    throw;
+                }
+                continue;
+            }
 
-            const char *file_index_ptr =
-                data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
-            file_index_path = boost::filesystem::path(file_index_ptr);
-            if (!boost::filesystem::exists(file_index_path))
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (timestamp == data_timestamp_ptr->timestamp.load())
             {
-                SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
-                throw osrm::exception("Could not load leaf index file."
-                                      "Is any data loaded into shared memory?");
+                CURRENT_TIMESTAMP = timestamp;
+                return;
             }
+        }
+    }
 
-            LoadGraph();
-            LoadChecksum();
-            LoadNodeAndEdgeInformation();
-            LoadGeometries();
-            LoadTimestamp();
-            LoadViaNodeList();
-            LoadNames();
+    void LoadData()
+    {
+        data_layout = (SharedDataLayout *)(m_layout_memory->Ptr());
+        shared_memory = (char *)(m_large_memory->Ptr());
 
-            data_layout->PrintInformation();
+        const char *file_index_ptr =
+            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
+        file_index_path = boost::filesystem::path(file_index_ptr);
+        if (!boost::filesystem::exists(file_index_path))
+        {
+            SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
+            throw osrm::exception("Could not load leaf index file."
+                                  "Is any data loaded into shared memory?");
+        }
+
+        LoadGraph();
+        LoadChecksum();
+        LoadMultiLevelPartition();
+        LoadNodeAndEdgeInformation();
+        LoadGeometries();
+        LoadTimestamp();
+        LoadViaNodeList();
+        LoadNames();
+        LoadRTree();
+
+        data_layout->PrintInformation();
 
-            SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
-            for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
+        SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
+        for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
+        {
+            if (!GetCoordinateOfNode(i).is_valid())
             {
-                if (!GetCoordinateOfNode(i).is_valid())
-                {
-                    SimpleLogger().Write() << "coordinate " << i << " not valid";
-                }
+                SimpleLogger().Write() << "coordinate " << i << " not valid";
             }
         }
     }
 
+  public:
     // search graph access
     unsigned GetNumberOfNodes() const override final { return m_query_graph->GetNumberOfNodes(); }
 
@@ -325,22 +419,39 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         return m_query_graph->FindEdgeIndicateIfReverse(from, to, result);
     }
 
+    bool HasCoreNodes() const override final { return !m_is_core_node.empty(); }
+
+    bool IsCoreNode(const NodeID id) const override final
+    {
+        BOOST_ASSERT(m_is_core_node.empty() || id < m_is_core_node.size());
+        return !m_is_core_node.empty() && m_is_core_node[id];
+    }
+
+    bool HasMultiLevelPartition() const override final
+    {
+        return m_partition.GetNumberOfLevels() > 0;
+    }
+
+    const SharedMultiLevelPartition &GetMultiLevelPartition() const { return m_partition; }
+
+    const SharedCellStorage &GetCellStorage() const { return m_cell_storage; }
+
     // node and edge information access
     FixedPointCoordinate GetCoordinateOfNode(const NodeID id) const override final
     {
-        return m_coordinate_list->at(id);
+        return (*m_coordinate_list)[id];
     };
 
     virtual bool EdgeIsCompressed(const unsigned id) const override final
     {
-        return m_edge_is_compressed.at(id);
+        return m_edge_is_compressed[id];
     }
 
     virtual void GetUncompressedGeometry(const unsigned id,
                                          std::vector<unsigned> &result_nodes) const override final
     {
-        const unsigned begin = m_geometry_indices.at(id);
-        const unsigned end = m_geometry_indices.at(id + 1);
+        const unsigned begin = m_geometry_indices[id];
+        const unsigned end = m_geometry_indices[id + 1];
 
         result_nodes.clear();
         result_nodes.insert(result_nodes.begin(), m_geometry_list.begin() + begin,
@@ -349,29 +460,24 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const override final
     {
-        return m_via_node_list.at(id);
+        return m_via_node_list[id];
     }
 
     TurnInstruction GetTurnInstructionForEdgeID(const unsigned id) const override final
     {
-        return m_turn_instruction_list.at(id);
+        return m_turn_instruction_list[id];
     }
 
     TravelMode GetTravelModeForEdgeID(const unsigned id) const override final
     {
-        return m_travel_mode_list.at(id);
+        return m_travel_mode_list[id];
     }
 
     bool LocateClosestEndPointForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
-        {
-            LoadRTree();
-        }
-
-        return m_static_rtree->second->LocateClosestEndPointForCoordinate(input_coordinate, result,
+        return m_static_rtree->LocateClosestEndPointForCoordinate(input_coordinate, result,
                                                                           zoom_level);
     }
 
@@ -395,12 +501,7 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned number_of_results) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
-        {
-            LoadRTree();
-        }
-
-        return m_static_rtree->second->IncrementalFindPhantomNodeForCoordinate(
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
             input_coordinate, resulting_phantom_node_vector, number_of_results);
     }
 
@@ -411,12 +512,7 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         const unsigned min_number_of_phantom_nodes,
         const unsigned max_number_of_phantom_nodes) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
-        {
-            LoadRTree();
-        }
-
-        return m_static_rtree->second->IncrementalFindPhantomNodeForCoordinateWithDistance(
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
             input_coordinate, resulting_phantom_node_vector, max_distance,
             min_number_of_phantom_nodes, max_number_of_phantom_nodes);
     }
@@ -425,7 +521,7 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const override final
     {
-        return m_name_ID_list.at(id);
+        return m_name_ID_list[id];
     };
 
     std::string get_name_for_id(const unsigned name_id) const override final
@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdint>
 
 #include <array>
+#include <atomic>
 
 namespace
 {
@@ -60,6 +61,13 @@ struct SharedDataLayout
         GEOMETRIES_LIST,
         GEOMETRIES_INDICATORS,
         HSGR_CHECKSUM,
+        CORE_MARKER,
+        PARTITION_NUMBER_OF_CELLS,
+        PARTITION_CELLS,
+        CELL_LEVEL_OFFSETS,
+        CELL_DATA,
+        CELL_BOUNDARY_NODES,
+        CELL_WEIGHTS,
         TIMESTAMP,
         FILE_INDEX_PATH,
         NUM_BLOCKS
@@ -105,6 +113,18 @@ struct SharedDataLayout
             << "geometries_list_size:       " << num_entries[GEOMETRIES_LIST];
         SimpleLogger().Write(logDEBUG)
             << "sizeof(checksum):           " << entry_size[HSGR_CHECKSUM];
+        SimpleLogger().Write(logDEBUG)
+            << "core_markers:               " << num_entries[CORE_MARKER];
+        SimpleLogger().Write(logDEBUG)
+            << "partition_levels:           " << num_entries[PARTITION_NUMBER_OF_CELLS];
+        SimpleLogger().Write(logDEBUG)
+            << "partition_cells_size:       " << num_entries[PARTITION_CELLS];
+        SimpleLogger().Write(logDEBUG)
+            << "cells:                      " << num_entries[CELL_DATA];
+        SimpleLogger().Write(logDEBUG)
+            << "cell_boundary_nodes_size:   " << num_entries[CELL_BOUNDARY_NODES];
+        SimpleLogger().Write(logDEBUG)
+            << "cell_weights_size:          " << num_entries[CELL_WEIGHTS];
 
         SimpleLogger().Write(logDEBUG) << "NAME_OFFSETS         "
                                        << ": " << GetBlockSize(NAME_OFFSETS);
@@ -136,6 +156,20 @@ struct SharedDataLayout
                                        << ": " << GetBlockSize(GEOMETRIES_INDICATORS);
         SimpleLogger().Write(logDEBUG) << "HSGR_CHECKSUM        "
                                        << ": " << GetBlockSize(HSGR_CHECKSUM);
+        SimpleLogger().Write(logDEBUG) << "CORE_MARKER          "
+                                       << ": " << GetBlockSize(CORE_MARKER);
+        SimpleLogger().Write(logDEBUG) << "PARTITION_NUMBER_OF_CELLS"
+                                       << ": " << GetBlockSize(PARTITION_NUMBER_OF_CELLS);
+        SimpleLogger().Write(logDEBUG) << "PARTITION_CELLS      "
+                                       << ": " << GetBlockSize(PARTITION_CELLS);
+        SimpleLogger().Write(logDEBUG) << "CELL_LEVEL_OFFSETS   "
+                                       << ": " << GetBlockSize(CELL_LEVEL_OFFSETS);
+        SimpleLogger().Write(logDEBUG) << "CELL_DATA            "
+                                       << ": " << GetBlockSize(CELL_DATA);
+        SimpleLogger().Write(logDEBUG) << "CELL_BOUNDARY_NODES  "
+                                       << ": " << GetBlockSize(CELL_BOUNDARY_NODES);
+        SimpleLogger().Write(logDEBUG) << "CELL_WEIGHTS         "
+                                       << ": " << GetBlockSize(CELL_WEIGHTS);
         SimpleLogger().Write(logDEBUG) << "TIMESTAMP            "
                                        << ": " << GetBlockSize(TIMESTAMP);
         SimpleLogger().Write(logDEBUG) << "FILE_INDEX_PATH      "
@@ -156,6 +190,15 @@ struct SharedDataLayout
             return (num_entries[GEOMETRIES_INDICATORS] / 32 + 1) *
                    entry_size[GEOMETRIES_INDICATORS];
         }
+        // 32 markers per unsigned as well, nothing at all for a fully contracted graph
+        if (bid == CORE_MARKER)
+        {
+            if (0 == num_entries[CORE_MARKER])
+            {
+                return 0;
+            }
+            return (num_entries[CORE_MARKER] / 32 + 1) * entry_size[CORE_MARKER];
+        }
 
         return num_entries[bid] * entry_size[bid];
     }
@@ -217,11 +260,14 @@ enum SharedDataType
     DATA_NONE
 };
 
+// Written by osrm-datastore like a seqlock: the timestamp is odd while layout and data are
+// being replaced. Readers retry until they saw the same even timestamp before and after
+// attaching the regions.
 struct SharedDataTimestamp
 {
     SharedDataType layout;
     SharedDataType data;
-    unsigned timestamp;
+    std::atomic<unsigned> timestamp;
 };
 
 #endif /* SHARED_DATA_TYPE_HPP */
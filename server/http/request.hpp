@@ -37,10 +37,13 @@ namespace http
 
 struct request
 {
+    request() : keep_alive(false) {}
+
     std::string uri;
     std::string referrer;
     std::string agent;
     boost::asio::ip::address endpoint;
+    bool keep_alive;
 };
 
 } // namespace http
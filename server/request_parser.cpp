@@ -43,11 +43,12 @@ namespace http
 RequestParser::RequestParser()
     : state(internal_state::method_start), current_header({"", ""}),
       selected_compression(no_compression), is_post_header(false),
-      content_length(0)
+      content_length(0), http_version_major(0), http_version_minor(0), connection_close(false),
+      connection_keep_alive(false)
 {
 }
 
-std::tuple<osrm::tribool, compression_type>
+std::tuple<osrm::tribool, compression_type, char *>
 RequestParser::parse(request &current_request, char *begin, char *end)
 {
     while (begin != end)
@@ -55,7 +56,7 @@ RequestParser::parse(request &current_request, char *begin, char *end)
         osrm::tribool result = consume(current_request, *begin++);
         if (result != osrm::tribool::indeterminate)
         {
-            return std::make_tuple(result, selected_compression);
+            return std::make_tuple(result, selected_compression, begin);
         }
     }
     osrm::tribool result = osrm::tribool::indeterminate;
@@ -64,7 +65,7 @@ RequestParser::parse(request &current_request, char *begin, char *end)
     {
         result = osrm::tribool::yes;
     }
-    return std::make_tuple(result, selected_compression);
+    return std::make_tuple(result, selected_compression, begin);
 }
 
 osrm::tribool RequestParser::consume(request &current_request, const char input)
@@ -108,6 +109,11 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::post_request:
         current_request.uri.push_back(input);
         --content_length;
+        // stop at the end of the body, anything after it belongs to the next request
+        if (content_length <= 0)
+        {
+            return osrm::tribool::yes;
+        }
         return osrm::tribool::indeterminate;
     case internal_state::method:
         if (input == ' ')
@@ -178,6 +184,7 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::http_version_major_start:
         if (is_digit(input))
         {
+            http_version_major = input - '0';
             state = internal_state::http_version_major;
             return osrm::tribool::indeterminate;
         }
@@ -190,12 +197,14 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         }
         if (is_digit(input))
         {
+            http_version_major = 10 * http_version_major + (input - '0');
             return osrm::tribool::indeterminate;
         }
         return osrm::tribool::no;
     case internal_state::http_version_minor_start:
         if (is_digit(input))
         {
+            http_version_minor = input - '0';
             state = internal_state::http_version_minor;
             return osrm::tribool::indeterminate;
         }
@@ -208,6 +217,7 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         }
         if (is_digit(input))
         {
+            http_version_minor = 10 * http_version_minor + (input - '0');
             return osrm::tribool::indeterminate;
         }
         return osrm::tribool::no;
@@ -241,6 +251,11 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         {
             current_request.agent = current_header.value;
         }
+        if (boost::iequals(current_header.name, "Connection"))
+        {
+            connection_close = boost::icontains(current_header.value, "close");
+            connection_keep_alive = boost::icontains(current_header.value, "keep-alive");
+        }
         if (boost::iequals(current_header.name, "Content-Length"))
         {
             try 
@@ -330,9 +345,18 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::expecting_newline_3:
         if(input == '\n')
         {
+            // HTTP/1.1 connections are persistent unless told otherwise, HTTP/1.0 ones only on request
+            const bool is_http_1_1 =
+                http_version_major > 1 || (http_version_major == 1 && http_version_minor >= 1);
+            current_request.keep_alive = is_http_1_1 ? !connection_close : connection_keep_alive;
+
             if(is_post_header)
             {
                 current_request.uri.push_back('?');
+                if (content_length <= 0)
+                {
+                    return osrm::tribool::yes;
+                }
                 state = internal_state::post_request;
                 return osrm::tribool::indeterminate;
             }
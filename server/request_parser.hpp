@@ -44,7 +44,9 @@ class RequestParser
   public:
     RequestParser();
 
-    std::tuple<osrm::tribool, compression_type>
+    // Consumes input until a request is complete. The returned pointer marks the first byte
+    // that was not consumed, i.e. the start of a pipelined follow-up request.
+    std::tuple<osrm::tribool, compression_type, char *>
     parse(request &current_request, char *begin, char *end);
 
   private:
@@ -91,6 +93,10 @@ class RequestParser
     compression_type selected_compression;
     bool is_post_header;
     int content_length;
+    unsigned http_version_major;
+    unsigned http_version_minor;
+    bool connection_close;
+    bool connection_keep_alive;
 };
 
 } // namespace http
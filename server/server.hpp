@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "connection.hpp"
 #include "request_handler.hpp"
+#include "worker_pool.hpp"
 
 #include "../util/cast.hpp"
 #include "../util/integer_range.hpp"
@@ -50,17 +51,37 @@ class Server
   public:
     // Note: returns a shared instead of a unique ptr as it is captured in a lambda somewhere else
     static std::shared_ptr<Server>
-    CreateServer(std::string &ip_address, int ip_port, unsigned requested_num_threads)
+    CreateServer(std::string &ip_address,
+                 int ip_port,
+                 unsigned requested_num_threads,
+                 unsigned keepalive_timeout = 0,
+                 unsigned keepalive_max_requests = 0,
+                 unsigned requested_num_io_threads = 1,
+                 unsigned max_queued_requests = 256,
+                 WorkerPool::ServiceLimits service_limits = WorkerPool::ServiceLimits())
     {
         SimpleLogger().Write() << "http 1.1 compression handled by zlib version " << zlibVersion();
         const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
         const unsigned real_num_threads = std::min(hardware_threads, requested_num_threads);
-        return std::make_shared<Server>(ip_address, ip_port, real_num_threads);
+        const unsigned real_num_io_threads = std::min(hardware_threads, requested_num_io_threads);
+        return std::make_shared<Server>(ip_address, ip_port, real_num_io_threads, real_num_threads,
+                                        max_queued_requests, std::move(service_limits),
+                                        keepalive_timeout, keepalive_max_requests);
     }
 
-    explicit Server(const std::string &address, const int port, const unsigned thread_pool_size)
-        : thread_pool_size(thread_pool_size), acceptor(io_service),
-          new_connection(std::make_shared<http::Connection>(io_service, request_handler))
+    explicit Server(const std::string &address,
+                    const int port,
+                    const unsigned thread_pool_size,
+                    const unsigned worker_pool_size,
+                    const unsigned max_queued_requests,
+                    WorkerPool::ServiceLimits service_limits,
+                    const unsigned keepalive_timeout,
+                    const unsigned keepalive_max_requests)
+        : thread_pool_size(thread_pool_size), keepalive_timeout(keepalive_timeout),
+          keepalive_max_requests(keepalive_max_requests), acceptor(io_service),
+          new_connection(std::make_shared<http::Connection>(
+              io_service, request_handler, worker_pool, keepalive_timeout, keepalive_max_requests)),
+          worker_pool(worker_pool_size, max_queued_requests, std::move(service_limits))
     {
         const std::string port_string = cast::integral_to_string(port);
 
@@ -92,7 +113,11 @@ class Server
         }
     }
 
-    void Stop() { io_service.stop(); }
+    void Stop()
+    {
+        io_service.stop();
+        worker_pool.Stop();
+    }
 
     RequestHandler &GetRequestHandlerPtr() { return request_handler; }
 
@@ -102,7 +127,9 @@ class Server
         if (!e)
         {
             new_connection->start();
-            new_connection = std::make_shared<http::Connection>(io_service, request_handler);
+            new_connection = std::make_shared<http::Connection>(
+                io_service, request_handler, worker_pool, keepalive_timeout,
+                keepalive_max_requests);
             acceptor.async_accept(
                 new_connection->socket(),
                 boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
@@ -110,10 +137,14 @@ class Server
     }
 
     unsigned thread_pool_size;
+    unsigned keepalive_timeout;
+    unsigned keepalive_max_requests;
     boost::asio::io_service io_service;
     boost::asio::ip::tcp::acceptor acceptor;
     std::shared_ptr<http::Connection> new_connection;
     RequestHandler request_handler;
+    // destroyed first, so no job outlives the handler or the io_service
+    WorkerPool worker_pool;
 };
 
 #endif // SERVER_HPP
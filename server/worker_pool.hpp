@@ -0,0 +1,149 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <boost/assert.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Fixed set of threads that run the routing work, fed from a bounded queue.
+/// Posting never blocks: it fails when the queue is full or when the service of the request
+/// already has its maximum number of queued and running jobs, so that the io threads can
+/// reply with 503 right away.
+class WorkerPool
+{
+  public:
+    using Job = std::function<void()>;
+    using ServiceLimits = std::unordered_map<std::string, unsigned>;
+
+    WorkerPool(const unsigned number_of_workers,
+               const unsigned max_queue_size,
+               ServiceLimits service_limits)
+        : max_queue_size(max_queue_size), service_limits(std::move(service_limits)),
+          stopped(false)
+    {
+        BOOST_ASSERT(number_of_workers > 0);
+        for (unsigned i = 0; i < number_of_workers; ++i)
+        {
+            workers.emplace_back(&WorkerPool::Work, this);
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    ~WorkerPool()
+    {
+        Stop();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool TryPost(const std::string &service, Job job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped || queue.size() >= max_queue_size)
+        {
+            return false;
+        }
+
+        const auto limit_iter = service_limits.find(service);
+        if (limit_iter != service_limits.end())
+        {
+            unsigned &active = active_per_service[service];
+            if (active >= limit_iter->second)
+            {
+                return false;
+            }
+            ++active;
+        }
+
+        queue.emplace_back(service, std::move(job));
+        condition.notify_one();
+        return true;
+    }
+
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        condition.notify_all();
+    }
+
+  private:
+    void Work()
+    {
+        while (true)
+        {
+            std::pair<std::string, Job> entry;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]
+                               {
+                                   return stopped || !queue.empty();
+                               });
+                if (stopped)
+                {
+                    return;
+                }
+                entry = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            entry.second();
+
+            if (service_limits.count(entry.first))
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --active_per_service[entry.first];
+            }
+        }
+    }
+
+    const unsigned max_queue_size;
+    const ServiceLimits service_limits;
+    std::unordered_map<std::string, unsigned> active_per_service;
+    std::deque<std::pair<std::string, Job>> queue;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped;
+};
+
+#endif // WORKER_POOL_HPP
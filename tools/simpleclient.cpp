@@ -43,12 +43,14 @@ int main(int argc, const char *argv[])
     try
     {
         std::string ip_address;
-        int ip_port, requested_thread_num, max_locations_map_matching;
+        int ip_port, requested_thread_num, keepalive_timeout, keepalive_max_requests,
+            max_locations_map_matching;
         bool trial_run = false;
         libosrm_config lib_config;
         const unsigned init_result = GenerateServerProgramOptions(
             argc, argv, lib_config.server_paths, ip_address, ip_port, requested_thread_num,
-            lib_config.use_shared_memory, trial_run, lib_config.max_locations_distance_table,
+            keepalive_timeout, keepalive_max_requests, lib_config.use_shared_memory,
+            lib_config.prefault_index, trial_run, lib_config.max_locations_distance_table,
             max_locations_map_matching);
 
         if (init_result == INIT_OK_DO_NOT_START_ENGINE)
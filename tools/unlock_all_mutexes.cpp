@@ -40,7 +40,6 @@ int main()
         SimpleLogger().Write() << "Releasing all locks";
         SharedBarriers barrier;
         barrier.pending_update_mutex.unlock();
-        barrier.query_mutex.unlock();
         barrier.update_mutex.unlock();
     }
     catch (const std::exception &e)
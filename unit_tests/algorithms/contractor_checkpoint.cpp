@@ -0,0 +1,229 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../contractor/contractor.hpp"
+#include "../../data_structures/deallocating_vector.hpp"
+#include "../../data_structures/import_edge.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../util/osrm_exception.hpp"
+#include "../../typedefs.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(contractor_checkpoint)
+
+namespace
+{
+constexpr unsigned GRID_SIZE = 40;
+constexpr unsigned NUM_NODES = GRID_SIZE * GRID_SIZE;
+
+// grid with random weights and directions
+DeallocatingVector<EdgeBasedEdge> MakeEdges()
+{
+    std::mt19937 g(7);
+    std::uniform_int_distribution<EdgeWeight> weight_udist(1, 50);
+    std::uniform_int_distribution<int> direction_udist(0, 2);
+    DeallocatingVector<EdgeBasedEdge> edges;
+    for (const auto row : osrm::irange(0u, GRID_SIZE))
+    {
+        for (const auto column : osrm::irange(0u, GRID_SIZE))
+        {
+            const NodeID node = row * GRID_SIZE + column;
+            if (column + 1 < GRID_SIZE)
+            {
+                const auto direction = direction_udist(g);
+                edges.push_back(EdgeBasedEdge(node, node + 1, node, weight_udist(g),
+                                              direction != 1, direction != 2));
+            }
+            if (row + 1 < GRID_SIZE)
+            {
+                const auto direction = direction_udist(g);
+                edges.push_back(EdgeBasedEdge(node, node + GRID_SIZE, node, weight_udist(g),
+                                              direction != 1, direction != 2));
+            }
+        }
+    }
+    return edges;
+}
+
+using Adjacency = std::vector<std::vector<std::pair<NodeID, EdgeWeight>>>;
+
+std::vector<EdgeWeight> Dijkstra(const Adjacency &adjacency, const NodeID source)
+{
+    std::vector<EdgeWeight> distances(adjacency.size(), INVALID_EDGE_WEIGHT);
+    using QueueEntry = std::pair<EdgeWeight, NodeID>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    queue.emplace(0, source);
+    while (!queue.empty())
+    {
+        const auto entry = queue.top();
+        queue.pop();
+        if (distances[entry.second] != INVALID_EDGE_WEIGHT)
+        {
+            continue;
+        }
+        distances[entry.second] = entry.first;
+        for (const auto &edge : adjacency[entry.second])
+        {
+            queue.emplace(entry.first + edge.second, edge.first);
+        }
+    }
+    return distances;
+}
+
+// distances between random node pairs in the contracted graph
+std::vector<EdgeWeight> QueryDistances(Contractor &contractor)
+{
+    DeallocatingVector<QueryEdge> edges;
+    contractor.GetEdges(edges);
+    Adjacency forward(NUM_NODES), backward(NUM_NODES);
+    for (const auto &edge : edges)
+    {
+        if (edge.data.forward)
+        {
+            forward[edge.source].emplace_back(edge.target, edge.data.distance);
+        }
+        if (edge.data.backward)
+        {
+            backward[edge.source].emplace_back(edge.target, edge.data.distance);
+        }
+    }
+
+    std::mt19937 g(1);
+    std::uniform_int_distribution<NodeID> node_udist(0, NUM_NODES - 1);
+    std::vector<EdgeWeight> distances;
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        const auto forward_distances = Dijkstra(forward, node_udist(g));
+        const auto backward_distances = Dijkstra(backward, node_udist(g));
+        EdgeWeight distance = INVALID_EDGE_WEIGHT;
+        for (const auto node : osrm::irange(0u, NUM_NODES))
+        {
+            if (forward_distances[node] != INVALID_EDGE_WEIGHT &&
+                backward_distances[node] != INVALID_EDGE_WEIGHT)
+            {
+                distance = std::min(distance, forward_distances[node] + backward_distances[node]);
+            }
+        }
+        distances.push_back(distance);
+    }
+    return distances;
+}
+
+// contracts the grid and leaves the last checkpoint behind, as an interrupted run would
+void WriteCheckpoint(const std::string &path, const unsigned interval, const double core_factor)
+{
+    auto edges = MakeEdges();
+    Contractor contractor(NUM_NODES, edges);
+    contractor.EnableCheckpoints(path, interval);
+    contractor.Run(core_factor);
+}
+
+struct CheckpointFixture
+{
+    CheckpointFixture()
+        : path((boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path("osrm-%%%%-%%%%.checkpoint"))
+                   .string())
+    {
+    }
+    ~CheckpointFixture()
+    {
+        boost::filesystem::remove(path);
+        boost::filesystem::remove(path + ".external");
+    }
+    const std::string path;
+};
+
+// the node order may differ between runs, the distances may not
+void CheckResumedRun(const std::string &path, const unsigned interval)
+{
+    auto edges = MakeEdges();
+    Contractor uninterrupted(NUM_NODES, edges);
+    uninterrupted.Run();
+    const auto expected = QueryDistances(uninterrupted);
+
+    WriteCheckpoint(path, interval, 1.0);
+    Contractor resumed(path);
+    BOOST_CHECK_EQUAL(resumed.GetNumberOfInputNodes(), NUM_NODES);
+    resumed.Run();
+    const auto distances = QueryDistances(resumed);
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(distances.begin(), distances.end(), expected.begin(),
+                                  expected.end());
+    BOOST_CHECK(std::any_of(distances.begin(), distances.end(), [](const EdgeWeight distance)
+                            {
+                                return distance != INVALID_EDGE_WEIGHT;
+                            }));
+}
+}
+
+BOOST_FIXTURE_TEST_CASE(resume_after_flush, CheckpointFixture) { CheckResumedRun(path, 0); }
+
+BOOST_FIXTURE_TEST_CASE(resume_after_interval, CheckpointFixture) { CheckResumedRun(path, 2); }
+
+BOOST_FIXTURE_TEST_CASE(refuse_other_core_factor, CheckpointFixture)
+{
+    WriteCheckpoint(path, 0, 0.9);
+    Contractor resumed(path);
+    BOOST_CHECK_THROW(resumed.Run(1.0), osrm::exception);
+}
+
+BOOST_FIXTURE_TEST_CASE(checkpoint_stores_input_checksum, CheckpointFixture)
+{
+    WriteCheckpoint(path, 0, 1.0);
+    Contractor resumed(path);
+    auto edges = MakeEdges();
+    BOOST_CHECK_EQUAL(resumed.GetInputChecksum(), Contractor::InputChecksum(edges));
+}
+
+BOOST_AUTO_TEST_CASE(input_checksum)
+{
+    auto edges = MakeEdges();
+    const auto checksum = Contractor::InputChecksum(edges);
+
+    // independent of the order
+    std::vector<EdgeBasedEdge> reversed(edges.begin(), edges.end());
+    std::reverse(reversed.begin(), reversed.end());
+    BOOST_CHECK_EQUAL(Contractor::InputChecksum(reversed), checksum);
+
+    // but not of the weights
+    reversed.front().weight += 1;
+    BOOST_CHECK_NE(Contractor::InputChecksum(reversed), checksum);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
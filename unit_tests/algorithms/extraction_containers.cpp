@@ -0,0 +1,209 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../extractor/extraction_containers.hpp"
+#include "../../extractor/internal_extractor_edge.hpp"
+#include "../../data_structures/external_memory_node.hpp"
+#include "../../data_structures/restriction.hpp"
+#include "../../data_structures/travel_mode.hpp"
+#include "../../util/fingerprint.hpp"
+#include "../../util/integer_range.hpp"
+#include "../../typedefs.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(extraction_containers)
+
+namespace
+{
+constexpr unsigned GRID_SIZE = 80;
+constexpr unsigned NUM_NODES = GRID_SIZE * GRID_SIZE;
+
+// OSM ids are neither dense nor in the order of the grid
+NodeID OSMNodeID(const unsigned node) { return (node * 7919u) % 100003u + 1; }
+
+// Ways of a single segment on a grid, with parallel ways, loops, ways to missing nodes
+// and restrictions at the crossings. The lists are large enough to be split into several
+// ranges by the in-memory mode.
+void FillContainers(ExtractionContainers &containers)
+{
+    std::mt19937 g(13);
+    std::uniform_int_distribution<int> speed_udist(5, 130);
+    std::uniform_int_distribution<int> percent_udist(0, 99);
+
+    for (const auto node : osrm::irange(0u, NUM_NODES))
+    {
+        const int lat = static_cast<int>(52.0 * COORDINATE_PRECISION) + (node / GRID_SIZE) * 100;
+        const int lon = static_cast<int>(13.0 * COORDINATE_PRECISION) + (node % GRID_SIZE) * 100;
+        containers.all_nodes_list.push_back(ExternalMemoryNode(
+            lat, lon, OSMNodeID(node), percent_udist(g) < 5, percent_udist(g) < 5));
+    }
+    // nodes no way uses
+    for (const auto node : osrm::irange(NUM_NODES, NUM_NODES + 100))
+    {
+        containers.all_nodes_list.push_back(
+            ExternalMemoryNode(0, 0, OSMNodeID(node), false, false));
+    }
+
+    EdgeID next_way_id = 1;
+    const auto add_way = [&](const NodeID from, const NodeID to)
+    {
+        InternalExtractorEdge::WeightData weight_data;
+        weight_data.speed = speed_udist(g);
+        weight_data.type = InternalExtractorEdge::WeightType::SPEED;
+        const bool forward_only = percent_udist(g) < 30;
+        containers.all_edges_list.push_back(InternalExtractorEdge(
+            from, to, 0, weight_data, true, !forward_only, false, false, false,
+            TRAVEL_MODE_DEFAULT, false));
+        containers.used_node_id_list.push_back(from);
+        containers.used_node_id_list.push_back(to);
+        containers.way_start_end_id_list.push_back({next_way_id, from, to, from, to});
+        return next_way_id++;
+    };
+
+    std::vector<EdgeID> horizontal_way(NUM_NODES, SPECIAL_EDGEID);
+    std::vector<EdgeID> vertical_way(NUM_NODES, SPECIAL_EDGEID);
+    for (const auto node : osrm::irange(0u, NUM_NODES))
+    {
+        if (node % GRID_SIZE + 1 < GRID_SIZE)
+        {
+            horizontal_way[node] = add_way(OSMNodeID(node), OSMNodeID(node + 1));
+            if (percent_udist(g) < 10)
+            {
+                add_way(OSMNodeID(node + 1), OSMNodeID(node));
+            }
+        }
+        if (node + GRID_SIZE < NUM_NODES)
+        {
+            vertical_way[node] = add_way(OSMNodeID(node), OSMNodeID(node + GRID_SIZE));
+            if (percent_udist(g) < 10)
+            {
+                add_way(OSMNodeID(node), OSMNodeID(node + GRID_SIZE));
+            }
+        }
+        if (percent_udist(g) < 2)
+        {
+            add_way(OSMNodeID(node), OSMNodeID(node));
+        }
+        if (percent_udist(g) < 2)
+        {
+            add_way(OSMNodeID(node), OSMNodeID(NUM_NODES + 1000 + node));
+        }
+    }
+
+    for (const auto via : osrm::irange(0u, NUM_NODES))
+    {
+        if (via % GRID_SIZE == 0 || via + GRID_SIZE >= NUM_NODES || percent_udist(g) >= 20)
+        {
+            continue;
+        }
+        InputRestrictionContainer restriction_container(percent_udist(g) < 50);
+        restriction_container.restriction.via.node = OSMNodeID(via);
+        restriction_container.restriction.from.way = horizontal_way[via - 1];
+        restriction_container.restriction.to.way =
+            percent_udist(g) < 5 ? next_way_id + 1000 : vertical_way[via];
+        containers.restrictions_list.push_back(restriction_container);
+    }
+}
+
+std::vector<char> ReadFile(const std::string &path)
+{
+    boost::filesystem::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// the number of nodes or restrictions follows the fingerprint
+unsigned ReadCount(const std::vector<char> &file)
+{
+    unsigned count = 0;
+    BOOST_REQUIRE_GE(file.size(), sizeof(FingerPrint) + sizeof(unsigned));
+    std::memcpy(&count, file.data() + sizeof(FingerPrint), sizeof(unsigned));
+    return count;
+}
+
+struct OutputFiles
+{
+    OutputFiles()
+        : base((boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path("osrm-%%%%-%%%%"))
+                   .string()),
+          output(base + ".osrm"), restrictions(base + ".osrm.restrictions"),
+          names(base + ".osrm.names")
+    {
+    }
+    ~OutputFiles()
+    {
+        boost::filesystem::remove(output);
+        boost::filesystem::remove(restrictions);
+        boost::filesystem::remove(names);
+    }
+
+    void Write(const bool in_memory) const
+    {
+        ExtractionContainers containers;
+        FillContainers(containers);
+        containers.PrepareData(output, restrictions, names, in_memory);
+    }
+
+    const std::string base;
+    const std::string output;
+    const std::string restrictions;
+    const std::string names;
+};
+}
+
+BOOST_AUTO_TEST_CASE(in_memory_writes_the_same_files)
+{
+    const OutputFiles external_files;
+    external_files.Write(false);
+    const OutputFiles in_memory_files;
+    in_memory_files.Write(true);
+
+    const auto external_output = ReadFile(external_files.output);
+    const auto in_memory_output = ReadFile(in_memory_files.output);
+    BOOST_CHECK_GT(ReadCount(external_output), 0u);
+    BOOST_CHECK(external_output == in_memory_output);
+
+    const auto external_restrictions = ReadFile(external_files.restrictions);
+    const auto in_memory_restrictions = ReadFile(in_memory_files.restrictions);
+    BOOST_CHECK_GT(ReadCount(external_restrictions), 0u);
+    BOOST_CHECK(external_restrictions == in_memory_restrictions);
+
+    BOOST_CHECK(ReadFile(external_files.names) == ReadFile(in_memory_files.names));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../extractor/parallel_edge_removal.hpp"
+#include "../../extractor/internal_extractor_edge.hpp"
+#include "../../data_structures/restriction.hpp"
+#include "../../data_structures/travel_mode.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+
+#include <algorithm>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(parallel_edge_removal)
+
+namespace
+{
+InternalExtractorEdge MakeEdge(const NodeID source,
+                               const NodeID target,
+                               const EdgeWeight weight,
+                               const bool forward,
+                               const bool backward,
+                               const NodeID name_id = 0)
+{
+    InternalExtractorEdge edge(source, target, name_id, InternalExtractorEdge::WeightData(),
+                               forward, backward, false, false, false, TRAVEL_MODE_DEFAULT,
+                               false);
+    edge.result.weight = weight;
+    return edge;
+}
+
+std::vector<InternalExtractorEdge> RemoveAll(std::vector<InternalExtractorEdge> edges)
+{
+    std::sort(edges.begin(), edges.end(), CmpEdgeByStartThenTargetID());
+    RemoveParallelEdges(edges, 0, edges.size());
+
+    std::vector<InternalExtractorEdge> kept;
+    std::copy_if(edges.begin(), edges.end(), std::back_inserter(kept),
+                 [](const InternalExtractorEdge &edge)
+                 {
+                     return edge.result.source != SPECIAL_NODEID &&
+                            edge.result.target != SPECIAL_NODEID;
+                 });
+    return kept;
+}
+}
+
+BOOST_AUTO_TEST_CASE(keeps_lightest_edge)
+{
+    // the last forward edge used to win, whatever its weight
+    const auto kept = RemoveAll({MakeEdge(0, 1, 5, true, false), MakeEdge(0, 1, 3, true, false),
+                                 MakeEdge(0, 1, 7, true, false)});
+
+    BOOST_REQUIRE_EQUAL(kept.size(), 1u);
+    BOOST_CHECK_EQUAL(kept[0].result.weight, 3);
+    BOOST_CHECK(kept[0].result.forward);
+    BOOST_CHECK(!kept[0].result.backward);
+    BOOST_CHECK(!kept[0].result.is_split);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_lightest_edge_per_direction)
+{
+    const auto kept = RemoveAll({MakeEdge(0, 1, 4, true, false), MakeEdge(0, 1, 1, false, true),
+                                 MakeEdge(0, 1, 2, true, false), MakeEdge(0, 1, 6, false, true)});
+
+    BOOST_REQUIRE_EQUAL(kept.size(), 2u);
+    const auto &forward = kept[0].result.source == 0 ? kept[0] : kept[1];
+    const auto &backward = kept[0].result.source == 0 ? kept[1] : kept[0];
+
+    BOOST_CHECK_EQUAL(forward.result.target, 1u);
+    BOOST_CHECK_EQUAL(forward.result.weight, 2);
+    BOOST_CHECK(forward.result.is_split);
+
+    // the backward edge is turned around
+    BOOST_CHECK_EQUAL(backward.result.source, 1u);
+    BOOST_CHECK_EQUAL(backward.result.target, 0u);
+    BOOST_CHECK_EQUAL(backward.result.weight, 1);
+    BOOST_CHECK(backward.result.forward);
+    BOOST_CHECK(!backward.result.backward);
+    BOOST_CHECK(backward.result.is_split);
+}
+
+BOOST_AUTO_TEST_CASE(merges_equal_directions)
+{
+    const auto kept = RemoveAll({MakeEdge(0, 1, 5, true, true), MakeEdge(0, 1, 8, true, true)});
+
+    BOOST_REQUIRE_EQUAL(kept.size(), 1u);
+    BOOST_CHECK_EQUAL(kept[0].result.weight, 5);
+    BOOST_CHECK(kept[0].result.forward);
+    BOOST_CHECK(kept[0].result.backward);
+    BOOST_CHECK(!kept[0].result.is_split);
+}
+
+BOOST_AUTO_TEST_CASE(skips_invalid_targets)
+{
+    // an edge with an invalid target used to stall the loop forever
+    std::vector<InternalExtractorEdge> edges = {
+        MakeEdge(0, 1, 3, true, false), MakeEdge(0, SPECIAL_NODEID, 1, true, false),
+        MakeEdge(1, 2, 4, true, false), MakeEdge(1, 2, 2, true, false)};
+    std::sort(edges.begin(), edges.end(), CmpEdgeByStartThenTargetID());
+    RemoveParallelEdges(edges, 0, edges.size());
+
+    BOOST_CHECK_EQUAL(edges[0].result.target, 1u);
+    BOOST_CHECK_EQUAL(edges[1].result.target, SPECIAL_NODEID);
+    BOOST_CHECK_EQUAL(edges[1].result.source, 0u);
+    // the group behind it is still processed
+    BOOST_CHECK_EQUAL(edges[2].result.source, 1u);
+    BOOST_CHECK_EQUAL(edges[2].result.weight, 2);
+    BOOST_CHECK_EQUAL(edges[3].result.source, SPECIAL_NODEID);
+}
+
+BOOST_AUTO_TEST_CASE(result_independent_of_input_order)
+{
+    // equal weights, only the names differ
+    const auto first = MakeEdge(0, 1, 5, true, false, 2);
+    const auto second = MakeEdge(0, 1, 5, true, false, 1);
+
+    const auto kept = RemoveAll({first, second});
+    const auto kept_swapped = RemoveAll({second, first});
+
+    BOOST_REQUIRE_EQUAL(kept.size(), 1u);
+    BOOST_REQUIRE_EQUAL(kept_swapped.size(), 1u);
+    BOOST_CHECK_EQUAL(kept[0].result.name_id, kept_swapped[0].result.name_id);
+}
+
+BOOST_AUTO_TEST_CASE(restriction_order_independent_of_input_order)
+{
+    std::vector<InputRestrictionContainer> restrictions;
+    for (const NodeID from : {3, 1, 2})
+    {
+        InputRestrictionContainer restriction(0, 7, 0);
+        restriction.restriction.from.node = from;
+        restriction.restriction.via.node = 5;
+        restrictions.push_back(restriction);
+    }
+    auto reversed = restrictions;
+    std::reverse(reversed.begin(), reversed.end());
+
+    std::sort(restrictions.begin(), restrictions.end(), CmpRestrictionContainerByTo());
+    std::sort(reversed.begin(), reversed.end(), CmpRestrictionContainerByTo());
+
+    for (const auto i : {0u, 1u, 2u})
+    {
+        BOOST_CHECK_EQUAL(restrictions[i].restriction.from.node,
+                          reversed[i].restriction.from.node);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
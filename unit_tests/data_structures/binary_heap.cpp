@@ -143,6 +143,41 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(delete_all_test, T, storage_types, RandomDataFi
     BOOST_CHECK(heap.Empty());
 }
 
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(clear_test, T, storage_types, RandomDataFixture<NUM_NODES>)
+{
+    BinaryHeap<TestNodeID, TestKey, TestWeight, TestData, T> heap(NUM_NODES);
+
+    for (unsigned idx : order)
+    {
+        heap.Insert(ids[idx], weights[idx], data[idx]);
+    }
+
+    heap.Clear();
+    BOOST_CHECK(heap.Empty());
+
+    // reinsert half of the nodes in reverse order, the others must not be visible
+    for (unsigned i = 0; i < NUM_NODES / 2; ++i)
+    {
+        BOOST_CHECK(!heap.WasInserted(ids[i]));
+        heap.Insert(ids[i], weights[NUM_NODES - 1 - i], data[i]);
+    }
+
+    for (unsigned i = 0; i < NUM_NODES; ++i)
+    {
+        if (i < NUM_NODES / 2)
+        {
+            BOOST_CHECK(heap.WasInserted(ids[i]));
+            BOOST_CHECK_EQUAL(heap.GetKey(ids[i]), weights[NUM_NODES - 1 - i]);
+            BOOST_CHECK_EQUAL(heap.GetData(ids[i]).value, data[i].value);
+        }
+        else
+        {
+            BOOST_CHECK(!heap.WasInserted(ids[i]));
+        }
+    }
+    BOOST_CHECK_EQUAL(heap.Min(), ids[NUM_NODES / 2 - 1]);
+}
+
 BOOST_FIXTURE_TEST_CASE_TEMPLATE(decrease_key_test, T, storage_types, RandomDataFixture<10>)
 {
     BinaryHeap<TestNodeID, TestKey, TestWeight, TestData, T> heap(10);
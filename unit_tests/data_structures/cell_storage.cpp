@@ -0,0 +1,253 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../contractor/cell_customizer.hpp"
+#include "../../contractor/graph_partitioner.hpp"
+#include "../../data_structures/cell_storage.hpp"
+#include "../../data_structures/multi_level_partition.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../typedefs.h"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(cell_storage)
+
+using EdgeData = QueryEdge::EdgeData;
+using TestGraph = StaticGraph<EdgeData>;
+
+constexpr unsigned GRID_SIZE = 20;
+// Chosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 15;
+
+// grid of one-way streets in both directions with random weights, stored like an uncontracted
+// .hsgr: every edge at both of its nodes
+struct GridGraphFixture
+{
+    GridGraphFixture()
+    {
+        std::mt19937 g(RANDOM_SEED);
+        std::uniform_int_distribution<> weight_udist(1, 100);
+
+        std::vector<TestGraph::InputEdge> edges;
+        const auto add_edge = [&](const NodeID from, const NodeID to)
+        {
+            EdgeData data;
+            data.distance = weight_udist(g);
+            data.forward = true;
+            edges.emplace_back(from, to, data);
+            data.forward = false;
+            data.backward = true;
+            edges.emplace_back(to, from, data);
+        };
+        for (const auto row : osrm::irange(0u, GRID_SIZE))
+        {
+            for (const auto column : osrm::irange(0u, GRID_SIZE))
+            {
+                const NodeID node = row * GRID_SIZE + column;
+                coordinates.emplace_back(static_cast<int>(row * 1000),
+                                         static_cast<int>(column * 1000));
+                if (column + 1 < GRID_SIZE)
+                {
+                    add_edge(node, node + 1);
+                    add_edge(node + 1, node);
+                }
+                if (row + 1 < GRID_SIZE)
+                {
+                    add_edge(node, node + GRID_SIZE);
+                    add_edge(node + GRID_SIZE, node);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        graph = std::make_shared<TestGraph>(GRID_SIZE * GRID_SIZE, edges);
+    }
+
+    // distance from source to all nodes of its cell, only using edges inside the cell
+    std::unordered_map<NodeID, EdgeWeight> DijkstraInCell(const MultiLevelPartition &partition,
+                                                          const unsigned level,
+                                                          const NodeID source) const
+    {
+        using QueueEntry = std::pair<EdgeWeight, NodeID>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+        std::unordered_map<NodeID, EdgeWeight> distances;
+        const auto cell = partition.GetCell(level, source);
+
+        queue.emplace(0, source);
+        while (!queue.empty())
+        {
+            const auto entry = queue.top();
+            queue.pop();
+            if (distances.count(entry.second))
+            {
+                continue;
+            }
+            distances[entry.second] = entry.first;
+            for (const auto edge : graph->GetAdjacentEdgeRange(entry.second))
+            {
+                const auto &data = graph->GetEdgeData(edge);
+                const NodeID target = graph->GetTarget(edge);
+                if (data.forward && partition.GetCell(level, target) == cell)
+                {
+                    queue.emplace(entry.first + data.distance, target);
+                }
+            }
+        }
+        return distances;
+    }
+
+    std::vector<FixedPointCoordinate> coordinates;
+    std::shared_ptr<TestGraph> graph;
+};
+
+BOOST_FIXTURE_TEST_CASE(partition_test, GridGraphFixture)
+{
+    const std::vector<unsigned> max_cell_sizes = {8, 64};
+    const auto partition = GraphPartitioner<TestGraph>(*graph, coordinates)(max_cell_sizes);
+
+    BOOST_CHECK_EQUAL(partition.GetNumberOfLevels(), 2);
+    BOOST_CHECK_EQUAL(partition.GetNumberOfNodes(), GRID_SIZE * GRID_SIZE);
+
+    for (const auto level : osrm::irange(1u, partition.GetNumberOfLevels() + 1))
+    {
+        std::vector<unsigned> cell_sizes(partition.GetNumberOfCells(level), 0);
+        for (const auto node : osrm::irange(0u, partition.GetNumberOfNodes()))
+        {
+            ++cell_sizes[partition.GetCell(level, node)];
+        }
+        for (const auto size : cell_sizes)
+        {
+            BOOST_CHECK_GT(size, 0);
+            BOOST_CHECK_LE(size, max_cell_sizes[level - 1]);
+        }
+    }
+
+    // cells are nested, nodes of a cell share the cell of the next level
+    std::vector<unsigned> parent_cells(partition.GetNumberOfCells(1), SPECIAL_NODEID);
+    for (const auto node : osrm::irange(0u, partition.GetNumberOfNodes()))
+    {
+        auto &parent = parent_cells[partition.GetCell(1, node)];
+        if (SPECIAL_NODEID == parent)
+        {
+            parent = partition.GetCell(2, node);
+        }
+        BOOST_CHECK_EQUAL(parent, partition.GetCell(2, node));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(customization_test, GridGraphFixture)
+{
+    const auto partition = GraphPartitioner<TestGraph>(*graph, coordinates)({8, 64});
+    CellStorage storage(partition, *graph);
+    CellCustomizer<TestGraph>(*graph, partition).Customize(storage);
+
+    BOOST_CHECK_EQUAL(storage.GetNumberOfLevels(), partition.GetNumberOfLevels());
+
+    for (const auto level : osrm::irange(1u, partition.GetNumberOfLevels() + 1))
+    {
+        for (const auto cell_id : osrm::irange(0u, partition.GetNumberOfCells(level)))
+        {
+            const auto cell = static_cast<const CellStorage &>(storage).GetCell(level, cell_id);
+            BOOST_CHECK_GT(cell.GetNumberOfSources(), 0);
+            BOOST_CHECK_GT(cell.GetNumberOfDestinations(), 0);
+            for (const auto source_index : osrm::irange(0u, cell.GetNumberOfSources()))
+            {
+                const NodeID source = cell.GetSource(source_index);
+                BOOST_CHECK_EQUAL(partition.GetCell(level, source), cell_id);
+                BOOST_CHECK_EQUAL(cell.GetSourceIndex(source), source_index);
+
+                const auto distances = DijkstraInCell(partition, level, source);
+                for (const auto destination_index :
+                     osrm::irange(0u, cell.GetNumberOfDestinations()))
+                {
+                    const NodeID destination = cell.GetDestination(destination_index);
+                    const auto iter = distances.find(destination);
+                    const EdgeWeight expected =
+                        distances.end() == iter ? INVALID_EDGE_WEIGHT : iter->second;
+                    BOOST_CHECK_EQUAL(cell.GetWeight(source_index, destination_index), expected);
+                }
+            }
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(serialization_test, GridGraphFixture)
+{
+    const auto partition = GraphPartitioner<TestGraph>(*graph, coordinates)({8, 64});
+    CellStorage storage(partition, *graph);
+    CellCustomizer<TestGraph>(*graph, partition).Customize(storage);
+
+    std::stringstream stream;
+    stream << partition << storage;
+
+    MultiLevelPartition read_partition;
+    CellStorage read_storage;
+    stream >> read_partition >> read_storage;
+
+    BOOST_CHECK_EQUAL(read_partition.GetNumberOfLevels(), partition.GetNumberOfLevels());
+    for (const auto level : osrm::irange(1u, partition.GetNumberOfLevels() + 1))
+    {
+        BOOST_CHECK_EQUAL(read_partition.GetNumberOfCells(level),
+                          partition.GetNumberOfCells(level));
+        for (const auto node : osrm::irange(0u, partition.GetNumberOfNodes()))
+        {
+            BOOST_CHECK_EQUAL(read_partition.GetCell(level, node), partition.GetCell(level, node));
+        }
+        for (const auto cell_id : osrm::irange(0u, partition.GetNumberOfCells(level)))
+        {
+            const auto cell = static_cast<const CellStorage &>(storage).GetCell(level, cell_id);
+            const auto read_cell =
+                static_cast<const CellStorage &>(read_storage).GetCell(level, cell_id);
+            BOOST_CHECK_EQUAL(read_cell.GetNumberOfSources(), cell.GetNumberOfSources());
+            BOOST_CHECK_EQUAL(read_cell.GetNumberOfDestinations(),
+                              cell.GetNumberOfDestinations());
+            for (const auto source_index : osrm::irange(0u, cell.GetNumberOfSources()))
+            {
+                for (const auto destination_index :
+                     osrm::irange(0u, cell.GetNumberOfDestinations()))
+                {
+                    BOOST_CHECK_EQUAL(read_cell.GetWeight(source_index, destination_index),
+                                      cell.GetWeight(source_index, destination_index));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -93,4 +93,82 @@ BOOST_AUTO_TEST_CASE(find_test)
     BOOST_CHECK_EQUAL(simple_graph.GetEdgeData(eit).id, 2);
 }
 
+BOOST_AUTO_TEST_CASE(insert_delete_compact_test)
+{
+    constexpr unsigned NUM_NODES = 100;
+    std::vector<unsigned> node_capacities(NUM_NODES, 2);
+    TestDynamicGraph graph(NUM_NODES, node_capacities);
+
+    // reference adjacency, (source, target) -> id
+    std::unordered_map<unsigned, EdgeID> reference;
+    const auto check_graph = [&]()
+    {
+        BOOST_CHECK_EQUAL(graph.GetNumberOfEdges(), reference.size());
+        for (const auto &entry : reference)
+        {
+            const auto eit = graph.FindEdge(entry.first / NUM_NODES, entry.first % NUM_NODES);
+            BOOST_REQUIRE(eit != SPECIAL_EDGEID);
+            BOOST_CHECK_EQUAL(graph.GetEdgeData(eit).id, entry.second);
+        }
+    };
+
+    std::mt19937 g(42);
+    std::uniform_int_distribution<unsigned> node_udist(0, NUM_NODES - 1);
+    EdgeID next_id = 0;
+    for (unsigned round = 0; round < 10; ++round)
+    {
+        // grows the adjacency blocks beyond their capacity
+        for (unsigned i = 0; i < 500; ++i)
+        {
+            const unsigned source = node_udist(g);
+            const unsigned target = node_udist(g);
+            if (reference.count(source * NUM_NODES + target) == 0)
+            {
+                graph.InsertEdge(source, target, TestData{next_id});
+                reference[source * NUM_NODES + target] = next_id++;
+            }
+        }
+        // leaves room behind in the blocks and the pool
+        for (unsigned i = 0; i < 200; ++i)
+        {
+            const unsigned source = node_udist(g);
+            const unsigned target = node_udist(g);
+            const auto deleted = graph.DeleteEdgesTo(source, target);
+            BOOST_CHECK_EQUAL(static_cast<std::size_t>(deleted),
+                              reference.erase(source * NUM_NODES + target));
+        }
+        check_graph();
+    }
+
+    BOOST_CHECK_GT(graph.GetNumberOfFreeSlots(), 0u);
+    graph.Compact();
+    BOOST_CHECK_EQUAL(graph.GetNumberOfFreeSlots(), 0u);
+    check_graph();
+
+    // the reserved room is used without moving the block
+    std::vector<unsigned> new_targets;
+    for (unsigned target = 0; target < NUM_NODES && new_targets.size() < 20; ++target)
+    {
+        if (reference.count(target) == 0)
+        {
+            new_targets.push_back(target);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(new_targets.size(), 20u);
+
+    graph.ReserveEdges(0, 20);
+    const auto first_edge = graph.BeginEdges(0);
+    for (const auto target : new_targets)
+    {
+        graph.InsertEdge(0, target, TestData{next_id});
+        reference[target] = next_id++;
+    }
+    BOOST_CHECK_EQUAL(graph.BeginEdges(0), first_edge);
+    for (const auto target : new_targets)
+    {
+        BOOST_CHECK(graph.FindEdge(0, target) != SPECIAL_EDGEID);
+    }
+    check_graph();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -72,7 +72,12 @@ bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &p
         "namesdata", boost::program_options::value<boost::filesystem::path>(&paths["namesdata"]),
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
-                       ".timestamp file");
+                       ".timestamp file")(
+        "partitiondata",
+        boost::program_options::value<boost::filesystem::path>(&paths["partitiondata"]),
+        ".partition file of osrm-prepare --mld")(
+        "cellsdata", boost::program_options::value<boost::filesystem::path>(&paths["cellsdata"]),
+        ".cells file of osrm-customize");
 
     // hidden options, will be allowed both on command line and in config
     // file, but will not be shown to the user
@@ -210,6 +215,18 @@ bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &p
         {
             path_iterator->second = base_string + ".timestamp";
         }
+
+        path_iterator = paths.find("partitiondata");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".partition";
+        }
+
+        path_iterator = paths.find("cellsdata");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".cells";
+        }
     }
 
     path_iterator = paths.find("hsgrdata");
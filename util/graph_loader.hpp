@@ -174,7 +174,8 @@ template <typename NodeT, typename EdgeT>
 unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
                             std::vector<NodeT> &node_list,
                             std::vector<EdgeT> &edge_list,
-                            unsigned *check_sum)
+                            unsigned *check_sum,
+                            std::vector<bool> *is_core_node = nullptr)
 {
     if (!boost::filesystem::exists(hsgr_file))
     {
@@ -217,6 +218,26 @@ unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
         hsgr_input_stream.read(reinterpret_cast<char *>(&edge_list[0]),
                                number_of_edges * sizeof(EdgeT));
     }
+
+    // core markers follow the edges, files of fully contracted graphs may end before them
+    if (nullptr != is_core_node)
+    {
+        unsigned number_of_core_markers = 0;
+        hsgr_input_stream.read(reinterpret_cast<char *>(&number_of_core_markers),
+                               sizeof(unsigned));
+        is_core_node->clear();
+        if (hsgr_input_stream && number_of_core_markers > 0)
+        {
+            std::vector<unsigned> core_marker_blocks(number_of_core_markers / 32 + 1);
+            hsgr_input_stream.read(reinterpret_cast<char *>(&core_marker_blocks[0]),
+                                   core_marker_blocks.size() * sizeof(unsigned));
+            is_core_node->resize(number_of_core_markers);
+            for (unsigned node = 0; node < number_of_core_markers; ++node)
+            {
+                (*is_core_node)[node] = (core_marker_blocks[node / 32] >> (node % 32)) & 1u;
+            }
+        }
+    }
     hsgr_input_stream.close();
 
     return number_of_nodes;
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ROUTED_OPTIONS_HPP
 #define ROUTED_OPTIONS_HPP
 
+#include "cast.hpp"
 #include "git_sha.hpp"
 #include "ini_file.hpp"
 #include "osrm_exception.hpp"
@@ -40,6 +41,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <fstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 const static unsigned INIT_OK_START_ENGINE = 0;
 const static unsigned INIT_OK_DO_NOT_START_ENGINE = 1;
 const static unsigned INIT_FAILED = -1;
@@ -71,6 +74,10 @@ inline void populate_base_path(ServerPaths &server_paths)
         BOOST_ASSERT(server_paths.find("namesdata") != server_paths.end());
         server_paths["timestamp"] = base_string + ".timestamp";
         BOOST_ASSERT(server_paths.find("timestamp") != server_paths.end());
+        server_paths["partitiondata"] = base_string + ".partition";
+        BOOST_ASSERT(server_paths.find("partitiondata") != server_paths.end());
+        server_paths["cellsdata"] = base_string + ".cells";
+        BOOST_ASSERT(server_paths.find("cellsdata") != server_paths.end());
     }
 
     // check if files are give and whether they exist at all
@@ -140,6 +147,27 @@ inline void populate_base_path(ServerPaths &server_paths)
     SimpleLogger().Write(logDEBUG) << "Index file:\t" << server_paths["fileindex"];
     SimpleLogger().Write(logDEBUG) << "Names file:\t" << server_paths["namesdata"];
     SimpleLogger().Write(logDEBUG) << "Timestamp file:\t" << server_paths["timestamp"];
+    SimpleLogger().Write(logDEBUG) << "Partition file:\t" << server_paths["partitiondata"];
+    SimpleLogger().Write(logDEBUG) << "Cells file:\t" << server_paths["cellsdata"];
+}
+
+// parse per-service limits given as <service>=<max. number of queued and running requests>
+inline void ParseServiceLimits(const std::vector<std::string> &service_limit_strings,
+                               std::unordered_map<std::string, unsigned> &service_limits)
+{
+    for (const std::string &limit_string : service_limit_strings)
+    {
+        const auto separator = limit_string.find('=');
+        const unsigned limit = std::string::npos == separator
+                                   ? 0
+                                   : cast::string_to_uint(limit_string.substr(separator + 1));
+        if (0 == separator || 0 == limit)
+        {
+            throw osrm::exception("Service limit must be given as <service>=<positive number>: " +
+                                  limit_string);
+        }
+        service_limits[limit_string.substr(0, separator)] = limit;
+    }
 }
 
 // generate boost::program_options object for the routing part
@@ -149,7 +177,13 @@ inline unsigned GenerateServerProgramOptions(const int argc,
                                              std::string &ip_address,
                                              int &ip_port,
                                              int &requested_num_threads,
+                                             int &requested_num_io_threads,
+                                             int &max_queued_requests,
+                                             std::unordered_map<std::string, unsigned> &service_limits,
+                                             int &keepalive_timeout,
+                                             int &keepalive_max_requests,
                                              bool &use_shared_memory,
+                                             bool &prefault_index,
                                              bool &trial,
                                              int &max_locations_distance_table,
                                              int &max_locations_map_matching)
@@ -163,6 +197,8 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         "trial", boost::program_options::value<bool>(&trial)->implicit_value(true),
         "Quit after initialization");
 
+    std::vector<std::string> service_limit_strings;
+
     // declare a group of options that will be allowed both on command line
     // as well as in a config file
     boost::program_options::options_description config_options("Configuration");
@@ -183,14 +219,38 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
                        ".timestamp file")(
+        "partitiondata",
+        boost::program_options::value<boost::filesystem::path>(&paths["partitiondata"]),
+        ".partition file of osrm-prepare --mld")(
+        "cellsdata", boost::program_options::value<boost::filesystem::path>(&paths["cellsdata"]),
+        ".cells file of osrm-customize")(
         "ip,i", boost::program_options::value<std::string>(&ip_address)->default_value("0.0.0.0"),
         "IP address")("port,p", boost::program_options::value<int>(&ip_port)->default_value(5000),
                       "TCP/IP port")(
         "threads,t", boost::program_options::value<int>(&requested_num_threads)->default_value(8),
-        "Number of threads to use")(
+        "Number of threads that answer routing requests")(
+        "io-threads",
+        boost::program_options::value<int>(&requested_num_io_threads)->default_value(1),
+        "Number of threads that handle network I/O")(
+        "max-queue-size",
+        boost::program_options::value<int>(&max_queued_requests)->default_value(256),
+        "Max. number of requests waiting for a thread, more are rejected with 503")(
+        "service-limit",
+        boost::program_options::value<std::vector<std::string>>(&service_limit_strings)
+            ->composing(),
+        "Max. number of concurrent requests for one service, e.g. table=2")(
+        "keepalive-timeout",
+        boost::program_options::value<int>(&keepalive_timeout)->default_value(5),
+        "Seconds an idle connection is kept open, 0 closes it after every reply")(
+        "keepalive-requests",
+        boost::program_options::value<int>(&keepalive_max_requests)->default_value(512),
+        "Max. number of requests served over one connection")(
         "shared-memory,s",
         boost::program_options::value<bool>(&use_shared_memory)->implicit_value(true),
         "Load data from shared memory")(
+        "prefault-index",
+        boost::program_options::value<bool>(&prefault_index)->implicit_value(true),
+        "Prefault the memory-mapped .fileIndex at startup")(
         "max-table-size,m",
         boost::program_options::value<int>(&max_locations_distance_table)->default_value(100),
         "Max. locations supported in distance table query")(
@@ -253,13 +313,23 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         boost::program_options::store(parse_config_file(config_stream, config_file_options),
                                       option_variables);
         boost::program_options::notify(option_variables);
+        ParseServiceLimits(service_limit_strings, service_limits);
         return INIT_OK_START_ENGINE;
     }
 
-    if (1 > requested_num_threads)
+    if (1 > requested_num_threads || 1 > requested_num_io_threads)
     {
         throw osrm::exception("Number of threads must be a positive number");
     }
+    if (1 > max_queued_requests)
+    {
+        throw osrm::exception("Max. queue size must be a positive number");
+    }
+    ParseServiceLimits(service_limit_strings, service_limits);
+    if (0 > keepalive_timeout || 0 > keepalive_max_requests)
+    {
+        throw osrm::exception("Keep-alive timeout and request limit must not be negative");
+    }
 
     if (!use_shared_memory && option_variables.count("base"))
     {